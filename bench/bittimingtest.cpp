@@ -0,0 +1,136 @@
+///**************************************************************************************
+/// \file         bittimingtest.cpp
+/// \brief        Host test of the bxCAN bit timing solver.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <array>
+#include "bxcanbittiming.hpp"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief Expected bit timing settings for a bitrate.
+class BitTimingCase
+{
+public:
+  // Members.
+  uint32_t bitrate;
+  uint16_t prescaler;
+  uint8_t tseg1;
+  uint8_t tseg2;
+  uint8_t sjw;
+  uint16_t samplePointPermille;
+};
+
+
+//***************************************************************************************
+// Local constant declarations
+//***************************************************************************************
+/// \brief Solver settings of the board: the frequency of the clock that drives the CAN
+///        peripheral, the sample point to aim for and the oscillator tolerance.
+static constexpr uint32_t canClockHz = 36000000UL;
+static constexpr uint16_t samplePointPermille = 750U;
+static constexpr uint32_t oscTolerancePpm = 1000U;
+
+/// \brief Expected settings for the standard bitrates and two common non-standard ones.
+///        All standard bitrates are exact. Only 800 kbit/s misses the 75% sample point,
+///        because its 45 clock cycles per bit do not allow it. 83.333 kbit/s is 4 ppm
+///        off and 666 kbit/s 1001 ppm, which the settings can still handle.
+static constexpr std::array<BitTimingCase, 11U> bitTimingCases =
+{{
+  {   10000U, 180U, 14U, 5U, 4U, 750U },
+  {   20000U,  90U, 14U, 5U, 4U, 750U },
+  {   50000U,  36U, 14U, 5U, 4U, 750U },
+  {  100000U,  18U, 14U, 5U, 4U, 750U },
+  {  125000U,  18U, 11U, 4U, 4U, 750U },
+  {  250000U,   9U, 11U, 4U, 4U, 750U },
+  {  500000U,   6U,  8U, 3U, 3U, 750U },
+  {  800000U,   3U, 10U, 4U, 4U, 733U },
+  { 1000000U,   3U,  8U, 3U, 3U, 750U },
+  {   83333U,  27U, 11U, 4U, 4U, 750U },
+  {  666000U,   3U, 13U, 4U, 4U, 777U }
+}};
+
+
+///**************************************************************************************
+/// \brief     This is the entry point for the host test of the bxCAN bit timing solver.
+///            It runs the solver with the board's settings for each bitrate in
+///            bitTimingCases and checks the prescaler, the segments, the
+///            synchronization jump width and the resulting sample point.
+/// \return    EXIT_SUCCESS if the solver found the expected settings for all bitrates,
+///            EXIT_FAILURE otherwise.
+///
+///**************************************************************************************
+int main()
+{
+  int result = EXIT_SUCCESS;
+
+  // Run the solver for each bitrate and compare with the expected settings.
+  for (auto const& testCase : bitTimingCases)
+  {
+    BxCanBitTiming bitTiming{ };
+    uint8_t found = BxCanBitTiming::solve(canClockHz, testCase.bitrate,
+                                          samplePointPermille, oscTolerancePpm,
+                                          BxCanBitTiming::SJWMAX, bitTiming);
+    uint32_t tq = 1U + bitTiming.tseg1 + bitTiming.tseg2;
+    uint32_t samplePoint = ((1U + bitTiming.tseg1) * 1000U) / tq;
+
+    if ((found != TBX_OK) || (bitTiming.prescaler != testCase.prescaler) ||
+        (bitTiming.tseg1 != testCase.tseg1) || (bitTiming.tseg2 != testCase.tseg2) ||
+        (bitTiming.sjw != testCase.sjw) ||
+        (samplePoint != testCase.samplePointPermille))
+    {
+      std::printf("FAIL %7u bit/s: found %u, prescaler %u, tseg1 %u, tseg2 %u, sjw %u, "
+                  "sample point %u permille.\n", testCase.bitrate, found,
+                  bitTiming.prescaler, bitTiming.tseg1, bitTiming.tseg2, bitTiming.sjw,
+                  samplePoint);
+      result = EXIT_FAILURE;
+    }
+    else
+    {
+      std::printf("PASS %7u bit/s: prescaler %u, tseg1 %u, tseg2 %u, sjw %u, "
+                  "sample point %u permille.\n", testCase.bitrate, bitTiming.prescaler,
+                  bitTiming.tseg1, bitTiming.tseg2, bitTiming.sjw, samplePoint);
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+//********************************** end of bittimingtest.cpp ***************************
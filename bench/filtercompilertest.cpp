@@ -0,0 +1,158 @@
+///**************************************************************************************
+/// \file         filtercompilertest.cpp
+/// \brief        Host test of the CAN filter compiler at compile time.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include "canfiltercompiler.hpp"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief Result of compiling a set of CAN identifiers.
+class CompiledIds
+{
+public:
+  // Members.
+  CanFilterSet filterSet;
+  CanFilterCompiler compiler;
+  uint8_t result;
+};
+
+
+//***************************************************************************************
+// Local constant declarations
+//***************************************************************************************
+/// \brief 11-bit identifiers to compile. Five exact identifiers need two filter banks.
+static constexpr uint32_t stdIds[] = { 0x100U, 0x101U, 0x102U, 0x103U, 0x200U };
+static constexpr size_t stdIdCount = sizeof(stdIds) / sizeof(stdIds[0]);
+
+
+//***************************************************************************************
+// Local function definitions
+//***************************************************************************************
+///**************************************************************************************
+/// \brief     Compiles the 11-bit identifiers for the specified number of filter banks.
+/// \param     t_BanksMax Number of available filter banks.
+/// \return    The compiled filter set, together with the compiler's statistics.
+///
+///**************************************************************************************
+static constexpr CompiledIds compileStdIds(size_t t_BanksMax)
+{
+  CompiledIds compiled{ { }, CanFilterCompiler(t_BanksMax), TBX_ERROR };
+
+  compiled.result = compiled.compiler.compile(stdIds, stdIdCount, TBX_FALSE,
+                                              compiled.filterSet);
+  return compiled;
+}
+
+
+///**************************************************************************************
+/// \brief     Checks if a filter set accepts all 11-bit identifiers it was compiled
+///            from.
+/// \param     t_FilterSet Filter set.
+/// \return    TBX_TRUE if all identifiers are accepted, TBX_FALSE otherwise.
+///
+///**************************************************************************************
+static constexpr uint8_t acceptsAllStdIds(CanFilterSet const& t_FilterSet)
+{
+  uint8_t result = TBX_TRUE;
+
+  // Each identifier must match at least one of the 11-bit entries.
+  for (size_t idIdx = 0U; idIdx < stdIdCount; idIdx++)
+  {
+    uint8_t accepted = TBX_FALSE;
+    for (size_t idx = 0U; idx < t_FilterSet.size(); idx++)
+    {
+      CanFilterEntry const& entry = t_FilterSet[idx];
+      if ((entry.ext == TBX_FALSE) && ((stdIds[idIdx] & entry.mask) == entry.code))
+      {
+        accepted = TBX_TRUE;
+      }
+    }
+    if (accepted == TBX_FALSE)
+    {
+      result = TBX_FALSE;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+//***************************************************************************************
+// Compile time checks
+//***************************************************************************************
+/// \brief Filter sets compiled at build time. With enough filter banks, the identifiers
+///        stay exact. With a single filter bank, entries must be merged.
+static constexpr CompiledIds compiledExact = compileStdIds(14U);
+static constexpr CompiledIds compiledMerged = compileStdIds(1U);
+
+// The compiler is meant to run at build time. These checks fail the build otherwise.
+static_assert(compiledExact.result == TBX_OK, "Compiling for 14 banks must succeed");
+static_assert(compiledExact.filterSet.size() == stdIdCount, "All entries stay exact");
+static_assert(compiledExact.compiler.acceptedIds() == stdIdCount, "No false positives");
+static_assert(CanFilterCompiler::banksNeeded(compiledExact.filterSet) == 2U,
+              "Five exact 11-bit identifiers need two filter banks");
+static_assert(compiledMerged.result == TBX_OK, "Compiling for one bank must succeed");
+static_assert(CanFilterCompiler::banksNeeded(compiledMerged.filterSet) <= 1U,
+              "The merged filter set must fit a single filter bank");
+static_assert(acceptsAllStdIds(compiledMerged.filterSet) == TBX_TRUE,
+              "The merged filter set must still accept all identifiers");
+
+
+///**************************************************************************************
+/// \brief     This is the entry point for the host test of the CAN filter compiler. The
+///            actual checks already ran at build time. It just reports the outcome.
+/// \return    EXIT_SUCCESS.
+///
+///**************************************************************************************
+int main()
+{
+  // Report the compiled filter sets.
+  std::printf("PASS 14 banks: %zu entries, %u of %u identifiers accepted.\n",
+              compiledExact.filterSet.size(), compiledExact.compiler.acceptedIds(),
+              compiledExact.compiler.wantedIds());
+  std::printf("PASS  1 bank:  %zu entries, %u of %u identifiers accepted.\n",
+              compiledMerged.filterSet.size(), compiledMerged.compiler.acceptedIds(),
+              compiledMerged.compiler.wantedIds());
+  // Give the result back to the caller.
+  return EXIT_SUCCESS;
+}
+//********************************** end of filtercompilertest.cpp **********************
@@ -0,0 +1,490 @@
+///**************************************************************************************
+/// \file         main.cpp
+/// \brief        Host replay benchmark of an XCP session through the gateway.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include "gateway.hpp"
+#include "indicator.hpp"
+#include "controlloop.hpp"
+#include "logger.hpp"
+#include "latencyrecorder.hpp"
+#include "mockboard.hpp"
+#include "srecimage.hpp"
+#include "xcpsession.hpp"
+#include "xcptarget.hpp"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Host event logger class.
+/// \details Counts the logged events. Only warnings and errors are printed, because
+///          they indicate a problem with the replay.
+class HostLogger : public Logger
+{
+public:
+  // Constructors and destructor.
+  explicit HostLogger() : Logger() { }
+  virtual ~HostLogger() { }
+  // Getters and setters.
+  uint32_t problems() const { return m_Problems; }
+
+private:
+  // Members.
+  uint32_t m_Problems{0U};
+  // Methods.
+  void log(Level t_Level, const char t_Fmt[], va_list * t_ParamList) override
+  {
+    if (t_Level != INFO)
+    {
+      m_Problems++;
+      std::fprintf(stderr, (t_Level == ERROR) ? "[ERROR] " : "[WARNING] ");
+      std::vfprintf(stderr, t_Fmt, *t_ParamList);
+      std::fprintf(stderr, "\n");
+    }
+  }
+};
+
+
+/// \brief   Host forwarding latency recorder class.
+/// \details Instead of measuring the latencies, it counts the records per path and keeps
+///          the timestamp of the latest one. The replay timestamps each packet with a
+///          sequence number. This way it can check that the gateway records exactly the
+///          packets it forwards, each one with its own reception timestamp.
+class HostLatencyRecorder : public LatencyRecorder
+{
+public:
+  // Constructors and destructor.
+  explicit HostLatencyRecorder() : LatencyRecorder() { }
+  virtual ~HostLatencyRecorder() { }
+  // Methods.
+  void record(Path t_Path, uint32_t t_RxTimestamp) override
+  {
+    m_Counts[t_Path]++;
+    m_Timestamps[t_Path] = t_RxTimestamp;
+  }
+  // Getters and setters.
+  uint64_t count(Path t_Path) const { return m_Counts[t_Path]; }
+  uint32_t timestamp(Path t_Path) const { return m_Timestamps[t_Path]; }
+
+private:
+  // Members.
+  std::array<uint64_t, PATHCOUNT> m_Counts{ };
+  std::array<uint32_t, PATHCOUNT> m_Timestamps{ };
+};
+
+
+/// \brief Control loop of the benchmark. Stepped by the replay, instead of a thread.
+class BenchControlLoop : public ControlLoopPublisher
+{
+public:
+  // Constructors and destructor.
+  explicit BenchControlLoop() : ControlLoopPublisher() { }
+  virtual ~BenchControlLoop() { }
+};
+
+
+/// \brief Measurement results of one path through the gateway.
+class PathStats
+{
+public:
+  // Constructors and destructor.
+  explicit PathStats(const char * t_Name) : name(t_Name) { }
+  // Members.
+  const char * name;
+  uint64_t packets{0U};
+  uint64_t nanoseconds{0U};
+  uint64_t allocations{0U};
+};
+
+
+//***************************************************************************************
+// Local constant declarations
+//***************************************************************************************
+/// \brief CAN identifier for XCP packets from the host to the target.
+static constexpr uint32_t canIdToTarget = 0x667UL;
+
+/// \brief CAN identifier for XCP packets from the target to the host.
+static constexpr uint32_t canIdFromTarget = 0x7E1UL;
+
+/// \brief Start address and size of the generated image and the target's flash memory.
+static constexpr uint32_t memoryBase = 0x08004000UL;
+static constexpr size_t memorySize = 240U * 1024U;
+static constexpr size_t generatedImageSize = 65535U;
+
+/// \brief Number of round trips per control loop step. At 500 kbit/s one round trip of
+///        two 8-byte CAN frames takes about 0.5 milliseconds, so this makes for the
+///        control loop's 10 millisecond step time.
+static constexpr size_t roundTripsPerStep = 20U;
+static constexpr std::chrono::milliseconds stepMillis{10};
+
+
+//***************************************************************************************
+// Local data declarations
+//***************************************************************************************
+/// \brief Number of dynamic memory allocations so far.
+static std::atomic<uint64_t> allocationCount{0U};
+
+/// \brief The logger instance.
+static HostLogger hostLogger;
+
+/// \brief The latency recorder instance.
+static HostLatencyRecorder hostLatencyRecorder;
+
+
+///**************************************************************************************
+/// \brief     Global getter of the logger's instance.
+/// \return    Reference to the logger instance.
+///
+///**************************************************************************************
+Logger& logger()
+{
+  return hostLogger;
+}
+
+
+///**************************************************************************************
+/// \brief     Global getter of the latency recorder's instance.
+/// \return    Reference to the latency recorder instance.
+///
+///**************************************************************************************
+LatencyRecorder& latencyRecorder()
+{
+  return hostLatencyRecorder;
+}
+
+
+///**************************************************************************************
+/// \brief     Global allocation functions, which count the number of allocations.
+///
+///**************************************************************************************
+void * operator new(size_t t_Size)
+{
+  void * result;
+
+  allocationCount++;
+  result = std::malloc((t_Size > 0U) ? t_Size : 1U);
+  if (result == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void * operator new[](size_t t_Size)
+{
+  return operator new(t_Size);
+}
+
+void operator delete(void * t_Ptr) noexcept
+{
+  std::free(t_Ptr);
+}
+
+void operator delete[](void * t_Ptr) noexcept
+{
+  std::free(t_Ptr);
+}
+
+void operator delete(void * t_Ptr, size_t t_Size) noexcept
+{
+  TBX_UNUSED_ARG(t_Size);
+  std::free(t_Ptr);
+}
+
+void operator delete[](void * t_Ptr, size_t t_Size) noexcept
+{
+  TBX_UNUSED_ARG(t_Size);
+  std::free(t_Ptr);
+}
+
+
+///**************************************************************************************
+/// \brief     Runs a function and measures its execution time and allocations.
+/// \param     t_Nanoseconds Execution time of the function.
+/// \param     t_Allocations Number of allocations during the function.
+/// \param     t_Function The function to run.
+/// \return    The function's return value.
+///
+///**************************************************************************************
+template <class F>
+static auto measure(uint64_t& t_Nanoseconds, uint64_t& t_Allocations, F&& t_Function)
+{
+  uint64_t allocationsStart = allocationCount;
+  auto start = std::chrono::steady_clock::now();
+  auto result = t_Function();
+  auto stop = std::chrono::steady_clock::now();
+
+  t_Nanoseconds = static_cast<uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+  t_Allocations = allocationCount - allocationsStart;
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Adds a measurement to the results of a path.
+/// \param     t_Stats Results of the path.
+/// \param     t_Nanoseconds Execution time of the measurement.
+/// \param     t_Allocations Number of allocations during the measurement.
+///
+///**************************************************************************************
+static void record(PathStats& t_Stats, uint64_t t_Nanoseconds, uint64_t t_Allocations)
+{
+  t_Stats.packets++;
+  t_Stats.nanoseconds += t_Nanoseconds;
+  t_Stats.allocations += t_Allocations;
+}
+
+
+///**************************************************************************************
+/// \brief     Prints the results of a path.
+/// \param     t_Stats Results of the path.
+///
+///**************************************************************************************
+static void report(PathStats const& t_Stats)
+{
+  double seconds = static_cast<double>(t_Stats.nanoseconds) / 1e9;
+  double packets = static_cast<double>(t_Stats.packets);
+
+  // Only report paths that were actually taken.
+  if (t_Stats.packets > 0U)
+  {
+    std::printf("%-20s %10llu %14.0f %12.1f %14.3f\n", t_Stats.name,
+                static_cast<unsigned long long>(t_Stats.packets), packets / seconds,
+                static_cast<double>(t_Stats.nanoseconds) / packets,
+                static_cast<double>(t_Stats.allocations) / packets);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     This is the entry point for the host replay benchmark. It replays an XCP
+///            firmware update session of an OpenBLT host through the gateway, with a
+///            simulated OpenBLT target on the CAN side, and reports per path through
+///            the gateway: the packets per second, the nanoseconds per packet and the
+///            dynamic memory allocations per packet. The measured time includes the
+///            mock drivers and the reading of the clock.
+///            Usage: replaybench [-n sessions] [file.srec]. Without a file, it
+///            programs a generated image with pseudo random data.
+/// \param     argc Number of program arguments.
+/// \param     argv Array with the program arguments.
+/// \return    EXIT_SUCCESS if the target holds the image after each session and all
+///            packets were answered as expected, EXIT_FAILURE otherwise.
+///
+///**************************************************************************************
+int main(int argc, char * argv[])
+{
+  int result = EXIT_SUCCESS;
+  unsigned long sessions = 100U;
+  const char * srecFile = nullptr;
+  SrecImage image;
+
+  // Process the program arguments.
+  for (int idx = 1; idx < argc; idx++)
+  {
+    if ((std::strcmp(argv[idx], "-n") == 0) && ((idx + 1) < argc))
+    {
+      idx++;
+      sessions = std::strtoul(argv[idx], nullptr, 10);
+    }
+    else
+    {
+      srecFile = argv[idx];
+    }
+  }
+  // Load the firmware image.
+  if (srecFile != nullptr)
+  {
+    std::ifstream srecStream(srecFile);
+    if (image.load(srecStream) != TBX_OK)
+    {
+      std::fprintf(stderr, "Could not load S-record file %s.\n", srecFile);
+      result = EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    std::istringstream srecStream(SrecImage::generate(memoryBase, generatedImageSize));
+    (void)image.load(srecStream);
+  }
+  // Only continue with a valid image.
+  if (result == EXIT_SUCCESS)
+  {
+    XcpSession session(image);
+    XcpTarget target(memoryBase, memorySize);
+    MockCan can;
+    MockUsbDevice usbDevice;
+    MockBoot boot;
+    MockStorage storage;
+    MockLed statusLed;
+    Indicator indicator(statusLed);
+    Gateway gateway(usbDevice, can, boot, storage);
+    BenchControlLoop controlLoop;
+    PathStats usbToCan("USB to CAN");
+    PathStats canToUsbIsr("CAN to USB (ISR)");
+    PathStats canToUsbTask("CAN to USB (task)");
+    PathStats controlLoopStep("Control loop step");
+    std::array<uint8_t, CanMsg::c_DataLenMax + 1U> usbPacket;
+    std::array<uint8_t, MockUsbDevice::c_TxBufferSize> usbResponse;
+    size_t roundTrips = 0U;
+    uint32_t failedSessions = 0U;
+    uint32_t nextTimestamp = 0U;
+
+    // Wire up the application, like the board's application does.
+    gateway.onConnected = [&indicator] { indicator.setState(Indicator::ACTIVE); };
+    gateway.onDisconnected = [&indicator] { indicator.setState(Indicator::IDLE); };
+    gateway.setConnectRetryInterval(std::chrono::milliseconds{10});
+    controlLoop.attach(indicator);
+    controlLoop.attach(gateway);
+    indicator.setState(Indicator::IDLE);
+    gateway.start();
+    // Replay the session the requested number of times.
+    for (unsigned long sessionIdx = 0U; sessionIdx < sessions; sessionIdx++)
+    {
+      uint32_t failedPackets = 0U;
+      for (auto const& packet : session.packets())
+      {
+        uint64_t nanoseconds;
+        uint64_t allocations;
+        CanMsg cmdMsg;
+        CanMsg resMsg(canIdFromTarget, TBX_FALSE, 0U);
+        size_t responseLen = 0U;
+        uint32_t cmdTimestamp = nextTimestamp++;
+        uint32_t resTimestamp = nextTimestamp++;
+        uint64_t usbToCanRecords = hostLatencyRecorder.count(LatencyRecorder::USBTOCAN);
+        uint64_t canToUsbRecords = hostLatencyRecorder.count(LatencyRecorder::CANTOUSB);
+        uint64_t roundTripRecords = hostLatencyRecorder.count(LatencyRecorder::ROUNDTRIP);
+        // The host sends the XCP packet in a USB bulk transfer, preceded by its length.
+        usbPacket[0] = packet.len;
+        std::copy_n(packet.data.begin(), packet.len, &usbPacket[1]);
+        (void)measure(nanoseconds, allocations, [&]
+        {
+          usbDevice.receive(usbPacket.data(), packet.len + 1U, cmdTimestamp);
+          return 0;
+        });
+        record(usbToCan, nanoseconds, allocations);
+        // The target processes the XCP packet from the CAN bus and responds.
+        if ((can.popTransmitted(cmdMsg) == TBX_OK) &&
+            (target.process(cmdMsg, resMsg) == TBX_TRUE))
+        {
+          resMsg.setTimestamp(resTimestamp);
+          MockCan::Path path = measure(nanoseconds, allocations, [&]
+          {
+            return can.receive(resMsg);
+          });
+          record((path == MockCan::PATHISR) ? canToUsbIsr : canToUsbTask, nanoseconds,
+                 allocations);
+          responseLen = usbDevice.popTransmitted(usbResponse.data(), usbResponse.size());
+        }
+        // Each forwarded packet should have its latency recorded exactly once, with its
+        // own timestamp. The response also completes the round trip of the command.
+        if ((hostLatencyRecorder.count(LatencyRecorder::USBTOCAN) !=
+             (usbToCanRecords + 1U)) ||
+            (hostLatencyRecorder.timestamp(LatencyRecorder::USBTOCAN) != cmdTimestamp))
+        {
+          failedPackets++;
+        }
+        if ((responseLen > 0U) &&
+            ((hostLatencyRecorder.count(LatencyRecorder::CANTOUSB) !=
+              (canToUsbRecords + 1U)) ||
+             (hostLatencyRecorder.count(LatencyRecorder::ROUNDTRIP) !=
+              (roundTripRecords + 1U)) ||
+             (hostLatencyRecorder.timestamp(LatencyRecorder::CANTOUSB) != resTimestamp) ||
+             (hostLatencyRecorder.timestamp(LatencyRecorder::ROUNDTRIP) != cmdTimestamp)))
+        {
+          failedPackets++;
+        }
+        // The host expects a single positive response, if any.
+        if ((packet.response == TBX_TRUE) &&
+            ((responseLen < 2U) || (usbResponse[0] != (responseLen - 1U)) ||
+             (usbResponse[1] != 0xFFU)))
+        {
+          failedPackets++;
+        }
+        // Step the control loop.
+        if (++roundTrips >= roundTripsPerStep)
+        {
+          roundTrips = 0U;
+          (void)measure(nanoseconds, allocations, [&]
+          {
+            controlLoop.notify(stepMillis);
+            return 0;
+          });
+          record(controlLoopStep, nanoseconds, allocations);
+        }
+      }
+      // Check the outcome of the session.
+      if ((failedPackets > 0U) || (target.verify(image) != TBX_OK) ||
+          (target.resets() != (sessionIdx + 1U)))
+      {
+        failedSessions++;
+      }
+    }
+    gateway.stop();
+    // Report the results.
+    std::printf("Image: %zu segment(s), %zu bytes, %zu packets per session, "
+                "%lu session(s).\n", image.segments().size(), image.size(),
+                session.packets().size(), sessions);
+    std::printf("%-20s %10s %14s %12s %14s\n", "Path", "Packets", "Packets/s",
+                "ns/packet", "Allocs/packet");
+    report(usbToCan);
+    report(canToUsbIsr);
+    report(canToUsbTask);
+    report(controlLoopStep);
+    std::printf("Sessions failed: %u, logged problems: %u, LED changes: %u.\n",
+                failedSessions, hostLogger.problems(), statusLed.changes());
+    if ((failedSessions > 0U) || (sessions == 0U))
+    {
+      result = EXIT_FAILURE;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+//********************************** end of main.cpp ************************************
@@ -0,0 +1,341 @@
+///**************************************************************************************
+/// \file         mockboard.hpp
+/// \brief        Mock board drivers for running the application on the host header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef MOCKBOARD_HPP
+#define MOCKBOARD_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "can.hpp"
+#include "usbdevice.hpp"
+#include "boot.hpp"
+#include "storage.hpp"
+#include "led.hpp"
+#include "microtbx.h"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Mock CAN driver class.
+/// \details Instead of placing them on a CAN bus, the driver collects the transmitted
+///          messages, such that the caller can pass them on to a simulated node with
+///          popTransmitted(). Method receive() hands a message from the simulated node
+///          to the event handlers, just like the reception interrupt and the task of
+///          a real driver would. The caller sets the message's reception timestamp.
+///          The driver connects right away and never loses an arbitration or
+///          acknowledge.
+class MockCan final : public Can
+{
+public:
+  // Enumerations.
+  enum Path : uint8_t
+  {
+    PATHNONE,  ///< Message was rejected by the acceptance filters.
+    PATHISR,   ///< Message was fully handled by onReceivedFromISR.
+    PATHTASK   ///< Message was handled by onReceived.
+  };
+  // Constants.
+  static constexpr size_t c_FilterBankCount = 14U;
+  static constexpr size_t c_TxFramesMax = 16U;
+  // Constructors and destructor.
+  explicit MockCan() : Can() { }
+  virtual ~MockCan() { }
+  // Getters and setters.
+  size_t filterBankCount() const override { return c_FilterBankCount; }
+  void setFilter(CanFilter& t_Filter) override
+  {
+    m_FilterSet.clear();
+    if (t_Filter.mode != CanFilter::EXT)
+    {
+      (void)m_FilterSet.addMask(t_Filter.code, t_Filter.mask, TBX_FALSE);
+    }
+    if (t_Filter.mode != CanFilter::STD)
+    {
+      (void)m_FilterSet.addMask(t_Filter.code, t_Filter.mask, TBX_TRUE);
+    }
+  }
+  uint8_t setFilterSet(CanFilterSet const& t_FilterSet) override
+  {
+    m_FilterSet = t_FilterSet;
+    return TBX_OK;
+  }
+  size_t txPendingCount() const override { return m_TxCount; }
+  // Methods.
+  void connect(Baudrate t_Baudrate = BR500K) override
+  {
+    TBX_UNUSED_ARG(t_Baudrate);
+    m_Connected = TBX_TRUE;
+    // Trigger the event handler, if assigned.
+    if (onConnected)
+    {
+      onConnected();
+    }
+  }
+  void disconnect() override { m_Connected = TBX_FALSE; }
+  uint8_t transmit(CanMsg& t_Msg) override
+  {
+    uint8_t result = TBX_ERROR;
+
+    // Only accept the message while connected and if there is space for it.
+    if ((m_Connected == TBX_TRUE) && (m_TxCount < c_TxFramesMax))
+    {
+      m_TxFrames[(m_TxFirst + m_TxCount) % c_TxFramesMax] = t_Msg;
+      m_TxCount++;
+      result = TBX_OK;
+    }
+    // Give the result back to the caller.
+    return result;
+  }
+  uint8_t popTransmitted(CanMsg& t_Msg)
+  {
+    uint8_t result = TBX_ERROR;
+
+    // Only continue if a transmitted message is available.
+    if (m_TxCount > 0U)
+    {
+      t_Msg = m_TxFrames[m_TxFirst];
+      m_TxFirst = (m_TxFirst + 1U) % c_TxFramesMax;
+      m_TxCount--;
+      result = TBX_OK;
+    }
+    // Give the result back to the caller.
+    return result;
+  }
+  Path receive(CanMsg& t_Msg)
+  {
+    Path result = PATHNONE;
+
+    // Only continue if the message passes the acceptance filters.
+    if (accepted(t_Msg) == TBX_TRUE)
+    {
+      result = PATHTASK;
+      // Offer the message to the interrupt level event handler first, if assigned.
+      if (onReceivedFromISR)
+      {
+        if (onReceivedFromISR(t_Msg) == TBX_TRUE)
+        {
+          result = PATHISR;
+        }
+      }
+      // Pass it on to the task level event handler, if not yet handled.
+      if ((result == PATHTASK) && (onReceived))
+      {
+        onReceived(t_Msg);
+      }
+    }
+    // Give the result back to the caller.
+    return result;
+  }
+
+private:
+  // Members.
+  CanFilterSet m_FilterSet{ };
+  uint8_t m_Connected{TBX_FALSE};
+  std::array<CanMsg, c_TxFramesMax> m_TxFrames;
+  size_t m_TxFirst{0U};
+  size_t m_TxCount{0U};
+  // Methods.
+  uint8_t accepted(CanMsg& t_Msg) const
+  {
+    uint8_t result = TBX_FALSE;
+
+    // Check the message against all entries of the filter set.
+    for (size_t idx = 0U; idx < m_FilterSet.size(); idx++)
+    {
+      if ((m_FilterSet[idx].ext == t_Msg.ext()) &&
+          ((t_Msg.id() & m_FilterSet[idx].mask) == m_FilterSet[idx].code))
+      {
+        result = TBX_TRUE;
+      }
+    }
+    // Give the result back to the caller.
+    return result;
+  }
+};
+
+
+/// \brief   Mock USB device driver class.
+/// \details Collects the data transmitted to the host, such that the caller can read
+///          it with popTransmitted(). Method receive() hands data from the host to the
+///          event handler, just like the USB task of a real driver would. The caller
+///          decides on the reception timestamp.
+class MockUsbDevice final : public UsbDevice
+{
+public:
+  // Constants.
+  static constexpr size_t c_TxBufferSize = 512U;
+  // Constructors and destructor.
+  explicit MockUsbDevice() : UsbDevice() { }
+  virtual ~MockUsbDevice() { }
+  // Methods.
+  uint8_t transmit(uint8_t const t_Data[], uint32_t t_Len) override
+  {
+    uint8_t result = TBX_ERROR;
+
+    // Only accept the data if there is space for it.
+    if ((m_TxLen + t_Len) <= c_TxBufferSize)
+    {
+      std::memcpy(&m_TxBuffer[m_TxLen], t_Data, t_Len);
+      m_TxLen += t_Len;
+      result = TBX_OK;
+    }
+    // Give the result back to the caller.
+    return result;
+  }
+  uint8_t transmitFromISR(uint8_t const t_Data[], uint32_t t_Len) override
+  {
+    return transmit(t_Data, t_Len);
+  }
+  size_t popTransmitted(uint8_t t_Data[], size_t t_Size)
+  {
+    size_t result = (m_TxLen <= t_Size) ? m_TxLen : t_Size;
+
+    // Copy the data and keep the remainder, if any.
+    std::memcpy(t_Data, m_TxBuffer.data(), result);
+    std::memmove(m_TxBuffer.data(), &m_TxBuffer[result], m_TxLen - result);
+    m_TxLen -= result;
+    // Give the result back to the caller.
+    return result;
+  }
+  void receive(uint8_t const t_Data[], uint32_t t_Len, uint32_t t_Timestamp)
+  {
+    // Trigger the event handler, if assigned.
+    if (onDataReceived)
+    {
+      onDataReceived(t_Data, t_Len, t_Timestamp);
+    }
+  }
+
+private:
+  // Members.
+  std::array<uint8_t, c_TxBufferSize> m_TxBuffer{ };
+  size_t m_TxLen{0U};
+};
+
+
+/// \brief Mock bootloader interaction class. There is no bootloader on the host.
+class MockBoot final : public Boot
+{
+public:
+  // Constructors and destructor.
+  explicit MockBoot() : Boot() { }
+  virtual ~MockBoot() { }
+  // Methods.
+  uint8_t detectLoader() override { return TBX_FALSE; }
+  void activateLoader() override { }
+};
+
+
+/// \brief Mock non-volatile storage driver class, backed by RAM.
+class MockStorage final : public Storage
+{
+public:
+  // Constants.
+  static constexpr size_t c_Size = 128U * 1024U;
+  // Constructors and destructor.
+  explicit MockStorage() : Storage(), m_Data(c_Size, 0xFFU) { }
+  virtual ~MockStorage() { }
+  // Methods.
+  uint8_t erase() override
+  {
+    std::fill(m_Data.begin(), m_Data.end(), 0xFFU);
+    return TBX_OK;
+  }
+  uint8_t write(size_t t_Offset, uint8_t const t_Data[], size_t t_Len) override
+  {
+    uint8_t result = TBX_ERROR;
+
+    // Only write aligned and within the storage.
+    if (((t_Offset % c_WriteAlign) == 0U) && (t_Len <= c_Size) &&
+        (t_Offset <= (c_Size - t_Len)))
+    {
+      std::memcpy(&m_Data[t_Offset], t_Data, t_Len);
+      result = TBX_OK;
+    }
+    // Give the result back to the caller.
+    return result;
+  }
+  uint8_t read(size_t t_Offset, uint8_t t_Data[], size_t t_Len) const override
+  {
+    uint8_t result = TBX_ERROR;
+
+    // Only read within the storage.
+    if ((t_Len <= c_Size) && (t_Offset <= (c_Size - t_Len)))
+    {
+      std::memcpy(t_Data, &m_Data[t_Offset], t_Len);
+      result = TBX_OK;
+    }
+    // Give the result back to the caller.
+    return result;
+  }
+  // Getters and setters.
+  size_t size() const override { return c_Size; }
+
+private:
+  // Members.
+  std::vector<uint8_t> m_Data;
+};
+
+
+/// \brief Mock LED driver class. Counts the state changes.
+class MockLed final : public Led
+{
+public:
+  // Constructors and destructor.
+  explicit MockLed() : Led() { }
+  virtual ~MockLed() { }
+  // Getters and setters.
+  uint32_t changes() const { return m_Changes; }
+
+private:
+  // Members.
+  uint32_t m_Changes{0U};
+  // Getters and setters.
+  void set(uint8_t t_State) override
+  {
+    TBX_UNUSED_ARG(t_State);
+    m_Changes++;
+  }
+};
+
+#endif // MOCKBOARD_HPP
+//********************************** end of mockboard.hpp *******************************
@@ -0,0 +1,71 @@
+///**************************************************************************************
+/// \file         FreeRTOS.h
+/// \brief        Host shim of the FreeRTOS types and macros used by the application.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+
+
+//***************************************************************************************
+// Macro definitions
+//***************************************************************************************
+/// \brief Boolean true value.
+#define pdTRUE                         (1)
+/// \brief Boolean false value.
+#define pdFALSE                        (0)
+/// \brief Block without a timeout.
+#define portMAX_DELAY                  (static_cast<TickType_t>(0xFFFFFFFFUL))
+/// \brief Task stack size in words. Only kept for source compatibility, as the host
+///        threads use their default stack size.
+#define configMINIMAL_STACK_SIZE       (128U)
+/// \brief Tick frequency. One tick per millisecond, like on the board.
+#define configTICK_RATE_HZ             (1000U)
+
+
+//***************************************************************************************
+// Type definitions
+//***************************************************************************************
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef void * TaskHandle_t;
+
+
+#endif // FREERTOS_H
+//********************************** end of FreeRTOS.h **********************************
@@ -0,0 +1,279 @@
+///**************************************************************************************
+/// \file         freertos.cpp
+/// \brief        Host shim of the FreeRTOS interface used by the application source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <thread>
+#include <chrono>
+#include "thread.hpp"
+#include "semaphore.hpp"
+#include "microtbx.h"
+
+
+//***************************************************************************************
+// Local data declarations
+//***************************************************************************************
+/// \brief Task notification state of the calling thread. Only set for threads that
+///        were started with Thread::Start().
+static thread_local cpp_freertos::Thread::NotifyState * currentNotifyState = nullptr;
+
+
+///**************************************************************************************
+/// \brief     Waits for a notification of the calling thread.
+/// \param     xClearCountOnExit pdTRUE to clear the notification count, pdFALSE to
+///            just decrement it.
+/// \param     xTicksToWait Maximum number of ticks to wait.
+/// \return    The notification count, before it was cleared or decremented.
+///
+///**************************************************************************************
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+  uint32_t result = 0U;
+
+  // Only continue if the calling thread has a notification state.
+  if (currentNotifyState != nullptr)
+  {
+    std::unique_lock<std::mutex> lock(currentNotifyState->mutex);
+    auto notified = [] { return currentNotifyState->count > 0U; };
+    // Wait for the notification.
+    currentNotifyState->waiting = true;
+    currentNotifyState->condition.notify_all();
+    if (xTicksToWait == portMAX_DELAY)
+    {
+      currentNotifyState->condition.wait(lock, notified);
+    }
+    else
+    {
+      (void)currentNotifyState->condition.wait_for(
+        lock, std::chrono::milliseconds{xTicksToWait}, notified);
+    }
+    currentNotifyState->waiting = false;
+    result = currentNotifyState->count;
+    // Update the notification count.
+    if (result > 0U)
+    {
+      currentNotifyState->count = (xClearCountOnExit != pdFALSE) ? 0U : result - 1U;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Notifies a thread.
+/// \param     xTaskToNotify Handle of the thread to notify.
+/// \return    pdTRUE.
+///
+///**************************************************************************************
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+  auto notifyState = static_cast<cpp_freertos::Thread::NotifyState *>(xTaskToNotify);
+
+  // Increment the notification count and wake up the thread.
+  {
+    std::lock_guard<std::mutex> lock(notifyState->mutex);
+    notifyState->count++;
+  }
+  notifyState->condition.notify_all();
+  // Give the result back to the caller.
+  return pdTRUE;
+}
+
+
+namespace cpp_freertos {
+
+///**************************************************************************************
+/// \brief     Thread constructor.
+/// \param     t_Name Name of the thread. Unused.
+/// \param     t_StackDepth Stack depth in words. Unused.
+/// \param     t_Priority Priority of the thread. Unused.
+///
+///**************************************************************************************
+Thread::Thread(const char * t_Name, uint16_t t_StackDepth, UBaseType_t t_Priority)
+  : m_NotifyState(std::make_shared<NotifyState>())
+{
+  TBX_UNUSED_ARG(t_Name);
+  TBX_UNUSED_ARG(t_StackDepth);
+  TBX_UNUSED_ARG(t_Priority);
+}
+
+
+///**************************************************************************************
+/// \brief     Thread destructor. Waits until the host thread waits for a notification,
+///            if it was started.
+///
+///**************************************************************************************
+Thread::~Thread()
+{
+  std::unique_lock<std::mutex> lock(m_NotifyState->mutex);
+
+  // Wait until the host thread no longer accesses the object.
+  if (m_Started)
+  {
+    m_NotifyState->condition.wait(lock, [this] { return m_NotifyState->waiting; });
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Starts the thread, which then calls the Run() method. Returns once the
+///            thread waits for its first notification.
+/// \return    True.
+///
+///**************************************************************************************
+bool Thread::Start()
+{
+  std::shared_ptr<NotifyState> notifyState = m_NotifyState;
+
+  // Start the host thread. It keeps its own reference to the notification state.
+  std::thread hostThread([this, notifyState]
+  {
+    currentNotifyState = notifyState.get();
+    Run();
+  });
+  hostThread.detach();
+  m_Started = true;
+  // Wait until the host thread waits for its first notification.
+  {
+    std::unique_lock<std::mutex> lock(notifyState->mutex);
+    notifyState->condition.wait(lock, [&notifyState] { return notifyState->waiting; });
+  }
+  // Give the result back to the caller.
+  return true;
+}
+
+
+///**************************************************************************************
+/// \brief     Delays the calling thread.
+/// \param     t_Delay Number of ticks to delay.
+///
+///**************************************************************************************
+void Thread::Delay(const TickType_t t_Delay)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds{t_Delay});
+}
+
+
+///**************************************************************************************
+/// \brief     Delays the calling thread until the next period elapsed, relative to the
+///            previous wake up time.
+/// \param     t_Period Period in ticks.
+///
+///**************************************************************************************
+void Thread::DelayUntil(const TickType_t t_Period)
+{
+  auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch());
+
+  // Initialize the wake up time on the first call.
+  if (m_LastWakeTime == 0U)
+  {
+    m_LastWakeTime = static_cast<TickType_t>(now.count());
+  }
+  m_LastWakeTime += t_Period;
+  std::this_thread::sleep_until(std::chrono::steady_clock::time_point{
+    std::chrono::milliseconds{m_LastWakeTime}});
+}
+
+
+///**************************************************************************************
+/// \brief     Takes the semaphore.
+/// \param     t_Timeout Maximum number of ticks to wait for the semaphore.
+/// \return    True if the semaphore was taken, false in case of a timeout.
+///
+///**************************************************************************************
+bool BinarySemaphore::Take(TickType_t t_Timeout)
+{
+  bool result = true;
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  auto given = [this] { return m_Set; };
+
+  // Wait for the semaphore to be given.
+  if (t_Timeout == portMAX_DELAY)
+  {
+    m_Condition.wait(lock, given);
+  }
+  else
+  {
+    result = m_Condition.wait_for(lock, std::chrono::milliseconds{t_Timeout}, given);
+  }
+  // Take it, if given.
+  if (result)
+  {
+    m_Set = false;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Gives the semaphore.
+/// \return    True if the semaphore was given, false if it was already given.
+///
+///**************************************************************************************
+bool BinarySemaphore::Give()
+{
+  bool result;
+
+  // Give the semaphore and wake up a waiting thread.
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    result = !m_Set;
+    m_Set = true;
+  }
+  m_Condition.notify_one();
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Gives the semaphore from interrupt context.
+/// \param     t_HigherPriorityTaskWoken Unused.
+/// \return    True if the semaphore was given, false if it was already given.
+///
+///**************************************************************************************
+bool BinarySemaphore::GiveFromISR(BaseType_t * t_HigherPriorityTaskWoken)
+{
+  TBX_UNUSED_ARG(t_HigherPriorityTaskWoken);
+  return Give();
+}
+
+}
+//********************************** end of freertos.cpp ********************************
@@ -0,0 +1,205 @@
+///**************************************************************************************
+/// \file         microtbx.cpp
+/// \brief        Host shim of the MicroTBX interface used by the application source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include "microtbx.h"
+
+
+//***************************************************************************************
+// Type definitions
+//***************************************************************************************
+/// \brief Linked list, stored as a vector of item pointers.
+struct t_tbx_list
+{
+  std::vector<void *> items;
+};
+
+
+//***************************************************************************************
+// Local data declarations
+//***************************************************************************************
+/// \brief Mutex that takes the place of disabling the interrupts. Recursive, because
+///        MicroTBX critical sections can be nested.
+static std::recursive_mutex criticalSectionMutex;
+
+
+///**************************************************************************************
+/// \brief     Reports a failed run-time assertion and aborts the program.
+/// \param     file The filename of the source file where the assertion occurred in.
+/// \param     line The line number inside the file where the assertion occurred.
+///
+///**************************************************************************************
+extern "C" void TbxAssertTrigger(const char * const file, uint32_t line)
+{
+  std::fprintf(stderr, "Assertion failed in %s at line %u.\n", file,
+               static_cast<unsigned int>(line));
+  std::abort();
+}
+
+
+///**************************************************************************************
+/// \brief     Enters a critical section.
+///
+///**************************************************************************************
+extern "C" void TbxCriticalSectionEnter(void)
+{
+  criticalSectionMutex.lock();
+}
+
+
+///**************************************************************************************
+/// \brief     Exits a critical section.
+///
+///**************************************************************************************
+extern "C" void TbxCriticalSectionExit(void)
+{
+  criticalSectionMutex.unlock();
+}
+
+
+///**************************************************************************************
+/// \brief     Creates a new and empty linked list.
+/// \return    Pointer to the newly created list.
+///
+///**************************************************************************************
+extern "C" tTbxList * TbxListCreate(void)
+{
+  return new t_tbx_list;
+}
+
+
+///**************************************************************************************
+/// \brief     Deletes a linked list. The items themselves are not deleted.
+/// \param     list Pointer to the list.
+///
+///**************************************************************************************
+extern "C" void TbxListDelete(tTbxList * list)
+{
+  delete list;
+}
+
+
+///**************************************************************************************
+/// \brief     Appends an item to the end of the list.
+/// \param     list Pointer to the list.
+/// \param     item Pointer to the item.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+extern "C" uint8_t TbxListInsertItemBack(tTbxList * list, void * item)
+{
+  uint8_t result = TBX_ERROR;
+
+  // Only continue with valid parameters.
+  if ((list != nullptr) && (item != nullptr))
+  {
+    list->items.push_back(item);
+    result = TBX_OK;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Removes an item from the list, if present.
+/// \param     list Pointer to the list.
+/// \param     item Pointer to the item.
+///
+///**************************************************************************************
+extern "C" void TbxListRemoveItem(tTbxList * list, void const * item)
+{
+  // Only continue with a valid list.
+  if (list != nullptr)
+  {
+    list->items.erase(std::remove(list->items.begin(), list->items.end(), item),
+                      list->items.end());
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Obtains the first item of the list.
+/// \param     list Pointer to the list.
+/// \return    Pointer to the first item or nullptr if the list is empty.
+///
+///**************************************************************************************
+extern "C" void * TbxListGetFirstItem(tTbxList const * list)
+{
+  void * result = nullptr;
+
+  // Only continue with a valid and non-empty list.
+  if ((list != nullptr) && (!list->items.empty()))
+  {
+    result = list->items.front();
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Obtains the item that follows the specified item in the list.
+/// \param     list Pointer to the list.
+/// \param     itemRef Pointer to the item that serves as the reference.
+/// \return    Pointer to the next item or nullptr if there is none.
+///
+///**************************************************************************************
+extern "C" void * TbxListGetNextItem(tTbxList const * list, void const * itemRef)
+{
+  void * result = nullptr;
+
+  // Only continue with a valid list.
+  if (list != nullptr)
+  {
+    auto it = std::find(list->items.begin(), list->items.end(), itemRef);
+    // Only continue if the reference item was found and it is not the last one.
+    if ((it != list->items.end()) && ((it + 1) != list->items.end()))
+    {
+      result = *(it + 1);
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+//********************************** end of microtbx.cpp ********************************
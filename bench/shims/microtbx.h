@@ -0,0 +1,96 @@
+///**************************************************************************************
+/// \file         microtbx.h
+/// \brief        Host shim of the MicroTBX interface used by the application.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef MICROTBX_H
+#define MICROTBX_H
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include <cstddef>
+
+
+//***************************************************************************************
+// Macro definitions
+//***************************************************************************************
+/// \brief Boolean true value.
+#define TBX_TRUE                       (1U)
+/// \brief Boolean false value.
+#define TBX_FALSE                      (0U)
+/// \brief Generic okay value.
+#define TBX_OK                         (1U)
+/// \brief Generic error value.
+#define TBX_ERROR                      (0U)
+/// \brief Generic on value.
+#define TBX_ON                         (1U)
+/// \brief Generic off value.
+#define TBX_OFF                        (0U)
+
+/// \brief Macro to flag a function parameter as unused.
+#define TBX_UNUSED_ARG(x)              (void)(x)
+
+/// \brief Run-time assertion. Unlike on the board, a failed assertion aborts the
+///        program after reporting the location.
+#define TBX_ASSERT(cond)               do { if (!(cond)) { TbxAssertTrigger(__FILE__, \
+                                       __LINE__); } } while (0)
+
+
+//***************************************************************************************
+// Type definitions
+//***************************************************************************************
+extern "C"
+{
+/// \brief Opaque linked list type.
+typedef struct t_tbx_list tTbxList;
+
+
+//***************************************************************************************
+// Function prototypes
+//***************************************************************************************
+void TbxAssertTrigger(const char * const file, uint32_t line);
+void TbxCriticalSectionEnter(void);
+void TbxCriticalSectionExit(void);
+tTbxList * TbxListCreate(void);
+void TbxListDelete(tTbxList * list);
+uint8_t TbxListInsertItemBack(tTbxList * list, void * item);
+void TbxListRemoveItem(tTbxList * list, void const * item);
+void * TbxListGetFirstItem(tTbxList const * list);
+void * TbxListGetNextItem(tTbxList const * list, void const * itemRef);
+}
+
+
+#endif // MICROTBX_H
+//********************************** end of microtbx.h **********************************
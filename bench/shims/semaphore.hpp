@@ -0,0 +1,79 @@
+///**************************************************************************************
+/// \file         semaphore.hpp
+/// \brief        Host shim of the FreeRTOS C++ wrapper's semaphore classes.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef SEMAPHORE_HPP
+#define SEMAPHORE_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <mutex>
+#include <condition_variable>
+#include "FreeRTOS.h"
+
+
+namespace cpp_freertos {
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief Binary semaphore class.
+class BinarySemaphore
+{
+public:
+  // Constructors and destructor.
+  explicit BinarySemaphore(bool t_Set = false) : m_Set(t_Set) { }
+  virtual ~BinarySemaphore() { }
+  // Methods.
+  bool Take(TickType_t t_Timeout = portMAX_DELAY);
+  bool Give();
+  bool GiveFromISR(BaseType_t * t_HigherPriorityTaskWoken);
+
+private:
+  // Members.
+  std::mutex m_Mutex;
+  std::condition_variable m_Condition;
+  bool m_Set;
+
+  // Flag the class as non-copyable.
+  BinarySemaphore(const BinarySemaphore&) = delete;
+  const BinarySemaphore& operator=(const BinarySemaphore&) = delete;
+};
+
+}
+
+
+#endif // SEMAPHORE_HPP
+//********************************** end of semaphore.hpp *******************************
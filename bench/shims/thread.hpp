@@ -0,0 +1,107 @@
+///**************************************************************************************
+/// \file         thread.hpp
+/// \brief        Host shim of the FreeRTOS C++ wrapper's thread class.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef THREAD_HPP
+#define THREAD_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include "FreeRTOS.h"
+#include "task.h"
+
+
+namespace cpp_freertos {
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Thread class, built on a detached host thread.
+/// \details The task notification state lives in a shared object, which the host
+///          thread keeps alive. This way a thread that still waits for a notification,
+///          when its Thread object is destroyed, does not access freed memory. Both
+///          Start() and the destructor wait until the host thread waits for a
+///          notification. This way the object is not destroyed before or while Run()
+///          accesses it. Consequently, Run() should wait for a notification before
+///          anything else, as the XCP loader does. The stack depth and priority are
+///          only kept for source compatibility.
+class Thread
+{
+public:
+  // Classes.
+  /// \brief Task notification state of a thread.
+  class NotifyState
+  {
+  public:
+    // Members.
+    std::mutex mutex;
+    std::condition_variable condition;
+    uint32_t count{0U};
+    bool waiting{false};
+  };
+  // Constructors and destructor.
+  explicit Thread(const char * t_Name, uint16_t t_StackDepth, UBaseType_t t_Priority);
+  virtual ~Thread();
+  // Methods.
+  bool Start();
+  // Getters and setters.
+  TaskHandle_t GetHandle() { return m_NotifyState.get(); }
+
+protected:
+  // Methods.
+  virtual void Run() = 0;
+  static void Delay(const TickType_t t_Delay);
+  void DelayUntil(const TickType_t t_Period);
+
+private:
+  // Members.
+  std::shared_ptr<NotifyState> m_NotifyState;
+  bool m_Started{false};
+  TickType_t m_LastWakeTime{0U};
+
+  // Flag the class as non-copyable.
+  Thread(const Thread&) = delete;
+  const Thread& operator=(const Thread&) = delete;
+};
+
+}
+
+
+#endif // THREAD_HPP
+//********************************** end of thread.hpp **********************************
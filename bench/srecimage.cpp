@@ -0,0 +1,223 @@
+///**************************************************************************************
+/// \file         srecimage.cpp
+/// \brief        Firmware image from a Motorola S-record file source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdio>
+#include <array>
+#include "srecimage.hpp"
+#include "microtbx.h"
+
+
+///**************************************************************************************
+/// \brief     Loads the image from a Motorola S-record file. Replaces the segments
+///            of a previously loaded image.
+/// \param     t_Stream Stream with the contents of the S-record file.
+/// \return    TBX_OK if successful, TBX_ERROR if the file has no data records or holds
+///            an invalid data record.
+///
+///**************************************************************************************
+uint8_t SrecImage::load(std::istream& t_Stream)
+{
+  uint8_t result = TBX_OK;
+  std::string line;
+
+  // Start with an empty image.
+  m_Segments.clear();
+  // Process the file line by line.
+  while ((result == TBX_OK) && (std::getline(t_Stream, line)))
+  {
+    result = parseLine(line);
+  }
+  // An image without any data is not valid either.
+  if (m_Segments.empty())
+  {
+    result = TBX_ERROR;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Creates the contents of an S-record file with a single segment of pseudo
+///            random data. The data is the same on each call.
+/// \param     t_Address Start address of the segment.
+/// \param     t_Len Number of bytes in the segment.
+/// \return    Contents of the S-record file.
+///
+///**************************************************************************************
+std::string SrecImage::generate(uint32_t t_Address, size_t t_Len)
+{
+  std::string result = "S00600004844521B\n";
+  std::array<char, 8U> hexByte;
+  uint32_t random = 0x2545F491UL;
+  size_t idx = 0U;
+
+  // Create S3 data records, until all data is covered.
+  while (idx < t_Len)
+  {
+    size_t dataLen = ((t_Len - idx) < c_RecordDataLen) ? (t_Len - idx) : c_RecordDataLen;
+    uint32_t address = t_Address + static_cast<uint32_t>(idx);
+    // Byte count, address, data and checksum.
+    uint8_t byteCount = static_cast<uint8_t>(dataLen + 5U);
+    uint8_t checksum = byteCount;
+
+    result += "S3";
+    (void)std::snprintf(hexByte.data(), hexByte.size(), "%02X", byteCount);
+    result += hexByte.data();
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+      uint8_t addressByte = static_cast<uint8_t>(address >> shift);
+      (void)std::snprintf(hexByte.data(), hexByte.size(), "%02X", addressByte);
+      result += hexByte.data();
+      checksum += addressByte;
+    }
+    for (size_t dataIdx = 0U; dataIdx < dataLen; dataIdx++)
+    {
+      // Xorshift pseudo random number generator.
+      random ^= random << 13U;
+      random ^= random >> 17U;
+      random ^= random << 5U;
+      uint8_t dataByte = static_cast<uint8_t>(random);
+      (void)std::snprintf(hexByte.data(), hexByte.size(), "%02X", dataByte);
+      result += hexByte.data();
+      checksum += dataByte;
+    }
+    (void)std::snprintf(hexByte.data(), hexByte.size(), "%02X",
+                        static_cast<uint8_t>(~checksum));
+    result += hexByte.data();
+    result += "\n";
+    idx += dataLen;
+  }
+  // Add the termination record.
+  result += "S70500000000FA\n";
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Obtains the total number of data bytes in the image.
+/// \return    Number of data bytes.
+///
+///**************************************************************************************
+size_t SrecImage::size() const
+{
+  size_t result = 0U;
+
+  // Add up the sizes of all segments.
+  for (auto const& segment : m_Segments)
+  {
+    result += segment.data.size();
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Parses a single line of an S-record file. Only the S1, S2 and S3 data
+///            records are processed. All other lines are ignored.
+/// \param     t_Line The line to parse.
+/// \return    TBX_OK if successful, TBX_ERROR if it is an invalid data record.
+///
+///**************************************************************************************
+uint8_t SrecImage::parseLine(std::string const& t_Line)
+{
+  uint8_t result = TBX_OK;
+
+  // Is it a data record?
+  if ((t_Line.size() >= 2U) && (t_Line[0] == 'S') && (t_Line[1] >= '1') &&
+      (t_Line[1] <= '3'))
+  {
+    size_t addressLen = static_cast<size_t>(t_Line[1] - '1') + 2U;
+    std::vector<uint8_t> bytes;
+    uint8_t checksum = 0U;
+
+    // Convert the hexadecimal characters after the record type to bytes.
+    for (size_t idx = 2U; (idx + 1U) < t_Line.size(); idx += 2U)
+    {
+      unsigned int value;
+      if (std::sscanf(&t_Line[idx], "%2x", &value) == 1)
+      {
+        bytes.push_back(static_cast<uint8_t>(value));
+        checksum += static_cast<uint8_t>(value);
+      }
+    }
+    // Check the byte count and the checksum. The byte count covers the address, the
+    // data and the checksum.
+    if ((bytes.size() < (addressLen + 2U)) || (bytes[0] != (bytes.size() - 1U)) ||
+        (checksum != 0xFFU))
+    {
+      result = TBX_ERROR;
+    }
+    else
+    {
+      uint32_t address = 0U;
+      for (size_t idx = 1U; idx <= addressLen; idx++)
+      {
+        address = (address << 8U) | bytes[idx];
+      }
+      addData(address, &bytes[addressLen + 1U], bytes.size() - addressLen - 2U);
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Adds data to the image. It is appended to the last segment, if it directly
+///            follows it. Otherwise it starts a new segment.
+/// \param     t_Address Start address of the data.
+/// \param     t_Data Byte array with the data.
+/// \param     t_Len Number of bytes to add.
+///
+///**************************************************************************************
+void SrecImage::addData(uint32_t t_Address, uint8_t const t_Data[], size_t t_Len)
+{
+  // Start a new segment, unless the data directly follows the last one.
+  if ((m_Segments.empty()) ||
+      ((m_Segments.back().address + m_Segments.back().data.size()) != t_Address))
+  {
+    m_Segments.push_back(Segment{t_Address, { }});
+  }
+  // Append the data to the last segment.
+  m_Segments.back().data.insert(m_Segments.back().data.end(), t_Data, t_Data + t_Len);
+}
+//********************************** end of srecimage.cpp *******************************
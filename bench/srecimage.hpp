@@ -0,0 +1,88 @@
+///**************************************************************************************
+/// \file         srecimage.hpp
+/// \brief        Firmware image from a Motorola S-record file header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef SRECIMAGE_HPP
+#define SRECIMAGE_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <istream>
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Firmware image class, loaded from a Motorola S-record file.
+/// \details The data records of the file are merged into segments of consecutive
+///          memory. Method generate() creates the contents of an S-record file with
+///          pseudo random data, for when no actual firmware file is at hand.
+class SrecImage
+{
+public:
+  // Classes.
+  /// \brief Segment of consecutive memory.
+  class Segment
+  {
+  public:
+    // Members.
+    uint32_t address;
+    std::vector<uint8_t> data;
+  };
+  // Constructors and destructor.
+  explicit SrecImage() { }
+  virtual ~SrecImage() { }
+  // Methods.
+  uint8_t load(std::istream& t_Stream);
+  static std::string generate(uint32_t t_Address, size_t t_Len);
+  // Getters and setters.
+  std::vector<Segment> const& segments() const { return m_Segments; }
+  size_t size() const;
+
+private:
+  // Constants.
+  static constexpr size_t c_RecordDataLen = 32U;
+  // Members.
+  std::vector<Segment> m_Segments;
+  // Methods.
+  uint8_t parseLine(std::string const& t_Line);
+  void addData(uint32_t t_Address, uint8_t const t_Data[], size_t t_Len);
+};
+
+#endif // SRECIMAGE_HPP
+//********************************** end of srecimage.hpp *******************************
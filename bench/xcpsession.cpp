@@ -0,0 +1,146 @@
+///**************************************************************************************
+/// \file         xcpsession.cpp
+/// \brief        XCP firmware update session of an OpenBLT host source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <algorithm>
+#include "xcpsession.hpp"
+
+
+///**************************************************************************************
+/// \brief     XCP firmware update session constructor.
+/// \param     t_Image The firmware image to program on the target.
+///
+///**************************************************************************************
+XcpSession::XcpSession(SrecImage const& t_Image)
+{
+  // Connect to the target and start the programming sequence.
+  addPacket({ c_XcpCmdConnect, 0U });
+  addPacket({ c_XcpCmdProgramStart });
+  // Erase the memory of all segments first.
+  for (auto const& segment : t_Image.segments())
+  {
+    addValuePacket(c_XcpCmdSetMta, segment.address);
+    addValuePacket(c_XcpCmdProgramClear, static_cast<uint32_t>(segment.data.size()));
+  }
+  // Program the segments block by block.
+  for (auto const& segment : t_Image.segments())
+  {
+    for (size_t offset = 0U; offset < segment.data.size(); offset += c_BlockSize)
+    {
+      size_t len = std::min(c_BlockSize, segment.data.size() - offset);
+      addValuePacket(c_XcpCmdSetMta, segment.address + static_cast<uint32_t>(offset));
+      addProgramPackets(&segment.data[offset], len);
+    }
+  }
+  // End the programming sequence and start the new firmware.
+  addPacket({ c_XcpCmdProgram, 0U });
+  addPacket({ c_XcpCmdProgramReset }, TBX_FALSE);
+}
+
+
+///**************************************************************************************
+/// \brief     Adds an XCP command packet to the session.
+/// \param     t_Data The packet data.
+/// \param     t_Response TBX_TRUE if the host expects a response, TBX_FALSE otherwise.
+///
+///**************************************************************************************
+void XcpSession::addPacket(std::initializer_list<uint8_t> t_Data,
+                           uint8_t t_Response)
+{
+  Packet packet{ static_cast<uint8_t>(t_Data.size()), { }, t_Response };
+
+  std::copy(t_Data.begin(), t_Data.end(), packet.data.begin());
+  m_Packets.push_back(packet);
+}
+
+
+///**************************************************************************************
+/// \brief     Adds an XCP command packet, which carries a 32-bit value in its last four
+///            bytes, such as SET_MTA and PROGRAM_CLEAR.
+/// \param     t_Command The XCP command code.
+/// \param     t_Value The value.
+///
+///**************************************************************************************
+void XcpSession::addValuePacket(uint8_t t_Command, uint32_t t_Value)
+{
+  addPacket({ t_Command, 0U, 0U, 0U,
+              static_cast<uint8_t>(t_Value), static_cast<uint8_t>(t_Value >> 8U),
+              static_cast<uint8_t>(t_Value >> 16U),
+              static_cast<uint8_t>(t_Value >> 24U) });
+}
+
+
+///**************************************************************************************
+/// \brief     Adds the XCP command packets for programming data at the current memory
+///            transfer address. Full packets use PROGRAM_MAX and the remainder PROGRAM.
+/// \param     t_Data Byte array with the data.
+/// \param     t_Len Number of bytes to program.
+///
+///**************************************************************************************
+void XcpSession::addProgramPackets(uint8_t const t_Data[], size_t t_Len)
+{
+  constexpr size_t programMaxLen = CanMsg::c_DataLenMax - 1U;
+  constexpr size_t programLenMax = CanMsg::c_DataLenMax - 2U;
+  size_t idx = 0U;
+
+  // Add packets until all data is covered.
+  while (idx < t_Len)
+  {
+    Packet packet{ 0U, { }, TBX_TRUE };
+    // Full packet?
+    if ((t_Len - idx) >= programMaxLen)
+    {
+      packet.len = CanMsg::c_DataLenMax;
+      packet.data[0] = c_XcpCmdProgramMax;
+      std::copy_n(&t_Data[idx], programMaxLen, &packet.data[1]);
+      idx += programMaxLen;
+    }
+    // Remainder.
+    else
+    {
+      size_t len = std::min(programLenMax, t_Len - idx);
+      packet.len = static_cast<uint8_t>(len + 2U);
+      packet.data[0] = c_XcpCmdProgram;
+      packet.data[1] = static_cast<uint8_t>(len);
+      std::copy_n(&t_Data[idx], len, &packet.data[2]);
+      idx += len;
+    }
+    m_Packets.push_back(packet);
+  }
+}
+//********************************** end of xcpsession.cpp ******************************
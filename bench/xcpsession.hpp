@@ -0,0 +1,104 @@
+///**************************************************************************************
+/// \file         xcpsession.hpp
+/// \brief        XCP firmware update session of an OpenBLT host header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef XCPSESSION_HPP
+#define XCPSESSION_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <initializer_list>
+#include "can.hpp"
+#include "srecimage.hpp"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   XCP firmware update session class.
+/// \details Holds the XCP command packets that an OpenBLT host sends, to program a
+///          firmware image on the target. In order: CONNECT, PROGRAM_START, a SET_MTA
+///          and PROGRAM_CLEAR for each segment, a SET_MTA for each block of a
+///          segment followed by its data in PROGRAM_MAX packets and a PROGRAM packet
+///          for the remainder, an empty PROGRAM packet to end the programming and
+///          finally PROGRAM_RESET. Values are in Intel (little endian) byte order.
+///          The host waits for the response to a packet, before sending the next one.
+///          The gateway ends the session with the host upon PROGRAM_RESET, so it does
+///          not forward the target's response. Like an OpenBLT host, the session
+///          does not expect one.
+class XcpSession
+{
+public:
+  // Classes.
+  /// \brief XCP command packet.
+  class Packet
+  {
+  public:
+    // Members.
+    uint8_t len;
+    std::array<uint8_t, CanMsg::c_DataLenMax> data;
+    uint8_t response; ///< TBX_TRUE if the host expects a response.
+  };
+  // Constants.
+  static constexpr size_t c_BlockSize = 1024U;
+  // Constructors and destructor.
+  explicit XcpSession(SrecImage const& t_Image);
+  virtual ~XcpSession() { }
+  // Getters and setters.
+  std::vector<Packet> const& packets() const { return m_Packets; }
+
+private:
+  // Constants.
+  static constexpr uint8_t c_XcpCmdConnect = 0xFFU;
+  static constexpr uint8_t c_XcpCmdSetMta = 0xF6U;
+  static constexpr uint8_t c_XcpCmdProgramStart = 0xD2U;
+  static constexpr uint8_t c_XcpCmdProgramClear = 0xD1U;
+  static constexpr uint8_t c_XcpCmdProgram = 0xD0U;
+  static constexpr uint8_t c_XcpCmdProgramReset = 0xCFU;
+  static constexpr uint8_t c_XcpCmdProgramMax = 0xC9U;
+  // Members.
+  std::vector<Packet> m_Packets;
+  // Methods.
+  void addPacket(std::initializer_list<uint8_t> t_Data,
+                 uint8_t t_Response = TBX_TRUE);
+  void addValuePacket(uint8_t t_Command, uint32_t t_Value);
+  void addProgramPackets(uint8_t const t_Data[], size_t t_Len);
+};
+
+#endif // XCPSESSION_HPP
+//********************************** end of xcpsession.hpp ******************************
@@ -0,0 +1,268 @@
+///**************************************************************************************
+/// \file         xcptarget.cpp
+/// \brief        Simulated OpenBLT target source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstring>
+#include <algorithm>
+#include "xcptarget.hpp"
+
+
+///**************************************************************************************
+/// \brief     Simulated OpenBLT target constructor.
+/// \param     t_MemoryBase Start address of the target's flash memory.
+/// \param     t_MemorySize Size of the target's flash memory in bytes.
+///
+///**************************************************************************************
+XcpTarget::XcpTarget(uint32_t t_MemoryBase, size_t t_MemorySize)
+  : m_MemoryBase(t_MemoryBase), m_Memory(t_MemorySize, 0xFFU)
+{
+}
+
+
+///**************************************************************************************
+/// \brief     Processes an XCP command packet from the host. Just like the OpenBLT
+///            bootloader, the target ignores all commands other than CONNECT, while not
+///            connected.
+/// \param     t_Cmd The XCP command packet.
+/// \param     t_Res The XCP response packet. Only its data and length are set.
+/// \return    TBX_TRUE if the target responds, TBX_FALSE otherwise.
+///
+///**************************************************************************************
+uint8_t XcpTarget::process(CanMsg& t_Cmd, CanMsg& t_Res)
+{
+  uint8_t result = TBX_TRUE;
+  uint8_t status = TBX_OK;
+  uint8_t error = c_XcpErrCmdUnknown;
+
+  // Most commands respond with just the positive response packet identifier.
+  t_Res.setLen(1U);
+  t_Res[0] = c_XcpPidResponse;
+  // Only process the command if it is valid.
+  if (t_Cmd.len() < 1U)
+  {
+    result = TBX_FALSE;
+  }
+  // Is it the CONNECT command?
+  else if (t_Cmd[0] == c_XcpCmdConnect)
+  {
+    m_Connected = TBX_TRUE;
+    m_Programming = TBX_FALSE;
+    // Report the programming resource, Intel byte order and 8 byte CTO and DTO.
+    t_Res.setLen(8U);
+    t_Res[1] = c_XcpResourcePgm;
+    t_Res[2] = 0U;
+    t_Res[3] = CanMsg::c_DataLenMax;
+    t_Res[4] = CanMsg::c_DataLenMax;
+    t_Res[5] = 0U;
+    t_Res[6] = 1U;
+    t_Res[7] = 1U;
+  }
+  // Ignore all other commands, while not connected.
+  else if (m_Connected == TBX_FALSE)
+  {
+    result = TBX_FALSE;
+  }
+  else
+  {
+    switch (t_Cmd[0])
+    {
+      case c_XcpCmdDisconnect:
+        m_Connected = TBX_FALSE;
+        break;
+
+      case c_XcpCmdSetMta:
+        m_Mta = loadValue(&t_Cmd[4]);
+        status = (t_Cmd.len() == 8U) ? TBX_OK : TBX_ERROR;
+        error = c_XcpErrCmdSyntax;
+        break;
+
+      case c_XcpCmdProgramStart:
+        m_Programming = TBX_TRUE;
+        // Report no block mode, a maximum CTO of 8 and no queue.
+        t_Res.setLen(7U);
+        t_Res[1] = 0U;
+        t_Res[2] = 0U;
+        t_Res[3] = CanMsg::c_DataLenMax;
+        t_Res[4] = 0U;
+        t_Res[5] = 0U;
+        t_Res[6] = 0U;
+        break;
+
+      case c_XcpCmdProgramClear:
+        status = (m_Programming == TBX_TRUE) ? clear(loadValue(&t_Cmd[4])) : TBX_ERROR;
+        error = (m_Programming == TBX_TRUE) ? c_XcpErrOutOfRange : c_XcpErrSequence;
+        break;
+
+      case c_XcpCmdProgram:
+        // A PROGRAM command without data ends the programming sequence.
+        if ((m_Programming == TBX_FALSE) || (t_Cmd.len() < 2U) ||
+            (t_Cmd[1] > (t_Cmd.len() - 2U)))
+        {
+          status = TBX_ERROR;
+          error = (m_Programming == TBX_TRUE) ? c_XcpErrCmdSyntax : c_XcpErrSequence;
+        }
+        else if (t_Cmd[1] == 0U)
+        {
+          m_Programming = TBX_FALSE;
+        }
+        else
+        {
+          status = write(&t_Cmd[2], t_Cmd[1]);
+          error = c_XcpErrOutOfRange;
+        }
+        break;
+
+      case c_XcpCmdProgramMax:
+        status = (m_Programming == TBX_TRUE) ? write(&t_Cmd[1], t_Cmd.len() - 1U) :
+                                               TBX_ERROR;
+        error = (m_Programming == TBX_TRUE) ? c_XcpErrOutOfRange : c_XcpErrSequence;
+        break;
+
+      case c_XcpCmdProgramReset:
+        // The target starts the newly programmed firmware.
+        m_Connected = TBX_FALSE;
+        m_Programming = TBX_FALSE;
+        m_Resets++;
+        break;
+
+      default:
+        status = TBX_ERROR;
+        break;
+    }
+  }
+  // Respond with an error packet, if the command failed.
+  if (status == TBX_ERROR)
+  {
+    t_Res.setLen(2U);
+    t_Res[0] = c_XcpPidError;
+    t_Res[1] = error;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Verifies that the target's memory holds the firmware image.
+/// \param     t_Image The firmware image.
+/// \return    TBX_OK if the memory holds the image, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpTarget::verify(SrecImage const& t_Image) const
+{
+  uint8_t result = TBX_OK;
+
+  // Compare each segment of the image with the memory.
+  for (auto const& segment : t_Image.segments())
+  {
+    size_t offset = segment.address - m_MemoryBase;
+    if ((segment.address < m_MemoryBase) || (segment.data.size() > m_Memory.size()) ||
+        (offset > (m_Memory.size() - segment.data.size())) ||
+        (!std::equal(segment.data.begin(), segment.data.end(),
+                     m_Memory.begin() + static_cast<std::ptrdiff_t>(offset))))
+    {
+      result = TBX_ERROR;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Programs data into the memory at the memory transfer address and
+///            increments the address accordingly.
+/// \param     t_Data Byte array with the data.
+/// \param     t_Len Number of bytes to program.
+/// \return    TBX_OK if successful, TBX_ERROR if the data does not fit in the memory.
+///
+///**************************************************************************************
+uint8_t XcpTarget::write(uint8_t const t_Data[], size_t t_Len)
+{
+  uint8_t result = TBX_ERROR;
+  size_t offset = m_Mta - m_MemoryBase;
+
+  // Only program data that fits in the memory.
+  if ((m_Mta >= m_MemoryBase) && (t_Len <= m_Memory.size()) &&
+      (offset <= (m_Memory.size() - t_Len)))
+  {
+    std::memcpy(&m_Memory[offset], t_Data, t_Len);
+    m_Mta += static_cast<uint32_t>(t_Len);
+    result = TBX_OK;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Erases the memory, starting at the memory transfer address.
+/// \param     t_Len Number of bytes to erase.
+/// \return    TBX_OK if successful, TBX_ERROR if the range does not fit in the memory.
+///
+///**************************************************************************************
+uint8_t XcpTarget::clear(size_t t_Len)
+{
+  uint8_t result = TBX_ERROR;
+  size_t offset = m_Mta - m_MemoryBase;
+
+  // Only erase a range that fits in the memory.
+  if ((m_Mta >= m_MemoryBase) && (t_Len <= m_Memory.size()) &&
+      (offset <= (m_Memory.size() - t_Len)))
+  {
+    std::fill_n(m_Memory.begin() + static_cast<std::ptrdiff_t>(offset), t_Len, 0xFFU);
+    result = TBX_OK;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Loads a 32-bit value, stored in Intel (little endian) byte order.
+/// \param     t_Src Byte array with the value.
+/// \return    The value.
+///
+///**************************************************************************************
+uint32_t XcpTarget::loadValue(uint8_t const t_Src[])
+{
+  return static_cast<uint32_t>(t_Src[0]) | (static_cast<uint32_t>(t_Src[1]) << 8U) |
+         (static_cast<uint32_t>(t_Src[2]) << 16U) |
+         (static_cast<uint32_t>(t_Src[3]) << 24U);
+}
+//********************************** end of xcptarget.cpp *******************************
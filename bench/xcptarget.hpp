@@ -0,0 +1,105 @@
+///**************************************************************************************
+/// \file         xcptarget.hpp
+/// \brief        Simulated OpenBLT target header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef XCPTARGET_HPP
+#define XCPTARGET_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include <vector>
+#include "can.hpp"
+#include "srecimage.hpp"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Simulated OpenBLT target class.
+/// \details Answers the XCP commands that a host sends during a firmware update, like
+///          the OpenBLT bootloader on a microcontroller does. It supports the XCP
+///          commands CONNECT, DISCONNECT, SET_MTA, PROGRAM_START, PROGRAM_CLEAR,
+///          PROGRAM, PROGRAM_MAX and PROGRAM_RESET. Values are in Intel (little
+///          endian) byte order. Programming operates on a RAM copy of the target's
+///          flash memory, which verify() compares against the firmware image.
+class XcpTarget
+{
+public:
+  // Constructors and destructor.
+  explicit XcpTarget(uint32_t t_MemoryBase, size_t t_MemorySize);
+  virtual ~XcpTarget() { }
+  // Methods.
+  uint8_t process(CanMsg& t_Cmd, CanMsg& t_Res);
+  uint8_t verify(SrecImage const& t_Image) const;
+  // Getters and setters.
+  uint32_t resets() const { return m_Resets; }
+
+private:
+  // Constants.
+  static constexpr uint8_t c_XcpCmdConnect = 0xFFU;
+  static constexpr uint8_t c_XcpCmdDisconnect = 0xFEU;
+  static constexpr uint8_t c_XcpCmdSetMta = 0xF6U;
+  static constexpr uint8_t c_XcpCmdProgramStart = 0xD2U;
+  static constexpr uint8_t c_XcpCmdProgramClear = 0xD1U;
+  static constexpr uint8_t c_XcpCmdProgram = 0xD0U;
+  static constexpr uint8_t c_XcpCmdProgramReset = 0xCFU;
+  static constexpr uint8_t c_XcpCmdProgramMax = 0xC9U;
+  static constexpr uint8_t c_XcpPidResponse = 0xFFU;
+  static constexpr uint8_t c_XcpPidError = 0xFEU;
+  static constexpr uint8_t c_XcpErrSequence = 0x29U;
+  static constexpr uint8_t c_XcpErrCmdUnknown = 0x20U;
+  static constexpr uint8_t c_XcpErrCmdSyntax = 0x21U;
+  static constexpr uint8_t c_XcpErrOutOfRange = 0x22U;
+  static constexpr uint8_t c_XcpResourcePgm = 0x10U;
+  // Members.
+  uint32_t m_MemoryBase;
+  std::vector<uint8_t> m_Memory;
+  uint8_t m_Connected{TBX_FALSE};
+  uint8_t m_Programming{TBX_FALSE};
+  uint32_t m_Mta{0U};
+  uint32_t m_Resets{0U};
+  // Methods.
+  uint8_t write(uint8_t const t_Data[], size_t t_Len);
+  uint8_t clear(size_t t_Len);
+  static uint32_t loadValue(uint8_t const t_Src[]);
+
+  // Flag the class as non-copyable.
+  XcpTarget(const XcpTarget&) = delete;
+  const XcpTarget& operator=(const XcpTarget&) = delete;
+};
+
+#endif // XCPTARGET_HPP
+//********************************** end of xcptarget.hpp *******************************
@@ -53,7 +53,7 @@ Application::Application(Board& t_Board)
   : cpp_freertos::Thread("AppThread", configMINIMAL_STACK_SIZE + 48, 4),
     m_Board(t_Board), 
     m_Indicator(t_Board.statusLed()),
-    m_Gateway(t_Board.usbDevice(), t_Board.can(), t_Board.boot())
+    m_Gateway(t_Board.usbDevice(), t_Board.can(), t_Board.boot(), t_Board.storage())
 {
   // Set the USB device suspend event handler to the onUsbSuspend() method.
   m_Board.usbDevice().onSuspend = std::bind(&Application::onUsbSuspend, this);
@@ -65,6 +65,15 @@ Application::Application(Board& t_Board)
   m_Gateway.onDisconnected = std::bind(&Application::onGatewayDisconnected, this);
   // Set the gateway error event handler to the onGatewayError() method.
   m_Gateway.onError = std::bind(&Application::onGatewayError, this);
+  // Set the gateway recovered event handler to the onGatewayRecovered() method.
+  m_Gateway.onRecovered = std::bind(&Application::onGatewayRecovered, this);
+  // Set the gateway standalone done event handler to the onGatewayStandaloneDone()
+  // method.
+  m_Gateway.onStandaloneDone = std::bind(&Application::onGatewayStandaloneDone, this,
+                                         std::placeholders::_1);
+  // Retransmit the XCP Connect command on the CAN bus every 10 milliseconds, until the
+  // target responds. This speeds up connecting to a target that just reset.
+  m_Gateway.setConnectRetryInterval(std::chrono::milliseconds{10});
   // Attach the control loop observers.
   attach(m_Indicator);
   attach(m_Gateway);
@@ -91,6 +100,7 @@ void Application::Run()
   const TickType_t deltaTicks = cpp_freertos::Ticks::MsToTicks(stepTimeMillis);
   constexpr size_t heapMonitorSteps = 30000UL / stepTimeMillis; // 30 seconds.
   size_t stepsCounter = 0U;
+  uint8_t buttonPressed = TBX_FALSE;
 
   // Enter the task body, which should be an infinite loop.
   for (;;)
@@ -100,6 +110,20 @@ void Application::Run()
     DelayUntil(deltaTicks);
     // Notify all attached subscribers about the elapsed time step.
     notify(deltaMillis);
+    // Detect a press of the user push button. Sampling it once per step, filters out
+    // most of its contact bounce.
+    if (m_Board.userButton().pressed() == TBX_TRUE)
+    {
+      if (buttonPressed == TBX_FALSE)
+      {
+        onUserButtonPressed();
+      }
+      buttonPressed = TBX_TRUE;
+    }
+    else
+    {
+      buttonPressed = TBX_FALSE;
+    }
     // Run the heap monitor.
     if (++stepsCounter >= heapMonitorSteps)
     {
@@ -168,6 +192,8 @@ void Application::onGatewayDisconnected()
   m_Indicator.setState(Indicator::IDLE);
   // Log info.
   logger().info("Gateway disconnected.");
+  // Log the board's statistics of the session that just ended.
+  m_Board.logStatistics();
 }
 
 
@@ -182,4 +208,68 @@ void Application::onGatewayError()
   m_Indicator.setState(Indicator::ERROR);
 }
 
+
+///**************************************************************************************
+/// \brief     Event handler that gets called when the gateway recovered from an error.
+///            For example after a CAN bus off recovery.
+///
+///**************************************************************************************
+void Application::onGatewayRecovered()
+{
+  // Set indicator back to the state that matches the gateway session.
+  if (m_Gateway.connected() == TBX_TRUE)
+  {
+    m_Indicator.setState(Indicator::ACTIVE);
+  }
+  else
+  {
+    m_Indicator.setState(Indicator::IDLE);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Event handler that gets called when the user pressed the push button. It
+///            starts programming the staged image on the target.
+///
+///**************************************************************************************
+void Application::onUserButtonPressed()
+{
+  // Start programming the staged image on the target.
+  if (m_Gateway.startStandalone() == TBX_OK)
+  {
+    // Set indicator to the active state.
+    m_Indicator.setState(Indicator::ACTIVE);
+    // Log info.
+    logger().info("Standalone programming started.");
+  }
+  else
+  {
+    // Log warning.
+    logger().warning("Standalone programming could not be started.");
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Event handler that gets called when the gateway is done programming the
+///            staged image on the target. Note that it is called from the XCP loader's
+///            task.
+/// \param     t_Ok TBX_TRUE if the target was successfully programmed, TBX_FALSE
+///            otherwise.
+///
+///**************************************************************************************
+void Application::onGatewayStandaloneDone(uint8_t t_Ok)
+{
+  // Set indicator to the state that matches the outcome.
+  if (t_Ok == TBX_TRUE)
+  {
+    m_Indicator.setState(Indicator::IDLE);
+  }
+  else
+  {
+    m_Indicator.setState(Indicator::ERROR);
+  }
+}
+
 //********************************** end of application.cpp *****************************
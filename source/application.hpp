@@ -70,6 +70,9 @@ private:
   void onGatewayConnected();
   void onGatewayDisconnected();
   void onGatewayError();
+  void onGatewayRecovered();
+  void onGatewayStandaloneDone(uint8_t t_Ok);
+  void onUserButtonPressed();
 
   // Flag the class as non-copyable.
   Application(const Application&) = delete;
@@ -43,6 +43,8 @@
 #include "usbdevice.hpp"
 #include "can.hpp"
 #include "boot.hpp"
+#include "button.hpp"
+#include "storage.hpp"
 
 
 //***************************************************************************************
@@ -63,6 +65,10 @@ public:
   virtual UsbDevice& usbDevice() = 0;
   virtual Can& can() = 0;
   virtual Boot& boot() = 0;
+  virtual Button& userButton() = 0;
+  virtual Storage& storage() = 0;
+  // Methods.
+  virtual void logStatistics() { }
 
 protected:
   // Flag the class as abstract.
@@ -50,7 +50,9 @@
 //***************************************************************************************
 /// \brief   CAN message class.
 /// \details Note that this class uses array subscript operator overloading for easy
-///          access to the CAN message data bytes.
+///          access to the CAN message data bytes. The CAN driver timestamps a received
+///          message upon its reception, in the time base of latencyRecorder(). The
+///          timestamp is not transmitted.
 /// \example Message initialization using just the constructor:
 ///            CanMsg myMsg(0x123, TBX_FALSE, 8, { 1, 2, 3, 4, 5, 6, 7, 8 });
 ///
@@ -82,10 +84,12 @@ public:
   uint32_t id() const { return m_Id; }
   uint8_t ext() const { return m_Ext; }
   uint8_t len() const { return m_Len; }
+  uint32_t timestamp() const { return m_Timestamp; }
   CanData& data() { return m_Data; }
   void setId(uint32_t t_Id) { TBX_ASSERT(t_Id <= c_ExtIdMax); m_Id = t_Id; } 
   void setExt(uint8_t t_Ext) { m_Ext = (t_Ext == TBX_FALSE) ? TBX_FALSE : TBX_TRUE; }
   void setLen(uint8_t t_Len) { TBX_ASSERT(t_Len <= c_DataLenMax); m_Len = t_Len; }
+  void setTimestamp(uint32_t t_Timestamp) { m_Timestamp = t_Timestamp; }
   // Operator overloads.
   uint8_t& operator[](uint8_t t_Idx)
   {
@@ -103,6 +107,7 @@ private:
   uint32_t m_Id;
   uint8_t m_Ext;
   uint8_t m_Len;
+  uint32_t m_Timestamp{0U};
   CanData m_Data;
 };
 
@@ -154,7 +159,158 @@ public:
 };
 
 
+/// \brief   CAN reception acceptance filter set entry class.
+/// \details A mask bit value of 0 means don't care. An entry whose mask covers all bits
+///          of the identifier matches exactly one identifier.
+class CanFilterEntry
+{
+public:
+  // Getters and setters.
+  constexpr uint32_t idMax() const
+  {
+    return (ext == TBX_FALSE) ? CanMsg::c_StdIdMax : CanMsg::c_ExtIdMax;
+  }
+  constexpr uint8_t exact() const
+  {
+    return ((mask & idMax()) == idMax()) ? TBX_TRUE : TBX_FALSE;
+  }
+  // Members.
+  uint32_t code;
+  uint32_t mask;
+  uint8_t ext;
+};
+
+
+/// \brief   CAN reception acceptance filter set class.
+/// \details Holds any combination of exact identifiers, code/mask pairs and identifier
+///          ranges, for both 11-bit and 29-bit CAN identifiers. A message is accepted
+///          if it matches at least one of the entries. An empty set accepts no messages
+///          at all. It is up to the CAN driver to map the entries onto its hardware
+///          acceptance filters. The set holds enough entries to fill all hardware
+///          acceptance filters of the supported CAN controllers. For bxCAN this is 14
+///          filter banks with four exact 11-bit identifiers each. Intentionally kept
+///          usable in constant expressions, such that a set can be fully constructed at
+///          compile time.
+/// \example Creating a set to receive 11-bit identifiers 0x667 and 0x700..0x70F:
+///            CanFilterSet mySet;
+///            mySet.addId(0x667, TBX_FALSE);
+///            mySet.addRange(0x700, 0x70F, TBX_FALSE);
+class CanFilterSet
+{
+public:
+  // Constants.
+  static constexpr size_t c_EntriesMax = 56U;
+  // Constructors and destructor.
+  constexpr CanFilterSet() { }
+  // Getters and setters.
+  constexpr size_t size() const { return m_Size; }
+  constexpr CanFilterEntry const& operator[](size_t t_Idx) const
+  {
+    return m_Entries[t_Idx];
+  }
+  constexpr CanFilterEntry& operator[](size_t t_Idx) { return m_Entries[t_Idx]; }
+  // Methods.
+  constexpr void clear() { m_Size = 0U; }
+  constexpr void remove(size_t t_Idx)
+  {
+    // Only remove an existing entry. Keep the order of the remaining entries.
+    if (t_Idx < m_Size)
+    {
+      for (size_t idx = t_Idx; idx < (m_Size - 1U); idx++)
+      {
+        m_Entries[idx] = m_Entries[idx + 1U];
+      }
+      m_Size--;
+    }
+  }
+  constexpr uint8_t addId(uint32_t t_Id, uint8_t t_Ext)
+  {
+    return addMask(t_Id, CanMsg::c_ExtIdMax, t_Ext);
+  }
+  constexpr uint8_t addMask(uint32_t t_Code, uint32_t t_Mask, uint8_t t_Ext)
+  {
+    uint8_t result = TBX_ERROR;
+    uint32_t idMax = (t_Ext == TBX_FALSE) ? CanMsg::c_StdIdMax : CanMsg::c_ExtIdMax;
+
+    // Only add the entry if there is still space for it.
+    if (m_Size < c_EntriesMax)
+    {
+      m_Entries[m_Size].ext = (t_Ext == TBX_FALSE) ? TBX_FALSE : TBX_TRUE;
+      m_Entries[m_Size].mask = t_Mask & idMax;
+      m_Entries[m_Size].code = t_Code & m_Entries[m_Size].mask;
+      m_Size++;
+      result = TBX_OK;
+    }
+    // Give the result back to the caller.
+    return result;
+  }
+  constexpr uint8_t addRange(uint32_t t_First, uint32_t t_Last, uint8_t t_Ext)
+  {
+    uint8_t result = TBX_ERROR;
+    size_t sizeBackup = m_Size;
+    uint32_t idMax = (t_Ext == TBX_FALSE) ? CanMsg::c_StdIdMax : CanMsg::c_ExtIdMax;
+
+    // Only continue with a valid range.
+    if ((t_First <= t_Last) && (t_Last <= idMax))
+    {
+      result = TBX_OK;
+      // Cover the range with the largest possible aligned blocks of identifiers. Each
+      // block is expressed as a single code/mask pair.
+      while ((t_First <= t_Last) && (result == TBX_OK))
+      {
+        uint32_t blockSize = 1U;
+        // Grow the block, as long as it stays aligned and inside the range.
+        while (((t_First & ((blockSize << 1U) - 1U)) == 0U) &&
+               ((t_First + (blockSize << 1U) - 1U) <= t_Last) &&
+               ((blockSize << 1U) <= (idMax + 1U)))
+        {
+          blockSize <<= 1U;
+        }
+        result = addMask(t_First, idMax & ~(blockSize - 1U), t_Ext);
+        t_First += blockSize;
+      }
+      // Do not leave a partially added range behind, in case it did not fit.
+      if (result != TBX_OK)
+      {
+        m_Size = sizeBackup;
+      }
+    }
+    // Give the result back to the caller.
+    return result;
+  }
+
+private:
+  // Members.
+  std::array<CanFilterEntry, c_EntriesMax> m_Entries{ };
+  size_t m_Size{0U};
+};
+
+
 /// \brief   Abstract CAN driver class.
+/// \details The onReceivedFromISR event handler is optional. If assigned, the driver
+///          calls it directly from the reception interrupt, before onReceived. It should
+///          return TBX_TRUE if it fully handled the message, in which case onReceived is
+///          not called for the message. Keep in mind that it runs in interrupt context,
+///          so it should be short and must only call interrupt safe functions.
+///          Method setFilterSet always applies the complete set. Should the set need
+///          more hardware acceptance filters than available, the driver accepts a
+///          superset of it in hardware and rejects the remaining messages in software.
+///          TBX_ERROR is only returned by a driver that cannot apply the set at all, in
+///          which case the current filter settings remain unchanged. The bxCAN driver
+///          always returns TBX_OK. Method filterBankCount returns the number of
+///          hardware filter banks, for sizing a set with CanFilterCompiler.
+///          Method connect does not block. It merely starts the synchronization with
+///          the CAN bus. The driver calls the onConnected event handler, once it is
+///          actually connected. Until then, transmit requests are rejected.
+///          A driver can give up on transmitting a message, for example because no
+///          other node acknowledges it. It then calls the onTransmitFailed event
+///          handler for the message. Method txPendingCount returns the number of
+///          messages that were submitted for transmission, but did not yet leave the
+///          driver.
+///          Upon a bus off event, the driver calls the onBusOff event handler. A driver
+///          that supports automatic bus off recovery stays connected and calls the
+///          onBusOffRecovered event handler, once it is back on the bus. Otherwise it
+///          disconnects.
 class Can
 {
 public:
@@ -174,15 +330,22 @@ public:
   // Destructor.
   virtual ~Can() { }
   // Getters and setters.
+  virtual size_t filterBankCount() const = 0;
   virtual void setFilter(CanFilter& t_Filter) = 0;
+  virtual uint8_t setFilterSet(CanFilterSet const& t_FilterSet) = 0;
+  virtual size_t txPendingCount() const = 0;
   // Methods.
   virtual void connect(Baudrate t_Baudrate = BR500K) = 0;
   virtual void disconnect() = 0;
   virtual uint8_t transmit(CanMsg& t_Msg) = 0;
   // Events.
   std::function<void(CanMsg& t_Msg)> onReceived;
+  std::function<uint8_t(CanMsg& t_Msg)> onReceivedFromISR;
   std::function<void(CanMsg& t_Msg)> onTransmitted;
+  std::function<void(CanMsg& t_Msg)> onTransmitFailed;
+  std::function<void()> onConnected;
   std::function<void()> onBusOff;
+  std::function<void()> onBusOffRecovered;
 
 protected:
   // Flag the class as abstract.
@@ -0,0 +1,390 @@
+///**************************************************************************************
+/// \file         canfiltercompiler.hpp
+/// \brief        CAN reception acceptance filter compiler header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef CANFILTERCOMPILER_HPP
+#define CANFILTERCOMPILER_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include "can.hpp"
+#include "microtbx.h"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   CAN reception acceptance filter compiler class.
+/// \details Converts an arbitrary set of CAN identifiers to a filter set that fits the
+///          hardware filter banks. It starts out with one exact entry per identifier.
+///          As long as the entries do not fit, it merges the two entries whose merged
+///          code/mask pair accepts the fewest additional identifiers. Entries that are
+///          covered by a merged entry are dropped. The cost model matches hardware with
+///          filter banks that hold four exact 11-bit identifiers, two exact 29-bit
+///          identifiers, two 11-bit code/mask pairs or one 29-bit code/mask pair each,
+///          as found on bxCAN.
+///          Once compiled, the getters report how many identifiers the filter set
+///          accepts versus how many were requested. For 29-bit identifiers, the number
+///          of accepted identifiers is an upper bound, because partially overlapping
+///          entries are counted twice. The compiler only relies on constant expressions,
+///          so the filter set can be compiled at build time, if the identifiers are
+///          known at that point.
+/// \example Compiling a set of 11-bit identifiers for a CAN driver:
+///            constexpr uint32_t myIds[] = { 0x100, 0x101, 0x102, 0x103, 0x200 };
+///            CanFilterCompiler myCompiler(myCan.filterBankCount());
+///            myCompiler.compile(myIds, 5, TBX_FALSE, mySet);
+///            myCan.setFilterSet(mySet);
+class CanFilterCompiler
+{
+public:
+  // Constructors and destructor.
+  explicit constexpr CanFilterCompiler(size_t t_BanksMax) : m_BanksMax(t_BanksMax) { }
+  // Getters and setters.
+  constexpr uint32_t wantedIds() const { return m_WantedIds; }
+  constexpr uint32_t acceptedIds() const { return m_AcceptedIds; }
+  constexpr uint32_t falsePositivePermille() const
+  {
+    uint32_t result = 0U;
+
+    if (m_AcceptedIds > m_WantedIds)
+    {
+      result = static_cast<uint32_t>(
+        (static_cast<uint64_t>(m_AcceptedIds - m_WantedIds) * 1000U) / m_AcceptedIds);
+    }
+    return result;
+  }
+  // Methods.
+  constexpr uint8_t compile(uint32_t const t_Ids[], size_t t_Count, uint8_t t_Ext,
+                            CanFilterSet& t_FilterSet);
+  constexpr uint8_t reduce(CanFilterSet& t_FilterSet) const;
+  static constexpr size_t banksNeeded(CanFilterSet const& t_FilterSet);
+
+private:
+  // Members.
+  size_t m_BanksMax;
+  uint32_t m_WantedIds{0U};
+  uint32_t m_AcceptedIds{0U};
+  // Methods.
+  static constexpr uint32_t entrySize(CanFilterEntry const& t_Entry);
+  static constexpr uint8_t entryCovers(CanFilterEntry const& t_Outer,
+                                       CanFilterEntry const& t_Inner);
+  static constexpr uint8_t mergeBestPair(CanFilterSet& t_FilterSet);
+  static constexpr uint32_t countAcceptedIds(CanFilterSet const& t_FilterSet);
+};
+
+
+//***************************************************************************************
+// Method definitions
+//***************************************************************************************
+///**************************************************************************************
+/// \brief     Compiles a set of CAN identifiers to a filter set.
+/// \param     t_Ids Array with the CAN identifiers. The identifiers should be unique.
+/// \param     t_Count Number of CAN identifiers in the array.
+/// \param     t_Ext TBX_TRUE for 29-bit extended, TBX_FALSE for 11-bit standard CAN
+///            identifiers.
+/// \param     t_FilterSet Filter set to store the result in. Its current contents are
+///            discarded.
+/// \return    TBX_OK if successful, TBX_ERROR if the filter set does not fit the filter
+///            banks.
+///
+///**************************************************************************************
+constexpr uint8_t CanFilterCompiler::compile(uint32_t const t_Ids[], size_t t_Count,
+                                             uint8_t t_Ext, CanFilterSet& t_FilterSet)
+{
+  uint8_t result = TBX_OK;
+
+  // Start out with an empty filter set.
+  t_FilterSet.clear();
+  m_WantedIds = 0U;
+  // Add the identifiers one by one as exact entries.
+  for (size_t idIdx = 0U; (idIdx < t_Count) && (result == TBX_OK); idIdx++)
+  {
+    CanFilterEntry candidate{ t_Ids[idIdx], CanMsg::c_ExtIdMax, t_Ext };
+    uint8_t covered = TBX_FALSE;
+
+    candidate.mask &= candidate.idMax();
+    candidate.code &= candidate.mask;
+    // Check if an earlier merged entry already covers this identifier.
+    for (size_t entryIdx = 0U; entryIdx < t_FilterSet.size(); entryIdx++)
+    {
+      if (entryCovers(t_FilterSet[entryIdx], candidate) == TBX_TRUE)
+      {
+        covered = TBX_TRUE;
+        break;
+      }
+    }
+    // Make room in the filter set if needed.
+    if ((covered == TBX_FALSE) && (t_FilterSet.size() == CanFilterSet::c_EntriesMax))
+    {
+      result = mergeBestPair(t_FilterSet);
+    }
+    // Add the identifier, if not yet covered.
+    if ((covered == TBX_FALSE) && (result == TBX_OK))
+    {
+      result = t_FilterSet.addId(candidate.code, t_Ext);
+    }
+    m_WantedIds++;
+  }
+  // Merge entries until the filter set fits the filter banks.
+  if (result == TBX_OK)
+  {
+    result = reduce(t_FilterSet);
+  }
+  // Determine the number of identifiers that the filter set accepts.
+  m_AcceptedIds = countAcceptedIds(t_FilterSet);
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Reduces a filter set, such that it fits the filter banks. Entries are
+///            merged, so the reduced set accepts a superset of the original one.
+/// \param     t_FilterSet Filter set to reduce.
+/// \return    TBX_OK if successful, TBX_ERROR if the filter set does not fit the filter
+///            banks.
+///
+///**************************************************************************************
+constexpr uint8_t CanFilterCompiler::reduce(CanFilterSet& t_FilterSet) const
+{
+  uint8_t result = TBX_OK;
+
+  // Merge entries until the filter set fits the filter banks.
+  while ((result == TBX_OK) && (banksNeeded(t_FilterSet) > m_BanksMax))
+  {
+    result = mergeBestPair(t_FilterSet);
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Determines the number of filter banks needed for a filter set.
+/// \param     t_FilterSet Filter set.
+/// \return    Number of needed filter banks.
+///
+///**************************************************************************************
+constexpr size_t CanFilterCompiler::banksNeeded(CanFilterSet const& t_FilterSet)
+{
+  size_t stdIds = 0U;
+  size_t extIds = 0U;
+  size_t stdMasks = 0U;
+  size_t extMasks = 0U;
+
+  // Count the entries per filter bank mode.
+  for (size_t idx = 0U; idx < t_FilterSet.size(); idx++)
+  {
+    CanFilterEntry const& entry = t_FilterSet[idx];
+    if (entry.exact() == TBX_TRUE)
+    {
+      stdIds += (entry.ext == TBX_FALSE) ? 1U : 0U;
+      extIds += (entry.ext == TBX_FALSE) ? 0U : 1U;
+    }
+    else
+    {
+      stdMasks += (entry.ext == TBX_FALSE) ? 1U : 0U;
+      extMasks += (entry.ext == TBX_FALSE) ? 0U : 1U;
+    }
+  }
+  // Give the result back to the caller.
+  return ((stdIds + 3U) / 4U) + ((extIds + 1U) / 2U) + ((stdMasks + 1U) / 2U) +
+         extMasks;
+}
+
+
+///**************************************************************************************
+/// \brief     Determines the number of identifiers that a filter set entry accepts.
+/// \param     t_Entry Filter set entry.
+/// \return    Number of accepted identifiers.
+///
+///**************************************************************************************
+constexpr uint32_t CanFilterCompiler::entrySize(CanFilterEntry const& t_Entry)
+{
+  uint32_t result = 1U;
+  uint32_t dontCareBits = ~t_Entry.mask & t_Entry.idMax();
+
+  // Each don't care bit doubles the number of accepted identifiers.
+  while (dontCareBits != 0U)
+  {
+    if ((dontCareBits & 1U) != 0U)
+    {
+      result <<= 1U;
+    }
+    dontCareBits >>= 1U;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Determines if a filter set entry accepts all identifiers of another one.
+/// \param     t_Outer The possibly covering filter set entry.
+/// \param     t_Inner The possibly covered filter set entry.
+/// \return    TBX_TRUE if t_Outer covers t_Inner, TBX_FALSE otherwise.
+///
+///**************************************************************************************
+constexpr uint8_t CanFilterCompiler::entryCovers(CanFilterEntry const& t_Outer,
+                                                 CanFilterEntry const& t_Inner)
+{
+  uint8_t result = TBX_FALSE;
+
+  // The inner entry must care about at least the bits that the outer entry cares
+  // about and match the outer entry's code in these bits.
+  if ((t_Outer.ext == t_Inner.ext) &&
+      ((t_Inner.mask & t_Outer.mask) == t_Outer.mask) &&
+      ((t_Inner.code & t_Outer.mask) == t_Outer.code))
+  {
+    result = TBX_TRUE;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Merges the two entries of a filter set, whose merged code/mask pair
+///            accepts the fewest additional identifiers. Afterwards, the entries that
+///            the merged entry covers are removed.
+/// \param     t_FilterSet Filter set.
+/// \return    TBX_OK if successful, TBX_ERROR if no entries could be merged.
+///
+///**************************************************************************************
+constexpr uint8_t CanFilterCompiler::mergeBestPair(CanFilterSet& t_FilterSet)
+{
+  uint8_t result = TBX_ERROR;
+  CanFilterEntry best{ 0U, 0U, TBX_FALSE };
+  int64_t bestCost = INT64_MAX;
+  size_t bestIdx = 0U;
+
+  // Try all pairs of entries with the same identifier type.
+  for (size_t firstIdx = 0U; firstIdx < t_FilterSet.size(); firstIdx++)
+  {
+    for (size_t secondIdx = firstIdx + 1U; secondIdx < t_FilterSet.size(); secondIdx++)
+    {
+      CanFilterEntry const& first = t_FilterSet[firstIdx];
+      CanFilterEntry const& second = t_FilterSet[secondIdx];
+      if (first.ext != second.ext)
+      {
+        continue;
+      }
+      // The merged entry only cares about the bits that both entries care about and
+      // that have the same value in both entries.
+      CanFilterEntry merged{ 0U, first.mask & second.mask & ~(first.code ^ second.code),
+                             first.ext };
+      merged.code = first.code & merged.mask;
+      int64_t cost = static_cast<int64_t>(entrySize(merged)) -
+                     static_cast<int64_t>(entrySize(first)) -
+                     static_cast<int64_t>(entrySize(second));
+      // Keep track of the cheapest merge.
+      if (cost < bestCost)
+      {
+        bestCost = cost;
+        best = merged;
+        bestIdx = firstIdx;
+        result = TBX_OK;
+      }
+    }
+  }
+  // Replace the entries covered by the merged entry, with the merged entry.
+  if (result == TBX_OK)
+  {
+    t_FilterSet[bestIdx] = best;
+    for (size_t idx = t_FilterSet.size(); idx > 0U; idx--)
+    {
+      if (((idx - 1U) != bestIdx) &&
+          (entryCovers(best, t_FilterSet[idx - 1U]) == TBX_TRUE))
+      {
+        t_FilterSet.remove(idx - 1U);
+        if ((idx - 1U) < bestIdx)
+        {
+          bestIdx--;
+        }
+      }
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Determines the number of identifiers that a filter set accepts. Exact for
+///            11-bit identifiers. For 29-bit identifiers, it is an upper bound, because
+///            partially overlapping entries are counted twice. A single 29-bit entry
+///            accepts up to 2^29 identifiers, so the sum of all entries can exceed 32
+///            bits. The count then saturates at UINT32_MAX.
+/// \param     t_FilterSet Filter set.
+/// \return    Number of accepted identifiers.
+///
+///**************************************************************************************
+constexpr uint32_t CanFilterCompiler::countAcceptedIds(CanFilterSet const& t_FilterSet)
+{
+  uint64_t result = 0U;
+
+  // Try all 11-bit identifiers.
+  for (uint32_t id = 0U; id <= CanMsg::c_StdIdMax; id++)
+  {
+    for (size_t idx = 0U; idx < t_FilterSet.size(); idx++)
+    {
+      CanFilterEntry const& entry = t_FilterSet[idx];
+      if ((entry.ext == TBX_FALSE) && ((id & entry.mask) == entry.code))
+      {
+        result++;
+        break;
+      }
+    }
+  }
+  // Add the sizes of all 29-bit entries.
+  for (size_t idx = 0U; idx < t_FilterSet.size(); idx++)
+  {
+    if (t_FilterSet[idx].ext == TBX_TRUE)
+    {
+      result += entrySize(t_FilterSet[idx]);
+    }
+  }
+  // Saturate the count, should it not fit.
+  if (result > UINT32_MAX)
+  {
+    result = UINT32_MAX;
+  }
+  // Give the result back to the caller.
+  return static_cast<uint32_t>(result);
+}
+
+#endif // CANFILTERCOMPILER_HPP
+//********************************** end of canfiltercompiler.hpp ***********************
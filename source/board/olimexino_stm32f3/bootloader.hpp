@@ -46,7 +46,7 @@
 // Class definitions
 //***************************************************************************************
 /// \brief OpenBLT bootloader interaction class.
-class Bootloader : public Boot
+class Bootloader final : public Boot
 {
 public:
   // Constructors and destructor.
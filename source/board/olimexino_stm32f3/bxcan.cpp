@@ -37,7 +37,10 @@
 //***************************************************************************************
 // Include files
 //***************************************************************************************
+#include <algorithm>
 #include "bxcan.hpp"
+#include "canfiltercompiler.hpp"
+#include "latencymonitor.hpp"
 #include "ticks.hpp"
 #include "stm32f3xx.h"
 #include "stm32f3xx_ll_rcc.h"
@@ -56,24 +59,158 @@
 BxCan* BxCan::s_InstancePtr = nullptr;
 
 
+//***************************************************************************************
+// Local data declarations
+//***************************************************************************************
+namespace
+{
+  // Frequency of the clock that drives the CAN peripheral, as configured by the board.
+  constexpr uint32_t canClockHz = 36000000UL;
+  // Sample point to aim for. 75% is the preferred sample point for protocols such as
+  // CANopen and DeviceNet.
+  constexpr uint16_t samplePointPermille = 750U;
+  // Oscillator tolerance that the bit timing settings must be able to handle.
+  constexpr uint32_t oscTolerancePpm = 1000U;
+
+  // Bit timing settings for one of the standard baudrates.
+  struct BitTimingTblEntry
+  {
+    uint32_t baudrate;
+    uint8_t found;
+    BxCanBitTiming bitTiming;
+  };
+
+  // Determines the bit timing settings for one of the standard baudrates.
+  constexpr BitTimingTblEntry solveBitTimingTblEntry(uint32_t t_Baudrate)
+  {
+    BitTimingTblEntry result{ t_Baudrate, TBX_ERROR, { } };
+    result.found = BxCanBitTiming::solve(canClockHz, t_Baudrate, samplePointPermille,
+                                         oscTolerancePpm, BxCanBitTiming::SJWMAX,
+                                         result.bitTiming);
+    return result;
+  }
+
+  // Bit timing settings for all standard baudrates, determined at compile time. This
+  // way connect() only needs to run the solver for other baudrates.
+  constexpr std::array<BitTimingTblEntry, 9U> bitTimingTbl =
+  {{
+    solveBitTimingTblEntry(Can::BR10K),
+    solveBitTimingTblEntry(Can::BR20K),
+    solveBitTimingTblEntry(Can::BR50K),
+    solveBitTimingTblEntry(Can::BR100K),
+    solveBitTimingTblEntry(Can::BR125K),
+    solveBitTimingTblEntry(Can::BR250K),
+    solveBitTimingTblEntry(Can::BR500K),
+    solveBitTimingTblEntry(Can::BR800K),
+    solveBitTimingTblEntry(Can::BR1M)
+  }};
+
+  // Determines if bit timing settings were found for all standard baudrates.
+  constexpr bool bitTimingTblComplete()
+  {
+    bool result = true;
+    for (BitTimingTblEntry const& entry : bitTimingTbl)
+    {
+      result = result && (entry.found == TBX_OK);
+    }
+    return result;
+  }
+
+  // Verify at compile time that all standard baudrates are supported.
+  static_assert(bitTimingTblComplete(), "Not all standard CAN baudrates are supported.");
+
+  // Determines if the bit timing settings for a baudrate match the expected ones,
+  // including the resulting sample point in permille. Takes the settings from the table
+  // for a standard baudrate and has the solver determine them for any other baudrate.
+  constexpr bool bitTimingIs(uint32_t t_Baudrate, uint16_t t_Prescaler, uint8_t t_Tseg1,
+                             uint8_t t_Tseg2, uint8_t t_Sjw,
+                             uint16_t t_SamplePointPermille)
+  {
+    BitTimingTblEntry entry = solveBitTimingTblEntry(t_Baudrate);
+    for (BitTimingTblEntry const& tblEntry : bitTimingTbl)
+    {
+      if (tblEntry.baudrate == t_Baudrate)
+      {
+        entry = tblEntry;
+      }
+    }
+    BxCanBitTiming const& bitTiming = entry.bitTiming;
+    uint32_t tq = 1U + bitTiming.tseg1 + bitTiming.tseg2;
+    bool result = (entry.found == TBX_OK) && (bitTiming.prescaler == t_Prescaler) &&
+                  (bitTiming.tseg1 == t_Tseg1) && (bitTiming.tseg2 == t_Tseg2) &&
+                  (bitTiming.sjw == t_Sjw) &&
+                  ((((1U + bitTiming.tseg1) * 1000U) / tq) == t_SamplePointPermille);
+    return result;
+  }
+
+  // Verify at compile time that the solver finds the expected settings. All standard
+  // baudrates are exact. Only 800 kbit/s misses the 75% sample point, because its 45
+  // clock cycles per bit do not allow it. 83.333 kbit/s is 4 ppm off and 666 kbit/s
+  // 1001 ppm, which the bit timing settings can still handle.
+  static_assert(bitTimingIs(Can::BR10K, 180U, 14U, 5U, 4U, 750U),
+                "Unexpected bit timing for 10 kbit/s.");
+  static_assert(bitTimingIs(Can::BR20K, 90U, 14U, 5U, 4U, 750U),
+                "Unexpected bit timing for 20 kbit/s.");
+  static_assert(bitTimingIs(Can::BR50K, 36U, 14U, 5U, 4U, 750U),
+                "Unexpected bit timing for 50 kbit/s.");
+  static_assert(bitTimingIs(Can::BR100K, 18U, 14U, 5U, 4U, 750U),
+                "Unexpected bit timing for 100 kbit/s.");
+  static_assert(bitTimingIs(Can::BR125K, 18U, 11U, 4U, 4U, 750U),
+                "Unexpected bit timing for 125 kbit/s.");
+  static_assert(bitTimingIs(Can::BR250K, 9U, 11U, 4U, 4U, 750U),
+                "Unexpected bit timing for 250 kbit/s.");
+  static_assert(bitTimingIs(Can::BR500K, 6U, 8U, 3U, 3U, 750U),
+                "Unexpected bit timing for 500 kbit/s.");
+  static_assert(bitTimingIs(Can::BR800K, 3U, 10U, 4U, 4U, 733U),
+                "Unexpected bit timing for 800 kbit/s.");
+  static_assert(bitTimingIs(Can::BR1M, 3U, 8U, 3U, 3U, 750U),
+                "Unexpected bit timing for 1 Mbit/s.");
+  static_assert(bitTimingIs(83333U, 27U, 11U, 4U, 4U, 750U),
+                "Unexpected bit timing for 83.333 kbit/s.");
+  static_assert(bitTimingIs(666000U, 3U, 13U, 4U, 4U, 777U),
+                "Unexpected bit timing for 666 kbit/s.");
+}
+
+
 ///**************************************************************************************
 /// \brief     Basic Extended CAN driver constructor. 
-/// \param     t_EventQueueSize Size of the internal event queue.
+/// \param     t_TxQueueSize Number of frames that the software transmit queue can
+///            buffer, on top of the three hardware transmit mailboxes.
+/// \param     t_TxDeadlineMs Time in milliseconds that a frame may spend in a transmit
+///            mailbox, before its transmission is aborted. A frame stays in its mailbox,
+///            as long as no other node acknowledges it. For example when the target is
+///            powered off. Set to 0 to never abort a transmission. The deadline is
+///            measured with the DWT cycle counter, so it is limited to half of the
+///            counter's wrap period. This is just under 30 seconds at 72 MHz.
 ///
 ///**************************************************************************************
-BxCan::BxCan(size_t t_EventQueueSize)
+BxCan::BxCan(size_t t_TxQueueSize, uint32_t t_TxDeadlineMs)
   : Can(),
-    cpp_freertos::Thread("CanThread", configMINIMAL_STACK_SIZE + 64, 8)
+    cpp_freertos::Thread("CanThread", configMINIMAL_STACK_SIZE + 64, 8),
+    m_TxQueueSlots(t_TxQueueSize + 1U)
 {
   LL_GPIO_InitTypeDef GPIO_InitStruct{ };
+  uint64_t txDeadlineCycles = static_cast<uint64_t>(t_TxDeadlineMs) *
+                              (SystemCoreClock / 1000U);
 
   // Verify that only one instance of BxCan is created.
   TBX_ASSERT(s_InstancePtr == nullptr);
   // Store a pointer to ourselves.
   s_InstancePtr = this;
-  // Create the event queue.
-  m_EventQueue = std::make_unique<cpp_freertos::Queue>(t_EventQueueSize, 
-                                                       sizeof(BxCanEvent));
+  // Convert the transmit deadline to cycles of the DWT cycle counter. The elapsed time
+  // calculation on this free running counter only works below its wrap period. Leave
+  // room for the polling interval of the deadline check, by limiting it to half.
+  TBX_ASSERT(txDeadlineCycles <= c_TxDeadlineCyclesMax);
+  m_TxDeadlineCycles = static_cast<uint32_t>(
+    std::min<uint64_t>(txDeadlineCycles, c_TxDeadlineCyclesMax));
+  // Create the software transmit queue. Note that it has one more slot than requested.
+  // One slot always stays unused, such that a full queue can be distinguished from an
+  // empty one, by just looking at the head and tail indices.
+  m_TxQueue = std::make_unique<BxCanFrame[]>(m_TxQueueSlots);
+  // Default to receiving all 11-bit and 29-bit CAN identifiers.
+  m_FilterSet.addMask(0x00000000UL, 0x00000000UL, TBX_FALSE);
+  m_FilterSet.addMask(0x00000000UL, 0x00000000UL, TBX_TRUE);
+  m_FilterBankCount = buildFilterBanks(m_FilterSet, m_FilterBanks.data());
   // CAN TX and RX GPIO pin configuration.
   GPIO_InitStruct.Pin = LL_GPIO_PIN_8 | LL_GPIO_PIN_9;
   GPIO_InitStruct.Mode = LL_GPIO_MODE_ALTERNATE;
@@ -115,51 +252,240 @@ BxCan::~BxCan()
 
 
 ///**************************************************************************************
-/// \brief     Configures the CAN controller and synchronizes to the CAN bus.
-/// \param     t_Baudrate Desired communication speed.
+/// \brief     Starts connecting to the CAN bus. The method returns immediately. The
+///            driver's task completes the connection in the background, by polling the
+///            hardware handshakes for entering and leaving the initialization mode. The
+///            bxCAN does not offer an interrupt for these handshakes. Once synchronized
+///            to the CAN bus, the onConnected event handler is called.
+/// \param     t_Baudrate Desired communication speed. Besides the standard baudrates,
+///            any other bitrate up to 1 Mbit/s is supported. Specify it with a
+///            static_cast, for example static_cast<Can::Baudrate>(83333).
 ///
 ///**************************************************************************************
 void BxCan::connect(Baudrate t_Baudrate)
 {
-  constexpr uint32_t maxLoopCntInitAck = 10000000UL;
-  volatile  uint32_t initAckLoopCnt;
-  uint16_t           prescaler = 8U;
-  uint8_t            tseg1 = 6U;
-  uint8_t            tseg2 = 2U;
-  uint8_t            sjw;
-  uint8_t            bitTimingSettingsFound;
-
   // Make sure that we're in the disconnected state, before connecting.
   disconnect();
   // Store the baudrate.
   m_Baudrate = t_Baudrate;
+  // Start a new connection with the shortest bus off recovery backoff time.
+  m_BusOffBackoffMs = 0U;
 
-  // Enter initialization mode.
+  // Request initialization mode.
   CLEAR_BIT(CAN->MCR, CAN_MCR_SLEEP);
   SET_BIT(CAN->MCR, CAN_MCR_INRQ);
-  // Wait for hardware handshake with timeout to not hang the system, in case the CAN
-  // controller is malfunctioning. No need to take further action, because in such a
-  // case, the CAN controller won't work properly anyways.
-  initAckLoopCnt = maxLoopCntInitAck;
-  while ((READ_BIT(CAN->MSR, CAN_MSR_INAK) == 0U) && (initAckLoopCnt > 0U))
+  // Hand the remainder of the connection procedure over to the task.
+  m_ConnectStateTicks = xTaskGetTickCount();
+  m_ConnectState = ENTERINIT;
+  xTaskNotifyGive(GetHandle());
+}
+
+
+///**************************************************************************************
+/// \brief     Continues the connection procedure, based on the current connection state.
+///            Called by the task.
+///
+///**************************************************************************************
+void BxCan::processConnect()
+{
+  uint8_t timedOut = TBX_FALSE;
+
+  // Check if the hardware handshake takes too long. This could happen in case the CAN
+  // controller is malfunctioning or in case the bus is stuck dominant when leaving the
+  // initialization mode. No need to take further action, because in such a case, the
+  // CAN controller won't work properly anyways. Just continue.
+  if ((xTaskGetTickCount() - m_ConnectStateTicks) >= 
+      cpp_freertos::Ticks::MsToTicks(c_InitAckTimeoutMs))
+  {
+    timedOut = TBX_TRUE;
+  }
+  // Waiting for the hardware handshake of entering the initialization mode?
+  if (m_ConnectState == ENTERINIT)
+  {
+    if ((READ_BIT(CAN->MSR, CAN_MSR_INAK) != 0U) || (timedOut == TBX_TRUE))
+    {
+      // Configure the CAN controller, now that it is in initialization mode.
+      configureController();
+      // Leave initialization mode. The hardware acknowledges this, once it synchronized
+      // to the CAN bus.
+      CLEAR_BIT(CAN->MCR, CAN_MCR_INRQ);
+      m_ConnectStateTicks = xTaskGetTickCount();
+      m_ConnectState = LEAVEINIT;
+    }
+  }
+  // Waiting for the hardware handshake of leaving the initialization mode?
+  else if (m_ConnectState == LEAVEINIT)
+  {
+    if ((READ_BIT(CAN->MSR, CAN_MSR_INAK) == 0U) || (timedOut == TBX_TRUE))
+    {
+      // Update connection state.
+      m_ConnectState = ONLINE;
+      m_ConnectStateTicks = xTaskGetTickCount();
+      // Already connected? Then this completes a bus off recovery.
+      if (m_Connected == TBX_TRUE)
+      {
+        // Frames that waited in the transmit mailboxes during the recovery, get a
+        // fresh transmit deadline.
+        uint32_t nowCycles = DWT->CYCCNT;
+        TbxCriticalSectionEnter();
+        m_TxMailboxCycles.fill(nowCycles);
+        TbxCriticalSectionExit();
+        // Keep track of the number of bus off recoveries.
+        m_BusOffRecoveryCount++;
+        // Trigger the event handler, if assigned.
+        if (onBusOffRecovered)
+        {
+          onBusOffRecovered();
+        }
+      }
+      else
+      {
+        m_Connected = TBX_TRUE;
+        // Trigger the event handler, if assigned.
+        if (onConnected)
+        {
+          onConnected();
+        }
+      }
+    }
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Drives the automatic bus off recovery. After a bus off event, the task
+///            waits for the backoff time, before it starts the recovery. The recovery
+///            enters and leaves the initialization mode, just like a connection does.
+///            The CAN controller then goes back on the bus, after it detected 128
+///            occurrences of 11 consecutive recessive bits. The backoff time doubles
+///            with each bus off event that follows shortly after a recovery. Called by
+///            the task.
+///
+///**************************************************************************************
+void BxCan::processBusOffRecovery()
+{
+  TickType_t elapsedTicks = xTaskGetTickCount() - m_ConnectStateTicks;
+
+  // Waiting for the backoff time to pass, before recovering from bus off?
+  if (m_ConnectState == RECOVERING)
+  {
+    if (elapsedTicks >= cpp_freertos::Ticks::MsToTicks(m_BusOffBackoffMs))
+    {
+      // Request initialization mode. The connection procedure completes the recovery.
+      SET_BIT(CAN->MCR, CAN_MCR_INRQ);
+      m_ConnectStateTicks = xTaskGetTickCount();
+      m_ConnectState = ENTERINIT;
+    }
+  }
+  // Stayed on the bus long enough to consider the bus stable again? Then start over
+  // with the shortest backoff time, upon the next bus off event.
+  else if ((m_ConnectState == ONLINE) && (m_BusOffBackoffMs != 0U))
+  {
+    if (elapsedTicks >= cpp_freertos::Ticks::MsToTicks(m_BusOffBackoffMaxMs))
+    {
+      m_BusOffBackoffMs = 0U;
+    }
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Sets the backoff time of the automatic bus off recovery. The first
+///            recovery attempt starts after the minimum backoff time. Each bus off
+///            event that directly follows a recovery, doubles the backoff time, up to
+///            the maximum backoff time.
+/// \param     t_MinMs Minimum backoff time in milliseconds. Set to 0 to disable the
+///            automatic bus off recovery. The driver then disconnects upon bus off.
+/// \param     t_MaxMs Maximum backoff time in milliseconds.
+///
+///**************************************************************************************
+void BxCan::setBusOffBackoff(uint32_t t_MinMs, uint32_t t_MaxMs)
+{
+  // Verify parameters.
+  TBX_ASSERT(t_MaxMs >= t_MinMs);
+
+  // Only continue with valid parameters.
+  if (t_MaxMs >= t_MinMs)
   {
-    initAckLoopCnt--;
+    // Store the backoff times.
+    m_BusOffBackoffMinMs = t_MinMs;
+    m_BusOffBackoffMaxMs = t_MaxMs;
   }
+}
+
+
+///**************************************************************************************
+/// \brief     Updates the error status snapshot from the value of the error status
+///            register. Counts the transitions to the error warning and error passive
+///            states.
+/// \attention Called by both the error interrupt and the task. The task should call it
+///            from within a critical section.
+/// \param     t_Esr Value of the error status register.
+///
+///**************************************************************************************
+void BxCan::updateErrorStatus(uint32_t t_Esr)
+{
+  ErrorState errorState = ERRORACTIVE;
+  uint8_t lastErrorCode = (t_Esr & CAN_ESR_LEC) >> CAN_ESR_LEC_Pos;
+
+  // Determine the error state from the error flags.
+  if ((t_Esr & CAN_ESR_BOFF) != 0U)
+  {
+    errorState = ERRORBUSOFF;
+  }
+  else if ((t_Esr & CAN_ESR_EPVF) != 0U)
+  {
+    errorState = ERRORPASSIVE;
+  }
+  else if ((t_Esr & CAN_ESR_EWGF) != 0U)
+  {
+    errorState = ERRORWARNING;
+  }
+  // Keep track of the number of times the error warning and error passive states were
+  // entered.
+  if ((errorState >= ERRORWARNING) && (m_ErrorState < ERRORWARNING))
+  {
+    m_ErrorWarningCount = m_ErrorWarningCount + 1U;
+  }
+  if ((errorState >= ERRORPASSIVE) && (m_ErrorState < ERRORPASSIVE))
+  {
+    m_ErrorPassiveCount = m_ErrorPassiveCount + 1U;
+  }
+  // Store the snapshot. The hardware resets the last error code to 0, as soon as a
+  // frame was transferred without error. Only store actual error codes, such that the
+  // last detected error remains visible.
+  m_ErrorState = errorState;
+  m_TxErrorCounter = (t_Esr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos;
+  m_RxErrorCounter = (t_Esr & CAN_ESR_REC) >> CAN_ESR_REC_Pos;
+  if ((lastErrorCode != 0U) && (lastErrorCode != 7U))
+  {
+    m_LastErrorCode = lastErrorCode;
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Configures the CAN controller. Should only be called while in
+///            initialization mode.
+///
+///**************************************************************************************
+void BxCan::configureController()
+{
+  BxCanBitTiming bitTiming{ 8U, 6U, 2U, 2U };
+  uint8_t bitTimingSettingsFound;
 
   // Attempt to find fitting bit timing settings.
-  bitTimingSettingsFound = findBitTimingSettings(prescaler, tseg1, tseg2);
+  bitTimingSettingsFound = findBitTimingSettings(bitTiming);
   // Trigger assertion in case no valid bit timing settings could be found. This would
   // indicate a configuration issue that can be fixed by changing the CAN baudrate or
   // the frequency of the clock that drives the CAN peripheral.
   TBX_ASSERT(bitTimingSettingsFound == TBX_OK);
   // Configure the bit timing settings.
   CLEAR_BIT(CAN->BTR, CAN_BTR_BRP | CAN_BTR_TS1 | CAN_BTR_TS2 | CAN_BTR_SJW);
-  SET_BIT(CAN->BTR, (prescaler - 1U) << CAN_BTR_BRP_Pos);
-  SET_BIT(CAN->BTR, (tseg1 - 1U) << CAN_BTR_TS1_Pos);
-  SET_BIT(CAN->BTR, (tseg2 - 1U) << CAN_BTR_TS2_Pos);
-  // Set SJW as big as possible (4), but no more than tseg2.
-  sjw = (tseg2 > 4U) ? 4U : tseg2;
-  SET_BIT(CAN->BTR, (sjw - 1U) << CAN_BTR_SJW_Pos);
+  SET_BIT(CAN->BTR, (bitTiming.prescaler - 1U) << CAN_BTR_BRP_Pos);
+  SET_BIT(CAN->BTR, (bitTiming.tseg1 - 1U) << CAN_BTR_TS1_Pos);
+  SET_BIT(CAN->BTR, (bitTiming.tseg2 - 1U) << CAN_BTR_TS2_Pos);
+  SET_BIT(CAN->BTR, (bitTiming.sjw - 1U) << CAN_BTR_SJW_Pos);
 
   // Configure transmit priority by request order. Essentially making the 3 transmit
   // mailboxes behave as a FIFO.
@@ -168,7 +494,8 @@ void BxCan::connect(Baudrate t_Baudrate)
   CLEAR_BIT(CAN->MCR, CAN_MCR_NART);
   // Make sure time triggered communication mode is disabled.
   CLEAR_BIT(CAN->MCR, CAN_MCR_TTCM);
-  // Disable automatic bus off recovery.
+  // Disable automatic bus off recovery. The task recovers from bus off, after a backoff
+  // time.
   CLEAR_BIT(CAN->MCR, CAN_MCR_ABOM);
   // Discard incoming message in case of reception FIFO overrun.
   SET_BIT(CAN->MCR, CAN_MCR_RFLM);
@@ -176,95 +503,26 @@ void BxCan::connect(Baudrate t_Baudrate)
   // that this is a special register. You need to directly write the RQCP bit values.
   WRITE_REG(CAN->TSR, CAN_TSR_RQCP0 | CAN_TSR_RQCP1 | CAN_TSR_RQCP2);
 
+  // Program the reception filter banks. The critical section prevents setFilterSet()
+  // from rebuilding the filter bank settings in the meantime.
+  TbxCriticalSectionEnter();
   // Enter reception filter initialization mode.
   SET_BIT(CAN->FMR, CAN_FMR_FINIT);
-  // For receiving just 11-bit identifiers, use only FIFO0 with filter 0.
-  if (m_Filter.mode == CanFilter::STD)
-  {
-    // Select identifier mask mode for filter 0.
-    CLEAR_BIT(CAN->FM1R, CAN_FM1R_FBM0);
-    // Select single 32-bit scaling for filter 0.
-    SET_BIT(CAN->FS1R, CAN_FS1R_FSC0);
-    // Set the filter's code and mask bits for 11-bit standard identifiers.
-    WRITE_REG(CAN->sFilterRegister[0].FR1, m_Filter.code << 21U);
-    WRITE_REG(CAN->sFilterRegister[0].FR2, m_Filter.mask << 21U);
-    SET_BIT(CAN->sFilterRegister[0].FR2, CAN_F0R2_FB2); // IDE bit
-    // Assign filter 0 to FIFO0.
-    CLEAR_BIT(CAN->FFA1R, CAN_FFA1R_FFA0);
-    // Activate filter 0.
-    SET_BIT(CAN->FA1R, CAN_FA1R_FACT0);
-  }
-  // For receiving just 29-bit identifiers, use only FIFO0 with filter 0.
-  else if (m_Filter.mode == CanFilter::EXT)
-  {
-    // Select identifier mask mode for filter 0.
-    CLEAR_BIT(CAN->FM1R, CAN_FM1R_FBM0);
-    // Select single 32-bit scaling for filter 0.
-    SET_BIT(CAN->FS1R, CAN_FS1R_FSC0);
-    // Set the filter's code and mask bits for 29-bit extended identifiers.
-    WRITE_REG(CAN->sFilterRegister[0].FR1, m_Filter.code << 3U);
-    SET_BIT(CAN->sFilterRegister[0].FR1, CAN_F0R1_FB2); // IDE bit
-    WRITE_REG(CAN->sFilterRegister[0].FR2, m_Filter.mask << 3U);
-    SET_BIT(CAN->sFilterRegister[0].FR2, CAN_F0R2_FB2); // IDE bit
-    // Assign filter 0 to FIFO0.
-    CLEAR_BIT(CAN->FFA1R, CAN_FFA1R_FFA0);
-    // Activate filter 0.
-    SET_BIT(CAN->FA1R, CAN_FA1R_FACT0);
-  }
-  // For receiving both 11-bit and 29-bit identifers, use FIFO0 with filter 0 for the
-  // 11-bit CAN identifiers and FIFO1 with filter 1 for the 29-bit CAN identifiers.
-  else
-  {
-    // Select identifier mask mode for filter 0.
-    CLEAR_BIT(CAN->FM1R, CAN_FM1R_FBM0);
-    // Select single 32-bit scaling for filter 0.
-    SET_BIT(CAN->FS1R, CAN_FS1R_FSC0);
-    // Set the filter's code and mask bits for 11-bit standard identifiers.
-    WRITE_REG(CAN->sFilterRegister[0].FR1, m_Filter.code << 21U);
-    WRITE_REG(CAN->sFilterRegister[0].FR2, m_Filter.mask << 21U);
-    SET_BIT(CAN->sFilterRegister[0].FR2, CAN_F0R2_FB2); // IDE bit
-    // Assign filter 0 to FIFO0.
-    CLEAR_BIT(CAN->FFA1R, CAN_FFA1R_FFA0);
-    // Activate filter 0.
-    SET_BIT(CAN->FA1R, CAN_FA1R_FACT0);
-
-    // Select identifier mask mode for filter 1.
-    CLEAR_BIT(CAN->FM1R, CAN_FM1R_FBM1);
-    // Select single 32-bit scaling for filter 1.
-    SET_BIT(CAN->FS1R, CAN_FS1R_FSC1);
-    // Set the filter's code and mask bits for 29-bit extended identifiers.
-    WRITE_REG(CAN->sFilterRegister[1].FR1, m_Filter.code << 3U);
-    SET_BIT(CAN->sFilterRegister[1].FR1, CAN_F1R1_FB2); // IDE bit
-    WRITE_REG(CAN->sFilterRegister[1].FR2, m_Filter.mask << 3U);
-    SET_BIT(CAN->sFilterRegister[1].FR2, CAN_F1R2_FB2); // IDE bit
-    // Assign filter 1 to FIFO1.
-    SET_BIT(CAN->FFA1R, CAN_FFA1R_FFA1);
-    // Activate filter 1.
-    SET_BIT(CAN->FA1R, CAN_FA1R_FACT1);
-  }
+  // Program the reception filter banks.
+  applyFilterBanks();
   // Leave reception filter initialization mode.
   CLEAR_BIT(CAN->FMR, CAN_FMR_FINIT);
+  TbxCriticalSectionExit();
 
   // Enable transmit mailbox empty interrupt.
   SET_BIT(CAN->IER, CAN_IER_TMEIE);
   // Enable FIFO message pending interrupt for both FIFOs.
   SET_BIT(CAN->IER, CAN_IER_FMPIE0 | CAN_IER_FMPIE1);
-  // Enable bus off error interrupt.
-  SET_BIT(CAN->IER, CAN_IER_ERRIE | CAN_IER_BOFIE);
-
-  // Leave initialization mode.
-  CLEAR_BIT(CAN->MCR, CAN_MCR_INRQ);
-  // Wait for hardware handshake with timeout to not hang the system, in case the CAN
-  // controller is malfunctioning. No need to take further action, because in such a
-  // case, the CAN controller won't work properly anyways.
-  initAckLoopCnt = maxLoopCntInitAck;
-  while ((READ_BIT(CAN->MSR, CAN_MSR_INAK) != 0U) && (initAckLoopCnt > 0U))
-  {
-    initAckLoopCnt--;
-  }
-
-  // Update connection state flag.
-  m_Connected = TBX_TRUE;
+  // Enable the error warning, error passive and bus off error interrupts. Note that the
+  // last error code interrupt stays disabled on purpose. It would trigger for each
+  // error frame, which could flood the CPU on a disturbed bus. The last error code is
+  // sampled instead.
+  SET_BIT(CAN->IER, CAN_IER_ERRIE | CAN_IER_EWGIE | CAN_IER_EPVIE | CAN_IER_BOFIE);
 }
 
 
@@ -274,12 +532,18 @@ void BxCan::connect(Baudrate t_Baudrate)
 ///**************************************************************************************
 void BxCan::disconnect()
 {
-  // Only continue if actually connected.
-  if (m_Connected == TBX_TRUE)
+  // Only continue if actually connected or connecting.
+  if (m_ConnectState != OFFLINE)
   {
-    // Update connection state flag.
+    // Update connection state.
+    m_ConnectState = OFFLINE;
     m_Connected = TBX_FALSE;
 
+    // Discard the frames that are still waiting in the software transmit queue.
+    TbxCriticalSectionEnter();
+    m_TxQueueTail = m_TxQueueHead;
+    TbxCriticalSectionExit();
+
     // Bring the CAN peripheral back into its reset state.
     LL_APB1_GRP1_ForceReset(LL_APB1_GRP1_PERIPH_CAN);
     LL_APB1_GRP1_ReleaseReset(LL_APB1_GRP1_PERIPH_CAN);
@@ -288,30 +552,214 @@ void BxCan::disconnect()
 
 
 ///**************************************************************************************
-/// \brief     Sets the message reception acceptance filter. Automatically reconnects,
-///            if the driver is in the connected state when calling this method.
+/// \brief     Sets the message reception acceptance filter. When connected, the filter
+///            is updated in place, while the CAN controller stays on the bus.
 /// \param     t_Filter Message reception acceptance filter.
 ///
 ///**************************************************************************************
 void BxCan::setFilter(CanFilter& t_Filter)
 {
-  // Store current connection state.
-  uint8_t wasConnected = m_Connected;
+  // The reception interrupts read the filter set, while the software acceptance filter
+  // is active. Suspend it, before touching the filter set.
+  m_SwFilterActive = TBX_FALSE;
+  // Convert the filter to a filter set. Do so directly in the member, to keep the stack
+  // usage low. Note that a set with just one or two entries always fits.
+  m_FilterSet.clear();
+  if (t_Filter.mode != CanFilter::EXT)
+  {
+    m_FilterSet.addMask(t_Filter.code, t_Filter.mask, TBX_FALSE);
+  }
+  if (t_Filter.mode != CanFilter::STD)
+  {
+    m_FilterSet.addMask(t_Filter.code, t_Filter.mask, TBX_TRUE);
+  }
+  // Apply the filter set.
+  static_cast<void>(setFilterSet(m_FilterSet));
+}
 
-  // Make sure that we're in the disconnected state, before updating the filter.
-  disconnect();
-  // Copy and store the filter settings.
-  m_Filter = t_Filter;
-  // Reconnect if needed.
-  if (wasConnected == TBX_TRUE)
+
+///**************************************************************************************
+/// \brief     Sets the message reception acceptance filter set. When connected, the
+///            filter banks are updated in place, using just the filter initialization
+///            mode. The CAN controller stays on the bus, so there is no need for a
+///            reconnect and the bus synchronization that comes with it. If the set needs
+///            more filter banks than available, the hardware accepts a superset of it
+///            and the software acceptance filter rejects the remaining frames in the
+///            reception interrupts.
+/// \details   The software acceptance filter is suspended while its lookup structures
+///            are rebuilt. In the meantime, frames that the previous filter banks
+///            accept are passed on, even if they are not part of the new set.
+/// \param     t_FilterSet Message reception acceptance filter set.
+/// \return    TBX_OK, because the set is always applied as a whole.
+///
+///**************************************************************************************
+uint8_t BxCan::setFilterSet(CanFilterSet const& t_FilterSet)
+{
+  uint8_t swFilterNeeded = TBX_FALSE;
+
+  // The reception interrupts read the filter set and the lookup structures, while the
+  // software acceptance filter is active. Suspend it, before touching these. The
+  // reception interrupts have a higher priority than this task, so no interrupt can
+  // still be busy with them, once the flag is cleared.
+  m_SwFilterActive = TBX_FALSE;
+  __DMB();
+  // Copy and store the filter set.
+  m_FilterSet = t_FilterSet;
+  m_HwFilterSet = t_FilterSet;
+  // Reduce the set for the hardware, if it needs more filter banks than available.
+  if (buildFilterBanks(m_HwFilterSet, nullptr) > c_FilterBankCount)
   {
-    connect(m_Baudrate);
+    CanFilterCompiler filterCompiler(c_FilterBankCount);
+    // Should the reduction fail, simply let the hardware accept all frames. The
+    // software acceptance filter then does all the work.
+    if (filterCompiler.reduce(m_HwFilterSet) != TBX_OK)
+    {
+      m_HwFilterSet.clear();
+      m_HwFilterSet.addMask(0x00000000UL, 0x00000000UL, TBX_FALSE);
+      m_HwFilterSet.addMask(0x00000000UL, 0x00000000UL, TBX_TRUE);
+    }
+    // Build the software acceptance filter.
+    buildSwFilter();
+    swFilterNeeded = TBX_TRUE;
+  }
+  // The task reads the filter bank settings, when it configures the CAN controller
+  // while completing a connection in the background. The critical section prevents it
+  // from doing so, while the settings are rebuilt and programmed.
+  TbxCriticalSectionEnter();
+  // Convert the filter set to filter bank settings.
+  m_FilterBankCount = buildFilterBanks(m_HwFilterSet, m_FilterBanks.data());
+  // Update the filter banks in place, if connected or connecting. Otherwise connect()
+  // programs them.
+  if (m_ConnectState != OFFLINE)
+  {
+    // Enter reception filter initialization mode.
+    SET_BIT(CAN->FMR, CAN_FMR_FINIT);
+    // Program the reception filter banks.
+    applyFilterBanks();
+    // Leave reception filter initialization mode.
+    CLEAR_BIT(CAN->FMR, CAN_FMR_FINIT);
+  }
+  TbxCriticalSectionExit();
+  // Make sure the lookup structures are completely written, before (re)activating the
+  // software acceptance filter.
+  __DMB();
+  m_SwFilterActive = swFilterNeeded;
+  // Give the result back to the caller.
+  return TBX_OK;
+}
+
+
+///**************************************************************************************
+/// \brief     Builds the lookup structures of the software acceptance filter from the
+///            filter set. For 11-bit identifiers this is a bitmap with one bit per
+///            identifier. For 29-bit identifiers this is a sorted table with the exact
+///            identifiers. The 29-bit code/mask pairs are checked directly on the
+///            filter set.
+///
+///**************************************************************************************
+void BxCan::buildSwFilter()
+{
+  // Build the bitmap for the 11-bit identifiers. Set the bits per entry, such that the
+  // work depends on the number of identifiers the entries accept, instead of on all
+  // possible identifiers times the number of entries.
+  m_SwStdIdBitmap.fill(0U);
+  for (size_t idx = 0U; idx < m_FilterSet.size(); idx++)
+  {
+    CanFilterEntry const& entry = m_FilterSet[idx];
+    uint32_t careBits = entry.mask & CanMsg::c_StdIdMax;
+    // Only process 11-bit entries that can match at all. An entry with a code bit that
+    // its mask does not care about, never matches.
+    if ((entry.ext == TBX_FALSE) && ((entry.code & ~careBits) == 0U))
+    {
+      // Walk all combinations of the don't care bits. For an exact identifier there are
+      // none, so just the identifier itself is set.
+      uint32_t dontCareBits = ~careBits & CanMsg::c_StdIdMax;
+      uint32_t combination = 0U;
+      uint8_t done = TBX_FALSE;
+      while (done == TBX_FALSE)
+      {
+        uint32_t id = entry.code | combination;
+        m_SwStdIdBitmap[id / 32U] |= (1UL << (id % 32U));
+        // Continue with the next combination. It wraps back to zero after the last one.
+        combination = (combination - dontCareBits) & dontCareBits;
+        done = (combination == 0U) ? TBX_TRUE : TBX_FALSE;
+      }
+    }
+  }
+  // Build the sorted table for the exact 29-bit identifiers.
+  m_SwExtIdCount = 0U;
+  for (size_t idx = 0U; idx < m_FilterSet.size(); idx++)
+  {
+    CanFilterEntry const& entry = m_FilterSet[idx];
+    if ((entry.ext == TBX_TRUE) && (entry.exact() == TBX_TRUE))
+    {
+      m_SwExtIds[m_SwExtIdCount] = entry.code;
+      m_SwExtIdCount++;
+    }
   }
+  std::sort(m_SwExtIds.begin(), m_SwExtIds.begin() + m_SwExtIdCount);
 }
 
 
 ///**************************************************************************************
-/// \brief     Submits a message for transmission on the CAN bus.
+/// \brief     Checks if a received frame passes the software acceptance filter.
+/// \param     t_Rir Value of the frame's identifier register.
+/// \return    TBX_TRUE if the frame is accepted, TBX_FALSE otherwise.
+///
+///**************************************************************************************
+uint8_t BxCan::swFilterAcceptsFromISR(uint32_t t_Rir) const
+{
+  uint8_t result = TBX_TRUE;
+
+  // Only filter if the software acceptance filter is active. Otherwise the hardware
+  // filter banks already did all the work.
+  if (m_SwFilterActive == TBX_TRUE)
+  {
+    // 11-bit identifier? Look it up in the bitmap.
+    if ((t_Rir & CAN_RI0R_IDE) == 0U)
+    {
+      uint32_t id = t_Rir >> 21U;
+      result = ((m_SwStdIdBitmap[id / 32U] & (1UL << (id % 32U))) != 0U) ? TBX_TRUE : 
+                                                                           TBX_FALSE;
+    }
+    // 29-bit identifier. Look it up in the sorted table and otherwise try the code/mask
+    // pairs.
+    else
+    {
+      uint32_t id = t_Rir >> 3U;
+      result = std::binary_search(m_SwExtIds.begin(), 
+                                  m_SwExtIds.begin() + m_SwExtIdCount, id) ? TBX_TRUE :
+                                                                             TBX_FALSE;
+      for (size_t idx = 0U; (idx < m_FilterSet.size()) && (result == TBX_FALSE); idx++)
+      {
+        CanFilterEntry const& entry = m_FilterSet[idx];
+        if ((entry.ext == TBX_TRUE) && ((id & entry.mask) == entry.code))
+        {
+          result = TBX_TRUE;
+        }
+      }
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Submits a message for transmission on the CAN bus. The message directly
+///            goes into an empty transmit mailbox, if one is available. Otherwise it is
+///            buffered in the software transmit queue, from where the transmit interrupt
+///            moves it into a mailbox, as soon as one becomes empty.
+/// \details   The transmit interrupt is the only consumer of the transmit queue. The
+///            producer side still runs in a critical section, because it is not a
+///            single producer: the gateway on the USB task, the XCP loader task and the
+///            XCP Connect retransmission on the application task all call this method.
+///            Furthermore, checking for an empty queue and writing directly to a
+///            transmit mailbox must be atomic with respect to the transmit interrupt.
+///            Otherwise the interrupt could empty the last busy mailbox right after
+///            this method found no empty one. The frame then waits in the queue for a
+///            transmit interrupt that never comes. The critical section only spans a
+///            few register accesses and the copy of four words.
 /// \param     t_Msg The message to transmit.
 /// \return    TBX_OK if successful, TBX_ERROR otherwise.
 ///
@@ -319,61 +767,76 @@ void BxCan::setFilter(CanFilter& t_Filter)
 uint8_t BxCan::transmit(CanMsg& t_Msg)
 {
   uint8_t result = TBX_ERROR;
-  uint8_t txMbEmptyIdx;
-  // Lookup table indexed with the TSR->TMEx bits value. In return it gives the index
-  // of the first empty transmit mailbox. Made static to lower ROM and stack load.
-  static const uint8_t txMbIdxEmptyLookup[] =
-  {
-    c_InvalidMailboxIdx, // %000 - All mailboxes are busy.
-    0U,                  // %001 - Mailbox 1 is available.
-    1U,                  // %010 - Mailbox 2 is available.
-    0U,                  // %011 - Mailbox 1 is available.
-    2U,                  // %100 - Mailbox 3 is available.
-    0U,                  // %101 - Mailbox 1 is available.
-    1U,                  // %110 - Mailbox 2 is available.
-    0U                   // %111 - Mailbox 1 is available.
-  };
+  BxCanFrame txFrame;
 
   // Only continue if actually connected.
   if (m_Connected == TBX_TRUE)
   {
-    // Obtain mutual exclusive access to the transmit mailboxes.
+    // Convert the message to the transmit mailbox register layout.
+    if (t_Msg.ext() == TBX_TRUE)
+    {
+      // Store 29-bit identifier and set the IDE bit.
+      txFrame.ir = (t_Msg.id() << 3U) | CAN_TI0R_IDE;
+    }
+    else
+    {
+      // Store 11-bit identifier in a way that also resets the IDE bit.
+      txFrame.ir = t_Msg.id() << 21U;
+    }
+    txFrame.dtr = (t_Msg.len() << CAN_TDT0R_DLC_Pos) & CAN_TDT0R_DLC;
+    txFrame.dlr =  t_Msg[0]         | (t_Msg[1] << 8U) | 
+                  (t_Msg[2] << 16U) | (t_Msg[3] << 24U);
+    txFrame.dhr =  t_Msg[4]         | (t_Msg[5] << 8U) | 
+                  (t_Msg[6] << 16U) | (t_Msg[7] << 24U);
+
+    // Obtain mutual exclusive access to the transmit mailboxes and the transmit queue.
     TbxCriticalSectionEnter();
-    // Get first free transmit mailbox index by feeding the value of the TMEx bits into
-    // the lookup table.
-    uint8_t tmeBits = READ_BIT(CAN->TSR, CAN_TSR_TME) >> CAN_TSR_TME_Pos;
-    txMbEmptyIdx = txMbIdxEmptyLookup[tmeBits];
-    // Only continue with transmission if an empty mailbox is available.
-    if (txMbEmptyIdx != c_InvalidMailboxIdx)
-    {
-      // Write the identifier to the mailbox.
-      if (t_Msg.ext() == TBX_TRUE)
+    // Only write directly to a mailbox if no frames are waiting in the transmit queue.
+    // Otherwise this frame would overtake the ones that were submitted before it.
+    if (m_TxQueueHead == m_TxQueueTail)
+    {
+      uint8_t txMbEmptyIdx = findEmptyTxMailbox();
+      // Only continue with transmission if an empty mailbox is available.
+      if (txMbEmptyIdx != c_InvalidMailboxIdx)
       {
-        // Write 29-bit identifier and set the IDE bit.
-        WRITE_REG(CAN->sTxMailBox[txMbEmptyIdx].TIR, t_Msg.id() << 3U);
-        SET_BIT(CAN->sTxMailBox[txMbEmptyIdx].TIR, CAN_TI0R_IDE); // IDE bit
+        // Write the frame to the mailbox and request its transmission.
+        writeTxMailbox(txMbEmptyIdx, txFrame);
+        // Update the result.
+        result = TBX_OK;
+      }
+    }
+    // Frame not yet submitted to a mailbox? Then add it to the transmit queue.
+    if (result != TBX_OK)
+    {
+      size_t nextHead = (m_TxQueueHead + 1U) % m_TxQueueSlots;
+      // Only continue if the transmit queue is not yet full.
+      if (nextHead != m_TxQueueTail)
+      {
+        // Store the frame and commit it to the queue.
+        m_TxQueue[m_TxQueueHead] = txFrame;
+        m_TxQueueHead = nextHead;
+        // Update the high-water mark of the transmit queue.
+        size_t queued = (m_TxQueueHead + m_TxQueueSlots - m_TxQueueTail) % 
+                        m_TxQueueSlots;
+        if (queued > m_TxQueueHighWaterMark)
+        {
+          m_TxQueueHighWaterMark = queued;
+        }
+        // Update the result.
+        result = TBX_OK;
       }
       else
       {
-        // Write 11-bit identifier in a way that also resets the IDE bit.
-        WRITE_REG(CAN->sTxMailBox[txMbEmptyIdx].TIR, t_Msg.id() << 21U);
+        // Keep track of the number of frames that did not fit.
+        m_TxQueueOverflowCount++;
       }
-      // Write the data length code (DLC).
-      CLEAR_BIT(CAN->sTxMailBox[txMbEmptyIdx].TDTR, CAN_TDT0R_DLC);
-      SET_BIT(CAN->sTxMailBox[txMbEmptyIdx].TDTR, t_Msg.len() << CAN_TDT0R_DLC_Pos);
-      // Write the data bytes.
-      uint32_t dataLow  =  t_Msg[0]         | (t_Msg[1] << 8U) | 
-                          (t_Msg[2] << 16U) | (t_Msg[3] << 24U);
-      uint32_t dataHigh =  t_Msg[4]         | (t_Msg[5] << 8U) | 
-                          (t_Msg[6] << 16U) | (t_Msg[7] << 24U);
-      WRITE_REG(CAN->sTxMailBox[txMbEmptyIdx].TDLR, dataLow);
-      WRITE_REG(CAN->sTxMailBox[txMbEmptyIdx].TDHR, dataHigh);
-      // Request start of message for transmission.
-      SET_BIT(CAN->sTxMailBox[txMbEmptyIdx].TIR, CAN_TI0R_TXRQ);
-      // Update the result.
-      result = TBX_OK;
     }
-    // Release mutual exclusive access to the transmit mailboxes.
+    // Keep track of the number of frames that are on their way.
+    if (result == TBX_OK)
+    {
+      m_TxFrameCount++;
+    }
+    // Release mutual exclusive access to the transmit mailboxes and the transmit queue.
     TbxCriticalSectionExit();
   }
   // Give the result back to the caller.
@@ -383,17 +846,66 @@ uint8_t BxCan::transmit(CanMsg& t_Msg)
 
 ///**************************************************************************************
 /// \brief     CAN communication event task function.
+/// \details   The interrupts store their events directly in the event pool and notify
+///            this task. The event pool operates as a single producer, single consumer
+///            ring buffer. The interrupts are the producer. They all run on the same
+///            priority, so they never interrupt each other. This task is the consumer.
+///            An event slot is released only after this task processed it, so no
+///            further copy of the event is needed.
 ///
 ///**************************************************************************************
 void BxCan::Run()
 {
-  BxCanEvent canEvent;
+  const TickType_t swFilterRatePeriod = cpp_freertos::Ticks::MsToTicks(1000U);
+  CanMsg canMsg;
+  TickType_t swFilterRateTicks = xTaskGetTickCount();
+  uint32_t swFilterDropCountLast = 0U;
 
   for (;;)
   {
-    // Wait for an event to show up in the queue.
-    if (m_EventQueue->Dequeue(&canEvent, cpp_freertos::Ticks::MsToTicks(100U)))
+    // Wait for the interrupts to signal the presence of new events. Poll more often
+    // while a connection or bus off recovery is in progress or while frames are
+    // waiting in the transmit mailboxes, for checking their transmit deadline.
+    if ((m_ConnectState == ENTERINIT) || (m_ConnectState == LEAVEINIT) ||
+        (m_ConnectState == RECOVERING))
+    {
+      (void)ulTaskNotifyTake(pdTRUE, 1U);
+      processBusOffRecovery();
+      processConnect();
+    }
+    else if ((m_TxDeadlineCycles != 0U) && (m_ConnectState == ONLINE) &&
+             (READ_BIT(CAN->TSR, CAN_TSR_TME) != CAN_TSR_TME))
+    {
+      (void)ulTaskNotifyTake(pdTRUE, cpp_freertos::Ticks::MsToTicks(c_TxDeadlinePollMs));
+      checkTxDeadlines();
+    }
+    else
+    {
+      (void)ulTaskNotifyTake(pdTRUE, cpp_freertos::Ticks::MsToTicks(100U));
+    }
+    // Update the error status snapshot. The interrupts only signal entering the error
+    // states, so leaving them is detected here.
+    if (m_ConnectState == ONLINE)
+    {
+      processBusOffRecovery();
+      TbxCriticalSectionEnter();
+      updateErrorStatus(READ_REG(CAN->ESR));
+      TbxCriticalSectionExit();
+    }
+    // Update the number of frames that the software acceptance filter dropped during
+    // the last second.
+    if ((xTaskGetTickCount() - swFilterRateTicks) >= swFilterRatePeriod)
+    {
+      uint32_t swFilterDropCount = m_SwFilterDropCount;
+      m_SwFilterDropRate = swFilterDropCount - swFilterDropCountLast;
+      swFilterDropCountLast = swFilterDropCount;
+      swFilterRateTicks = xTaskGetTickCount();
+    }
+    // Process all the events that are waiting in the event pool.
+    while (m_EventTail != m_EventHead)
     {
+      BxCanEvent const& canEvent = m_EventPool[m_EventTail];
+
       // Process the event based on its type.
       switch (canEvent.type)
       {
@@ -402,29 +914,69 @@ void BxCan::Run()
           // Trigger the event handler, if assigned.
           if (onTransmitted)
           {
-            onTransmitted(canEvent.msg);
+            frameToMsg(canEvent.frame, canMsg);
+            onTransmitted(canMsg);
           }
         } 
         break;
       
+        case BxCanEvent::TXABORTED:
+        {
+          // Trigger the event handler, if assigned.
+          if (onTransmitFailed)
+          {
+            frameToMsg(canEvent.frame, canMsg);
+            onTransmitFailed(canMsg);
+          }
+        } 
+        break;
+
         case BxCanEvent::RXINDICATION:
         {
           // Trigger the event handler, if assigned.
           if (onReceived)
           {
-            onReceived(canEvent.msg);
+            frameToMsg(canEvent.frame, canMsg);
+            canMsg.setTimestamp(canEvent.cycles);
+            onReceived(canMsg);
           }
         } 
         break;
 
         case BxCanEvent::BUSOFF:
         {
-          // Disconnect to bring the CAN controller in the offline state.
-          disconnect();
-          // Trigger the event handler, if assigned.
-          if (onBusOff)
+          // Only process the event while on the bus. It could be a left over from
+          // before a disconnect.
+          if (m_ConnectState == ONLINE)
           {
-            onBusOff();
+            // Keep track of the number of bus off events.
+            m_BusOffCount++;
+            // Automatic bus off recovery enabled?
+            if (m_BusOffBackoffMinMs != 0U)
+            {
+              // Double the backoff time, if this bus off event follows shortly after a
+              // recovery. Otherwise start with the minimum backoff time.
+              m_BusOffBackoffMs = (m_BusOffBackoffMs == 0U) ? m_BusOffBackoffMinMs :
+                                  (m_BusOffBackoffMs * 2U);
+              if (m_BusOffBackoffMs > m_BusOffBackoffMaxMs)
+              {
+                m_BusOffBackoffMs = m_BusOffBackoffMaxMs;
+              }
+              // Stay connected, such that frames can still be submitted for
+              // transmission. They go out once recovered.
+              m_ConnectStateTicks = xTaskGetTickCount();
+              m_ConnectState = RECOVERING;
+            }
+            else
+            {
+              // Disconnect to bring the CAN controller in the offline state.
+              disconnect();
+            }
+            // Trigger the event handler, if assigned.
+            if (onBusOff)
+            {
+              onBusOff();
+            }
           }
         } 
         break;
@@ -436,6 +988,10 @@ void BxCan::Run()
         }
         break;
       }
+      // Make sure all accesses to the event slot completed, before releasing it back to
+      // the interrupts.
+      __DMB();
+      m_EventTail = (m_EventTail + 1U) % m_EventPool.size();
     }
   }
 }
@@ -447,89 +1003,63 @@ void BxCan::Run()
 ///**************************************************************************************
 void BxCan::processTxInterrupt()
 {
-  BxCanEvent canEvent;
-  BaseType_t switchRequired = pdFALSE;
+  uint8_t eventsCommitted = TBX_FALSE;
 
   // Process the transmit complete interrupt events.
   while (READ_BIT(CAN->TSR, CAN_TSR_RQCP0 | CAN_TSR_RQCP1 | CAN_TSR_RQCP2) != 0U)
   {
-    uint8_t  txMbDoneIdx = c_InvalidMailboxIdx;
+    uint8_t  txMbDoneIdx;
     uint32_t txMbDoneRQCPbit;
+    uint8_t  txMbDoneOk;
 
     // Decide which transmit mailbox, with a completed request, to process. Store its
-    // RQCP bit value and transmit mailbox index. An invalid transmit mailbox index value
-    // is used to signal that the transmission was not successful.
+    // RQCP bit value, transmit mailbox index and if the transmission was successful.
+    // Note that automatic retransmission is enabled. So a request only completes
+    // without success, if its transmission was aborted.
     if (READ_BIT(CAN->TSR, CAN_TSR_RQCP0) != 0U)
     {
+      txMbDoneIdx = 0U;
       txMbDoneRQCPbit = CAN_TSR_RQCP0;
-      if (READ_BIT(CAN->TSR, CAN_TSR_TXOK0) != 0U)
-      {
-        txMbDoneIdx = 0U;
-      }
+      txMbDoneOk = (READ_BIT(CAN->TSR, CAN_TSR_TXOK0) != 0U) ? TBX_TRUE : TBX_FALSE;
     }
     else if (READ_BIT(CAN->TSR, CAN_TSR_RQCP1) != 0U)
     {
+      txMbDoneIdx = 1U;
       txMbDoneRQCPbit = CAN_TSR_RQCP1;
-      if (READ_BIT(CAN->TSR, CAN_TSR_TXOK1) != 0U)
-      {
-        txMbDoneIdx = 1U;
-      }
+      txMbDoneOk = (READ_BIT(CAN->TSR, CAN_TSR_TXOK1) != 0U) ? TBX_TRUE : TBX_FALSE;
     }
     else
     {
+      txMbDoneIdx = 2U;
       txMbDoneRQCPbit = CAN_TSR_RQCP2;
-      if (READ_BIT(CAN->TSR, CAN_TSR_TXOK2) != 0U)
-      {
-        txMbDoneIdx = 2U;
-      }
+      txMbDoneOk = (READ_BIT(CAN->TSR, CAN_TSR_TXOK2) != 0U) ? TBX_TRUE : TBX_FALSE;
+    }
+    // Keep track of the number of aborted transmissions.
+    if (txMbDoneOk == TBX_FALSE)
+    {
+      m_TxAbortCount = m_TxAbortCount + 1U;
     }
 
-    // Only need to retrieve the message info in case of a successful tranmsission.
-    if (txMbDoneIdx != c_InvalidMailboxIdx)
+    // Only need to retrieve the message info if someone is actually interested in the
+    // transmit complete or transmit failed event. This saves a needless wake up of the
+    // task for each transmitted message.
+    if (((txMbDoneOk == TBX_TRUE) && (onTransmitted)) ||
+        ((txMbDoneOk == TBX_FALSE) && (onTransmitFailed)))
     {
-      // Set the event type.
-      canEvent.type = BxCanEvent::TXCOMPLETE;
-      // Read the identifier from the mailbox.
-      if (READ_BIT(CAN->sTxMailBox[txMbDoneIdx].TIR, CAN_TI0R_IDE) != 0U)
+      // Claim a slot in the event pool.
+      BxCanEvent* canEvent = claimEventFromISR();
+      if (canEvent != nullptr)
       {
-        // Read 29-bit identifier.
-        canEvent.msg.setExt(TBX_TRUE);
-        uint32_t msgId = READ_BIT(CAN->sTxMailBox[txMbDoneIdx].TIR, CAN_TI0R_EXID);
-        msgId = msgId >> CAN_TI0R_EXID_Pos;
-        canEvent.msg.setId(msgId);
-      }
-      else
-      {
-        // Read 11-bit identifier.
-        canEvent.msg.setExt(TBX_FALSE);
-        uint32_t msgId = READ_BIT(CAN->sTxMailBox[txMbDoneIdx].TIR, CAN_TI0R_STID);
-        msgId = msgId >> CAN_TI0R_STID_Pos;
-        canEvent.msg.setId(msgId);
-      }
-      // Read the data length code (DLC).
-      uint32_t msgDlc = READ_BIT(CAN->sTxMailBox[txMbDoneIdx].TDTR, CAN_TDT0R_DLC);
-      msgDlc = msgDlc >> CAN_TDT0R_DLC_Pos;
-      canEvent.msg.setLen(msgDlc);
-      // Read the data bytes.
-      uint32_t dataLow  = READ_REG(CAN->sTxMailBox[txMbDoneIdx].TDLR);
-      uint32_t dataHigh = READ_REG(CAN->sTxMailBox[txMbDoneIdx].TDHR);
-      canEvent.msg[0] = static_cast<uint8_t>(dataLow);
-      canEvent.msg[1] = static_cast<uint8_t>(dataLow >> 8U);
-      canEvent.msg[2] = static_cast<uint8_t>(dataLow >> 16U);
-      canEvent.msg[3] = static_cast<uint8_t>(dataLow >> 24U);
-      canEvent.msg[4] = static_cast<uint8_t>(dataHigh);
-      canEvent.msg[5] = static_cast<uint8_t>(dataHigh >> 8U);
-      canEvent.msg[6] = static_cast<uint8_t>(dataHigh >> 16U);
-      canEvent.msg[7] = static_cast<uint8_t>(dataHigh >> 24U);
-      // Add the event to the queue.
-      BaseType_t xHigherPrioTaskWoken = pdFALSE;
-      if (m_EventQueue->EnqueueFromISR(&canEvent, &xHigherPrioTaskWoken))
-      {
-        // Keep track if a task switch is required at the end of the ISR.
-        if (xHigherPrioTaskWoken == pdTRUE)
-        {
-          switchRequired = pdTRUE;
-        }
+        // Fill in the event straight from the mailbox registers.
+        canEvent->type = (txMbDoneOk == TBX_TRUE) ? BxCanEvent::TXCOMPLETE :
+                                                    BxCanEvent::TXABORTED;
+        canEvent->frame.ir  = READ_REG(CAN->sTxMailBox[txMbDoneIdx].TIR);
+        canEvent->frame.dtr = READ_REG(CAN->sTxMailBox[txMbDoneIdx].TDTR);
+        canEvent->frame.dlr = READ_REG(CAN->sTxMailBox[txMbDoneIdx].TDLR);
+        canEvent->frame.dhr = READ_REG(CAN->sTxMailBox[txMbDoneIdx].TDHR);
+        // Hand the event over to the task.
+        commitEventFromISR();
+        eventsCommitted = TBX_TRUE;
       }
     }
     // Reset the mailbox' RQCP bit flag to be able to detect the next request completed
@@ -539,9 +1069,18 @@ void BxCan::processTxInterrupt()
     // clearing.
     WRITE_REG(CAN->TSR, txMbDoneRQCPbit);
   }
-  // Inform the scheduler if a higher priority task was woken, requiring a context switch
-  // when this ISR finishes.
-  portYIELD_FROM_ISR(switchRequired);        
+  // Move frames, waiting in the software transmit queue, into the mailboxes that just
+  // became empty.
+  refillTxMailboxes();
+  // Notify the task about the new events, if any.
+  if (eventsCommitted == TBX_TRUE)
+  {
+    BaseType_t xHigherPrioTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(GetHandle(), &xHigherPrioTaskWoken);
+    // Inform the scheduler if a higher priority task was woken, requiring a context
+    // switch when this ISR finishes.
+    portYIELD_FROM_ISR(xHigherPrioTaskWoken);
+  }
 }
 
 
@@ -551,68 +1090,66 @@ void BxCan::processTxInterrupt()
 ///**************************************************************************************
 void BxCan::processRxFifo0Interrupt()
 {
-  BxCanEvent canEvent;
-  BaseType_t switchRequired = pdFALSE;
+  uint32_t entryCycles = LatencyMonitor::now();
+  uint8_t eventsCommitted = TBX_FALSE;
 
   // Process the FIFO0 message reception interrupt events.
   while (READ_BIT(CAN->RF0R, CAN_RF0R_FMP0) != 0U)
   {
+    // Keep track of the number of FIFO overruns. Nothing can be done to save the lost
+    // message, but at least it can be detected that messages went missing.
+    if (READ_BIT(CAN->RF0R, CAN_RF0R_FOVR0) != 0U)
+    {
+      m_RxOverrunCount = m_RxOverrunCount + 1U;
+    }
     // Clear FIFO overrun and FIFO full flags. FIFO full is not interesting and in case
     // of an FIFO overrun, nothing can be done to save the message. It is assumed that
     // the owner will be able to detect that a message went missing, if needed, for
     // example via a message reception timeout. Note that you need to write a 1 to the
     // ROVR and FULL bits to clear them.
     WRITE_REG(CAN->RF0R, CAN_RF0R_FULL0 | CAN_RF0R_FOVR0);
-    // Set the event type.
-    canEvent.type = BxCanEvent::RXINDICATION;
-    // Read the identifier from the mailbox.
-    if (READ_BIT(CAN->sFIFOMailBox[0].RIR, CAN_RI0R_IDE) != 0U)
+    // Only continue with the frame, if it passes the software acceptance filter. This
+    // way a rejected frame never touches the event pool.
+    BxCanEvent* canEvent = nullptr;
+    if (swFilterAcceptsFromISR(READ_REG(CAN->sFIFOMailBox[0].RIR)) == TBX_TRUE)
     {
-      // Read 29-bit identifier.
-      canEvent.msg.setExt(TBX_TRUE);
-      uint32_t msgId = READ_BIT(CAN->sFIFOMailBox[0].RIR, CAN_RI0R_EXID);
-      msgId = msgId >> CAN_RI0R_EXID_Pos;
-      canEvent.msg.setId(msgId);
+      // Claim a slot in the event pool.
+      canEvent = claimEventFromISR();
     }
     else
     {
-      // Read 11-bit identifier.
-      canEvent.msg.setExt(TBX_FALSE);
-      uint32_t msgId = READ_BIT(CAN->sFIFOMailBox[0].RIR, CAN_RI0R_STID);
-      msgId = msgId >> CAN_RI0R_STID_Pos;
-      canEvent.msg.setId(msgId);
-    }
-    // Read the data length code (DLC).
-    uint32_t msgDlc = READ_BIT(CAN->sFIFOMailBox[0].RDTR, CAN_RDT0R_DLC);
-    msgDlc = msgDlc >> CAN_RDT0R_DLC_Pos;
-    canEvent.msg.setLen(msgDlc);
-    // Read the data bytes.
-    uint32_t dataLow  = READ_REG(CAN->sFIFOMailBox[0].RDLR);
-    uint32_t dataHigh = READ_REG(CAN->sFIFOMailBox[0].RDHR);
-    canEvent.msg[0] = static_cast<uint8_t>(dataLow);
-    canEvent.msg[1] = static_cast<uint8_t>(dataLow >> 8U);
-    canEvent.msg[2] = static_cast<uint8_t>(dataLow >> 16U);
-    canEvent.msg[3] = static_cast<uint8_t>(dataLow >> 24U);
-    canEvent.msg[4] = static_cast<uint8_t>(dataHigh);
-    canEvent.msg[5] = static_cast<uint8_t>(dataHigh >> 8U);
-    canEvent.msg[6] = static_cast<uint8_t>(dataHigh >> 16U);
-    canEvent.msg[7] = static_cast<uint8_t>(dataHigh >> 24U);
-    // Release the mailbox back to the FIFO for new message storage.
-    SET_BIT(CAN->RF0R, CAN_RF0R_RFOM0);
-    // Add the event to the queue.
-    BaseType_t xHigherPrioTaskWoken = pdFALSE;
-    if (m_EventQueue->EnqueueFromISR(&canEvent, &xHigherPrioTaskWoken))
+      m_SwFilterDropCount = m_SwFilterDropCount + 1U;
+    }
+    if (canEvent != nullptr)
     {
-      // Keep track if a task switch is required at the end of the ISR.
-      if (xHigherPrioTaskWoken == pdTRUE)
+      // Fill in the event straight from the mailbox registers.
+      canEvent->type = BxCanEvent::RXINDICATION;
+      canEvent->cycles = entryCycles;
+      canEvent->frame.ir  = READ_REG(CAN->sFIFOMailBox[0].RIR);
+      canEvent->frame.dtr = READ_REG(CAN->sFIFOMailBox[0].RDTR);
+      canEvent->frame.dlr = READ_REG(CAN->sFIFOMailBox[0].RDLR);
+      canEvent->frame.dhr = READ_REG(CAN->sFIFOMailBox[0].RDHR);
+      // Only hand the event over to the task, if the message was not already fully
+      // handled directly at interrupt level. Otherwise the claimed slot simply stays
+      // free for the next event.
+      if (dispatchFromISR(*canEvent) == TBX_FALSE)
       {
-        switchRequired = pdTRUE;
+        commitEventFromISR();
+        eventsCommitted = TBX_TRUE;
       }
     }
+    // Release the mailbox back to the FIFO for new message storage.
+    SET_BIT(CAN->RF0R, CAN_RF0R_RFOM0);
+  }
+  // Notify the task about the new events, if any.
+  if (eventsCommitted == TBX_TRUE)
+  {
+    BaseType_t xHigherPrioTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(GetHandle(), &xHigherPrioTaskWoken);
+    // Inform the scheduler if a higher priority task was woken, requiring a context
+    // switch when this ISR finishes.
+    portYIELD_FROM_ISR(xHigherPrioTaskWoken);
   }
-  // Inform the scheduler if a higher priority task was woken, requiring a context switch
-  // when this ISR finishes.
-  portYIELD_FROM_ISR(switchRequired);        
 }
 
 
@@ -622,68 +1159,66 @@ void BxCan::processRxFifo0Interrupt()
 ///**************************************************************************************
 void BxCan::processRxFifo1Interrupt()
 {
-  BxCanEvent canEvent;
-  BaseType_t switchRequired = pdFALSE;
+  uint32_t entryCycles = LatencyMonitor::now();
+  uint8_t eventsCommitted = TBX_FALSE;
 
-  // Process the FIFO0 message reception interrupt events.
+  // Process the FIFO1 message reception interrupt events.
   while (READ_BIT(CAN->RF1R, CAN_RF1R_FMP1) != 0U)
   {
+    // Keep track of the number of FIFO overruns. Nothing can be done to save the lost
+    // message, but at least it can be detected that messages went missing.
+    if (READ_BIT(CAN->RF1R, CAN_RF1R_FOVR1) != 0U)
+    {
+      m_RxOverrunCount = m_RxOverrunCount + 1U;
+    }
     // Clear FIFO overrun and FIFO full flags. FIFO full is not interesting and in case
     // of an FIFO overrun, nothing can be done to save the message. It is assumed that
     // the owner will be able to detect that a message went missing, if needed, for
     // example via a message reception timeout. Note that you need to write a 1 to the
     // ROVR and FULL bits to clear them.
     WRITE_REG(CAN->RF1R, CAN_RF1R_FULL1 | CAN_RF1R_FOVR1);
-    // Set the event type.
-    canEvent.type = BxCanEvent::RXINDICATION;
-    // Read the identifier from the mailbox.
-    if (READ_BIT(CAN->sFIFOMailBox[1].RIR, CAN_RI1R_IDE) != 0U)
+    // Only continue with the frame, if it passes the software acceptance filter. This
+    // way a rejected frame never touches the event pool.
+    BxCanEvent* canEvent = nullptr;
+    if (swFilterAcceptsFromISR(READ_REG(CAN->sFIFOMailBox[1].RIR)) == TBX_TRUE)
     {
-      // Read 29-bit identifier.
-      canEvent.msg.setExt(TBX_TRUE);
-      uint32_t msgId = READ_BIT(CAN->sFIFOMailBox[1].RIR, CAN_RI1R_EXID);
-      msgId = msgId >> CAN_RI1R_EXID_Pos;
-      canEvent.msg.setId(msgId);
+      // Claim a slot in the event pool.
+      canEvent = claimEventFromISR();
     }
     else
     {
-      // Read 11-bit identifier.
-      canEvent.msg.setExt(TBX_FALSE);
-      uint32_t msgId = READ_BIT(CAN->sFIFOMailBox[1].RIR, CAN_RI1R_STID);
-      msgId = msgId >> CAN_RI1R_STID_Pos;
-      canEvent.msg.setId(msgId);
-    }
-    // Read the data length code (DLC).
-    uint32_t msgDlc = READ_BIT(CAN->sFIFOMailBox[1].RDTR, CAN_RDT1R_DLC);
-    msgDlc = msgDlc >> CAN_RDT1R_DLC_Pos;
-    canEvent.msg.setLen(msgDlc);
-    // Read the data bytes.
-    uint32_t dataLow  = READ_REG(CAN->sFIFOMailBox[1].RDLR);
-    uint32_t dataHigh = READ_REG(CAN->sFIFOMailBox[1].RDHR);
-    canEvent.msg[0] = static_cast<uint8_t>(dataLow);
-    canEvent.msg[1] = static_cast<uint8_t>(dataLow >> 8U);
-    canEvent.msg[2] = static_cast<uint8_t>(dataLow >> 16U);
-    canEvent.msg[3] = static_cast<uint8_t>(dataLow >> 24U);
-    canEvent.msg[4] = static_cast<uint8_t>(dataHigh);
-    canEvent.msg[5] = static_cast<uint8_t>(dataHigh >> 8U);
-    canEvent.msg[6] = static_cast<uint8_t>(dataHigh >> 16U);
-    canEvent.msg[7] = static_cast<uint8_t>(dataHigh >> 24U);
-    // Release the mailbox back to the FIFO for new message storage.
-    SET_BIT(CAN->RF1R, CAN_RF1R_RFOM1);
-    // Add the event to the queue.
-    BaseType_t xHigherPrioTaskWoken = pdFALSE;
-    if (m_EventQueue->EnqueueFromISR(&canEvent, &xHigherPrioTaskWoken))
+      m_SwFilterDropCount = m_SwFilterDropCount + 1U;
+    }
+    if (canEvent != nullptr)
     {
-      // Keep track if a task switch is required at the end of the ISR.
-      if (xHigherPrioTaskWoken == pdTRUE)
+      // Fill in the event straight from the mailbox registers.
+      canEvent->type = BxCanEvent::RXINDICATION;
+      canEvent->cycles = entryCycles;
+      canEvent->frame.ir  = READ_REG(CAN->sFIFOMailBox[1].RIR);
+      canEvent->frame.dtr = READ_REG(CAN->sFIFOMailBox[1].RDTR);
+      canEvent->frame.dlr = READ_REG(CAN->sFIFOMailBox[1].RDLR);
+      canEvent->frame.dhr = READ_REG(CAN->sFIFOMailBox[1].RDHR);
+      // Only hand the event over to the task, if the message was not already fully
+      // handled directly at interrupt level. Otherwise the claimed slot simply stays
+      // free for the next event.
+      if (dispatchFromISR(*canEvent) == TBX_FALSE)
       {
-        switchRequired = pdTRUE;
+        commitEventFromISR();
+        eventsCommitted = TBX_TRUE;
       }
     }
+    // Release the mailbox back to the FIFO for new message storage.
+    SET_BIT(CAN->RF1R, CAN_RF1R_RFOM1);
+  }
+  // Notify the task about the new events, if any.
+  if (eventsCommitted == TBX_TRUE)
+  {
+    BaseType_t xHigherPrioTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(GetHandle(), &xHigherPrioTaskWoken);
+    // Inform the scheduler if a higher priority task was woken, requiring a context
+    // switch when this ISR finishes.
+    portYIELD_FROM_ISR(xHigherPrioTaskWoken);
   }
-  // Inform the scheduler if a higher priority task was woken, requiring a context switch
-  // when this ISR finishes.
-  portYIELD_FROM_ISR(switchRequired);        
 }
 
 
@@ -693,94 +1228,580 @@ void BxCan::processRxFifo1Interrupt()
 ///**************************************************************************************
 void BxCan::processErrorInterrupt()
 {
-  BxCanEvent canEvent;
-  BaseType_t switchRequired = pdFALSE;
+  uint8_t eventsCommitted = TBX_FALSE;
 
-  // Process the bus off error interrupt event.
+  // Process the error warning, error passive and bus off error interrupt events.
   if (READ_BIT(CAN->MSR, CAN_MSR_ERRI) != 0U)
   {
-    // Set the event type.
-    canEvent.type = BxCanEvent::BUSOFF;
+    uint32_t esr = READ_REG(CAN->ESR);
+
     // Clear the error interrupt flag. Needs to be done by writing a 1 to it.
     WRITE_REG(CAN->MSR, CAN_MSR_ERRI);
-    // Add the event to the queue.
+    // Update the error status snapshot.
+    updateErrorStatus(esr);
+    // Only the bus off error needs further processing by the task.
+    if ((esr & CAN_ESR_BOFF) != 0U)
+    {
+      // Claim a slot in the event pool.
+      BxCanEvent* canEvent = claimEventFromISR();
+      if (canEvent != nullptr)
+      {
+        // Set the event type and hand the event over to the task.
+        canEvent->type = BxCanEvent::BUSOFF;
+        commitEventFromISR();
+        eventsCommitted = TBX_TRUE;
+      }
+    }
+  }
+  // Notify the task about the new events, if any.
+  if (eventsCommitted == TBX_TRUE)
+  {
     BaseType_t xHigherPrioTaskWoken = pdFALSE;
-    if (m_EventQueue->EnqueueFromISR(&canEvent, &xHigherPrioTaskWoken))
+    vTaskNotifyGiveFromISR(GetHandle(), &xHigherPrioTaskWoken);
+    // Inform the scheduler if a higher priority task was woken, requiring a context
+    // switch when this ISR finishes.
+    portYIELD_FROM_ISR(xHigherPrioTaskWoken);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Claims the next free slot in the event pool. The caller fills in the event
+///            and then hands it over to the task with commitEventFromISR().
+/// \attention Only call this method from the CAN interrupts.
+/// \return    Pointer to the claimed event slot or nullptr if the event pool is full.
+///
+///**************************************************************************************
+BxCanEvent* BxCan::claimEventFromISR()
+{
+  BxCanEvent* result = nullptr;
+
+  // Only claim a slot if the event pool is not yet full. Note that one slot always
+  // stays unused, such that a full pool can be distinguished from an empty one.
+  if (((m_EventHead + 1U) % m_EventPool.size()) != m_EventTail)
+  {
+    result = &m_EventPool[m_EventHead];
+  }
+  else
+  {
+    // Keep track of the number of events that did not fit.
+    m_EventPoolOverflowCount = m_EventPoolOverflowCount + 1U;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Hands the event slot, previously claimed with claimEventFromISR(), over to
+///            the task.
+/// \attention Only call this method from the CAN interrupts.
+///
+///**************************************************************************************
+void BxCan::commitEventFromISR()
+{
+  m_EventHead = (m_EventHead + 1U) % m_EventPool.size();
+  // Update the high-water mark of the event pool.
+  uint8_t pending = (m_EventHead + m_EventPool.size() - m_EventTail) % m_EventPool.size();
+  if (pending > m_EventPoolHighWaterMark)
+  {
+    m_EventPoolHighWaterMark = pending;
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Offers a newly received frame to the interrupt level event handler, if
+///            assigned.
+/// \attention Only call this method from the CAN interrupts.
+/// \param     t_Event The reception event with the received frame.
+/// \return    TBX_TRUE if the event handler fully handled the frame, TBX_FALSE if the
+///            frame should still be passed on to the task.
+///
+///**************************************************************************************
+uint8_t BxCan::dispatchFromISR(BxCanEvent const& t_Event)
+{
+  uint8_t result = TBX_FALSE;
+
+  // Only dispatch the frame if the event handler is assigned.
+  if (onReceivedFromISR)
+  {
+    CanMsg canMsg;
+    frameToMsg(t_Event.frame, canMsg);
+    canMsg.setTimestamp(t_Event.cycles);
+    result = onReceivedFromISR(canMsg);
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Converts a frame in mailbox register layout to a CAN message.
+/// \param     t_Frame The frame in mailbox register layout.
+/// \param     t_Msg The CAN message to store the result in.
+///
+///**************************************************************************************
+void BxCan::frameToMsg(BxCanFrame const& t_Frame, CanMsg& t_Msg)
+{
+  // Read the identifier.
+  if ((t_Frame.ir & CAN_RI0R_IDE) != 0U)
+  {
+    // Read 29-bit identifier.
+    t_Msg.setExt(TBX_TRUE);
+    t_Msg.setId((t_Frame.ir & CAN_RI0R_EXID) >> CAN_RI0R_EXID_Pos);
+  }
+  else
+  {
+    // Read 11-bit identifier.
+    t_Msg.setExt(TBX_FALSE);
+    t_Msg.setId((t_Frame.ir & CAN_RI0R_STID) >> CAN_RI0R_STID_Pos);
+  }
+  // Read the data length code (DLC). A DLC value larger than 8 still means 8 data bytes.
+  uint8_t msgDlc = (t_Frame.dtr & CAN_RDT0R_DLC) >> CAN_RDT0R_DLC_Pos;
+  t_Msg.setLen((msgDlc > CanMsg::c_DataLenMax) ? CanMsg::c_DataLenMax : msgDlc);
+  // Read the data bytes.
+  t_Msg[0] = static_cast<uint8_t>(t_Frame.dlr);
+  t_Msg[1] = static_cast<uint8_t>(t_Frame.dlr >> 8U);
+  t_Msg[2] = static_cast<uint8_t>(t_Frame.dlr >> 16U);
+  t_Msg[3] = static_cast<uint8_t>(t_Frame.dlr >> 24U);
+  t_Msg[4] = static_cast<uint8_t>(t_Frame.dhr);
+  t_Msg[5] = static_cast<uint8_t>(t_Frame.dhr >> 8U);
+  t_Msg[6] = static_cast<uint8_t>(t_Frame.dhr >> 16U);
+  t_Msg[7] = static_cast<uint8_t>(t_Frame.dhr >> 24U);
+}
+
+
+///**************************************************************************************
+/// \brief     Converts a filter set to filter bank settings. Exact 11-bit identifiers
+///            go four per bank in 16-bit list mode, exact 29-bit identifiers two per
+///            bank in 32-bit list mode, 11-bit code/mask pairs two per bank in 16-bit
+///            mask mode and 29-bit code/mask pairs one per bank in 32-bit mask mode.
+///            Unused slots of a partially filled bank repeat its first entry. The banks
+///            are alternately assigned to FIFO0 and FIFO1, to spread the load over both
+///            reception FIFOs. Note that in list mode the RTR bit must match as well, so
+///            exact identifiers only accept data frames.
+/// \param     t_FilterSet Message reception acceptance filter set.
+/// \param     t_Banks Array with c_FilterBankCount elements for storing the filter bank
+///            settings. Can be nullptr to just determine the number of needed banks.
+/// \return    Number of needed filter banks. Only the first c_FilterBankCount banks
+///            are stored, in case more banks are needed than available.
+///
+///**************************************************************************************
+uint8_t BxCan::buildFilterBanks(CanFilterSet const& t_FilterSet, 
+                                BxCanFilterBank t_Banks[])
+{
+  constexpr uint8_t slotsPerBank[] = { 4U, 2U, 2U, 1U };
+  uint8_t bankCount = 0U;
+
+  // A filter set should be able to fill all filter banks in 16-bit list mode.
+  static_assert(CanFilterSet::c_EntriesMax >= (c_FilterBankCount * slotsPerBank[0]),
+                "Filter set cannot fill all filter banks.");
+
+  // A set with just a single code/mask pair would only use one filter bank and
+  // therefore just one FIFO. Split its acceptance set on an identifier bit that the mask
+  // does not care about. The identifiers with this bit cleared go into FIFO0 and the
+  // ones with this bit set go into FIFO1. This way six instead of three frames can be
+  // buffered in hardware. Note that assigning the same acceptance set to a second bank
+  // is of no use, because the hardware always stores a matching frame in the FIFO of
+  // the lowest numbered filter, even if that FIFO is full.
+  if ((t_FilterSet.size() == 1U) && (t_FilterSet[0].exact() == TBX_FALSE))
+  {
+    CanFilterEntry half = t_FilterSet[0];
+    uint8_t idBits = (half.ext == TBX_FALSE) ? 11U : 29U;
+    uint32_t splitBit = findFilterSplitBit(half.mask, idBits);
+
+    if (splitBit != 0U)
+    {
+      // Store the two halves in 32-bit mask mode.
+      half.mask |= splitBit;
+      for (uint8_t fifo = 0U; fifo <= 1U; fifo++)
+      {
+        half.code = (fifo == 0U) ? (half.code & ~splitBit) : (half.code | splitBit);
+        if (t_Banks != nullptr)
+        {
+          t_Banks[bankCount] = { BxCanFilterBank::MASK32, fifo, 0U, 0U };
+          setFilterBankSlot(t_Banks[bankCount], 0U, half);
+        }
+        bankCount++;
+      }
+    }
+  }
+  // Pack the entries into the banks, one filter bank mode at a time.
+  if (bankCount == 0U)
+  {
+    for (uint8_t mode = BxCanFilterBank::LIST16; mode <= BxCanFilterBank::MASK32; mode++)
+    {
+      BxCanFilterBank bank{ };
+      CanFilterEntry const* firstEntry = nullptr;
+      uint8_t slotIdx = 0U;
+
+      for (size_t entryIdx = 0U; entryIdx < t_FilterSet.size(); entryIdx++)
+      {
+        CanFilterEntry const& entry = t_FilterSet[entryIdx];
+        // Skip entries that belong to another filter bank mode.
+        if (filterBankMode(entry) != mode)
+        {
+          continue;
+        }
+        // Start a new bank if needed.
+        if (slotIdx == 0U)
+        {
+          bank = { static_cast<BxCanFilterBank::Mode>(mode), 
+                   static_cast<uint8_t>(bankCount & 1U), 0U, 0U };
+          firstEntry = &entry;
+        }
+        // Add the entry to the bank.
+        setFilterBankSlot(bank, slotIdx, entry);
+        slotIdx++;
+        // Store the bank once it is full.
+        if (slotIdx == slotsPerBank[mode])
+        {
+          if ((t_Banks != nullptr) && (bankCount < c_FilterBankCount))
+          {
+            t_Banks[bankCount] = bank;
+          }
+          bankCount++;
+          slotIdx = 0U;
+        }
+      }
+      // Complete and store a partially filled bank.
+      if (slotIdx != 0U)
+      {
+        while (slotIdx < slotsPerBank[mode])
+        {
+          setFilterBankSlot(bank, slotIdx, *firstEntry);
+          slotIdx++;
+        }
+        if ((t_Banks != nullptr) && (bankCount < c_FilterBankCount))
+        {
+          t_Banks[bankCount] = bank;
+        }
+        bankCount++;
+      }
+    }
+  }
+  // Give the result back to the caller.
+  return bankCount;
+}
+
+
+///**************************************************************************************
+/// \brief     Determines the filter bank mode that a filter set entry should go into.
+/// \param     t_Entry Filter set entry.
+/// \return    Filter bank mode.
+///
+///**************************************************************************************
+BxCanFilterBank::Mode BxCan::filterBankMode(CanFilterEntry const& t_Entry)
+{
+  BxCanFilterBank::Mode result;
+
+  if (t_Entry.exact() == TBX_TRUE)
+  {
+    result = (t_Entry.ext == TBX_FALSE) ? BxCanFilterBank::LIST16 : 
+                                          BxCanFilterBank::LIST32;
+  }
+  else
+  {
+    result = (t_Entry.ext == TBX_FALSE) ? BxCanFilterBank::MASK16 : 
+                                          BxCanFilterBank::MASK32;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Stores a filter set entry in one of the slots of a filter bank. The
+///            number of slots depends on the filter bank mode: four for 16-bit list
+///            mode, two for 32-bit list and 16-bit mask mode and one for 32-bit mask
+///            mode.
+/// \param     t_Bank Filter bank settings.
+/// \param     t_SlotIdx Slot index.
+/// \param     t_Entry Filter set entry.
+///
+///**************************************************************************************
+void BxCan::setFilterBankSlot(BxCanFilterBank& t_Bank, uint8_t t_SlotIdx,
+                              CanFilterEntry const& t_Entry)
+{
+  // Determine the identifier and mask in the 16-bit scaling layout, with just the 11-bit
+  // identifier part, and in the 32-bit scaling layout. In both cases, the IDE bit in
+  // the mask is set, such that only frames with the correct identifier type match.
+  uint32_t code16 = t_Entry.code << 5U;
+  uint32_t mask16 = (t_Entry.mask << 5U) | CAN_F0R1_FB3; // IDE bit
+  uint32_t code32 = (t_Entry.ext == TBX_FALSE) ? (t_Entry.code << 21U) : 
+                                                 ((t_Entry.code << 3U) | CAN_F0R1_FB2);
+  uint32_t mask32 = (t_Entry.ext == TBX_FALSE) ? (t_Entry.mask << 21U) : 
+                                                 (t_Entry.mask << 3U);
+  mask32 |= CAN_F0R2_FB2; // IDE bit
+
+  // Store the entry in the slot.
+  switch (t_Bank.mode)
+  {
+    case BxCanFilterBank::LIST16:
+    {
+      uint32_t& reg = (t_SlotIdx < 2U) ? t_Bank.fr1 : t_Bank.fr2;
+      reg |= ((t_SlotIdx & 1U) == 0U) ? code16 : (code16 << 16U);
+      break;
+    }
+    case BxCanFilterBank::LIST32:
+    {
+      uint32_t& reg = (t_SlotIdx == 0U) ? t_Bank.fr1 : t_Bank.fr2;
+      reg = code32;
+      break;
+    }
+    case BxCanFilterBank::MASK16:
+    {
+      uint32_t& reg = (t_SlotIdx == 0U) ? t_Bank.fr1 : t_Bank.fr2;
+      reg = (mask16 << 16U) | code16;
+      break;
+    }
+    default:
+    {
+      t_Bank.fr1 = code32;
+      t_Bank.fr2 = mask32;
+      break;
+    }
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Programs the reception filter banks and activates them. Should only be
+///            called while in filter initialization mode.
+///
+///**************************************************************************************
+void BxCan::applyFilterBanks()
+{
+  // Deactivate all filter banks, which might still be active from a previous
+  // configuration.
+  CLEAR_BIT(CAN->FA1R, (1UL << c_FilterBankCount) - 1U);
+  // Program and activate the filter banks one by one.
+  for (uint8_t bankIdx = 0U; bankIdx < m_FilterBankCount; bankIdx++)
+  {
+    BxCanFilterBank const& bank = m_FilterBanks[bankIdx];
+    uint32_t bankBit = 1UL << bankIdx;
+
+    // Select identifier list or identifier mask mode for the filter bank.
+    if ((bank.mode == BxCanFilterBank::LIST16) || (bank.mode == BxCanFilterBank::LIST32))
+    {
+      SET_BIT(CAN->FM1R, bankBit);
+    }
+    else
+    {
+      CLEAR_BIT(CAN->FM1R, bankBit);
+    }
+    // Select dual 16-bit or single 32-bit scaling for the filter bank.
+    if ((bank.mode == BxCanFilterBank::LIST16) || (bank.mode == BxCanFilterBank::MASK16))
+    {
+      CLEAR_BIT(CAN->FS1R, bankBit);
+    }
+    else
+    {
+      SET_BIT(CAN->FS1R, bankBit);
+    }
+    // Set the filter bank's register values.
+    WRITE_REG(CAN->sFilterRegister[bankIdx].FR1, bank.fr1);
+    WRITE_REG(CAN->sFilterRegister[bankIdx].FR2, bank.fr2);
+    // Assign the filter bank to its FIFO.
+    if (bank.fifo == 0U)
+    {
+      CLEAR_BIT(CAN->FFA1R, bankBit);
+    }
+    else
+    {
+      SET_BIT(CAN->FFA1R, bankBit);
+    }
+    // Activate the filter bank.
+    SET_BIT(CAN->FA1R, bankBit);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Determines the identifier bit to split a filter's acceptance set on, when
+///            spreading it over both reception FIFOs. This is the least significant
+///            identifier bit that the mask does not care about, because with most
+///            protocols, this bit toggles most often between consecutive identifiers.
+/// \param     t_Mask The filter's mask bits, not yet shifted into register position.
+/// \param     t_IdBits Number of bits in the identifier, so 11 or 29.
+/// \return    Bit mask with only the split bit set, or 0 if the mask selects just a
+///            single identifier.
+///
+///**************************************************************************************
+uint32_t BxCan::findFilterSplitBit(uint32_t t_Mask, uint8_t t_IdBits)
+{
+  uint32_t result = 0U;
+
+  // Find the least significant identifier bit that is a don't care in the mask.
+  for (uint8_t bitIdx = 0U; bitIdx < t_IdBits; bitIdx++)
+  {
+    if ((t_Mask & (1UL << bitIdx)) == 0U)
+    {
+      result = 1UL << bitIdx;
+      break;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Determines the index of the first empty transmit mailbox.
+/// \return    Mailbox index [0..2] or c_InvalidMailboxIdx if all mailboxes are busy.
+///
+///**************************************************************************************
+uint8_t BxCan::findEmptyTxMailbox() const
+{
+  // Lookup table indexed with the TSR->TMEx bits value. In return it gives the index
+  // of the first empty transmit mailbox. Made static to lower ROM and stack load.
+  static const uint8_t txMbIdxEmptyLookup[] =
+  {
+    c_InvalidMailboxIdx, // %000 - All mailboxes are busy.
+    0U,                  // %001 - Mailbox 1 is available.
+    1U,                  // %010 - Mailbox 2 is available.
+    0U,                  // %011 - Mailbox 1 is available.
+    2U,                  // %100 - Mailbox 3 is available.
+    0U,                  // %101 - Mailbox 1 is available.
+    1U,                  // %110 - Mailbox 2 is available.
+    0U                   // %111 - Mailbox 1 is available.
+  };
+
+  // Get first free transmit mailbox index by feeding the value of the TMEx bits into
+  // the lookup table.
+  uint8_t tmeBits = READ_BIT(CAN->TSR, CAN_TSR_TME) >> CAN_TSR_TME_Pos;
+  return txMbIdxEmptyLookup[tmeBits];
+}
+
+
+///**************************************************************************************
+/// \brief     Writes a frame to the specified transmit mailbox and requests the start of
+///            its transmission. The caller must make sure the mailbox is empty.
+/// \param     t_MailboxIdx Index of the empty transmit mailbox [0..2].
+/// \param     t_Frame The frame in transmit mailbox register layout.
+///
+///**************************************************************************************
+void BxCan::writeTxMailbox(uint8_t t_MailboxIdx, BxCanFrame const& t_Frame)
+{
+  // Verify the parameters.
+  TBX_ASSERT(t_MailboxIdx < 3U);
+
+  // Write the identifier, data length code (DLC) and data bytes.
+  WRITE_REG(CAN->sTxMailBox[t_MailboxIdx].TIR, t_Frame.ir);
+  WRITE_REG(CAN->sTxMailBox[t_MailboxIdx].TDTR, t_Frame.dtr);
+  WRITE_REG(CAN->sTxMailBox[t_MailboxIdx].TDLR, t_Frame.dlr);
+  WRITE_REG(CAN->sTxMailBox[t_MailboxIdx].TDHR, t_Frame.dhr);
+  // Store the moment the frame entered the mailbox, for the transmit deadline.
+  m_TxMailboxCycles[t_MailboxIdx] = DWT->CYCCNT;
+  // Request start of message for transmission.
+  SET_BIT(CAN->sTxMailBox[t_MailboxIdx].TIR, CAN_TI0R_TXRQ);
+}
+
+
+///**************************************************************************************
+/// \brief     Obtains the number of frames that were submitted for transmission, but did
+///            not yet leave the driver. These are the frames in the software transmit
+///            queue and in the busy transmit mailboxes.
+/// \return    Number of pending frames.
+///
+///**************************************************************************************
+size_t BxCan::txPendingCount() const
+{
+  size_t result;
+
+  // Obtain mutual exclusive access to the transmit mailboxes and the transmit queue.
+  TbxCriticalSectionEnter();
+  // Count the frames in the transmit queue.
+  result = (m_TxQueueHead + m_TxQueueSlots - m_TxQueueTail) % m_TxQueueSlots;
+  // Add the busy transmit mailboxes.
+  for (uint8_t mailboxIdx = 0U; mailboxIdx < 3U; mailboxIdx++)
+  {
+    if (READ_BIT(CAN->TSR, CAN_TSR_TME0 << mailboxIdx) == 0U)
     {
-      // Keep track if a task switch is required at the end of the ISR.
-      if (xHigherPrioTaskWoken == pdTRUE)
+      result++;
+    }
+  }
+  // Release mutual exclusive access to the transmit mailboxes and the transmit queue.
+  TbxCriticalSectionExit();
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Aborts the transmission of frames that spent more time in their transmit
+///            mailbox than the transmit deadline allows. This frees up the mailbox. The
+///            transmit interrupt reports the aborted transmission. Called by the task.
+///
+///**************************************************************************************
+void BxCan::checkTxDeadlines()
+{
+  // Only check if the transmit deadline is enabled and the driver is on the bus. While
+  // recovering from bus off, the frames simply wait in their mailboxes.
+  if ((m_TxDeadlineCycles != 0U) && (m_ConnectState == ONLINE))
+  {
+    // Obtain mutual exclusive access to the transmit mailboxes. This prevents the
+    // transmit interrupt from loading a new frame into a mailbox, right before it is
+    // aborted.
+    TbxCriticalSectionEnter();
+    uint32_t nowCycles = DWT->CYCCNT;
+    for (uint8_t mailboxIdx = 0U; mailboxIdx < 3U; mailboxIdx++)
+    {
+      // Is the mailbox busy and did its frame miss the deadline?
+      if ((READ_BIT(CAN->TSR, CAN_TSR_TME0 << mailboxIdx) == 0U) &&
+          ((nowCycles - m_TxMailboxCycles[mailboxIdx]) >= m_TxDeadlineCycles))
       {
-        switchRequired = pdTRUE;
+        // Request the abort of the transmission. Note that a bitwise OR operation does
+        // not work properly on this register, as it would clear all RQCP bit flags.
+        WRITE_REG(CAN->TSR, CAN_TSR_ABRQ0 << (mailboxIdx * 8U));
       }
     }
+    // Release mutual exclusive access to the transmit mailboxes.
+    TbxCriticalSectionExit();
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Moves frames from the software transmit queue into the empty transmit
+///            mailboxes, until either the queue is empty or all mailboxes are busy.
+/// \attention Only call this method from the transmit interrupt. It is the sole
+///            consumer of the transmit queue.
+///
+///**************************************************************************************
+void BxCan::refillTxMailboxes()
+{
+  // Keep going as long as frames are waiting in the transmit queue.
+  while (m_TxQueueTail != m_TxQueueHead)
+  {
+    uint8_t txMbEmptyIdx = findEmptyTxMailbox();
+    // Stop once all transmit mailboxes are busy.
+    if (txMbEmptyIdx == c_InvalidMailboxIdx)
+    {
+      break;
+    }
+    // Write the oldest frame to the mailbox and remove it from the queue.
+    writeTxMailbox(txMbEmptyIdx, m_TxQueue[m_TxQueueTail]);
+    m_TxQueueTail = (m_TxQueueTail + 1U) % m_TxQueueSlots;
   }
-  // Inform the scheduler if a higher priority task was woken, requiring a context switch
-  // when this ISR finishes.
-  portYIELD_FROM_ISR(switchRequired);        
 }
 
 
 ///**************************************************************************************
 /// \brief     Helper function to find appropriate bit timing settings to the requested
 ///            baudrate configuration and taking into account the clock frequency that
-///            drives the CAN controller.
-/// \param     t_Prescaler Prescaler value for the baudrate generator [1..1024].
-/// \param     t_Tseg1 Time segment 1 bit value [1..16].
-/// \param     t_Tseg2 Time segment 2 bit value [1..8].
+///            drives the CAN controller. The settings for the standard baudrates are
+///            determined at compile time. Only for other baudrates or an unexpected
+///            clock frequency, the solver runs at this point.
+/// \param     t_BitTiming Bit timing settings to store the result in.
 /// \return    TBX_OK if fitting bit timing settings could be found, TBX_ERROR otherwise.
 ///
 ///**************************************************************************************
-uint8_t BxCan::findBitTimingSettings(uint16_t& t_Prescaler, uint8_t& t_Tseg1,
-                                  uint8_t& t_Tseg2)
+uint8_t BxCan::findBitTimingSettings(BxCanBitTiming& t_BitTiming)
 {
   uint8_t result = TBX_ERROR;
-  // Bit time in time quanta (TQ) = 1 (for SYNC) + tseg1 + tseg2. Given the possible
-  // range for tseg1 and tseg2 this means:
-  // - bitTimeMaxTQ = 1 + 16 + 8 = 25 TQ
-  // - bitTimeMinTQ = 1 + 1 + 1 = 3 TQ
-  // Just keep in mind the tseg ranges that the hardware supports:
-  // - tseg1 = 1..16
-  // - tseg2 = 1..8
-  //
-  // The following table lists the different configuration options for each supported
-  // total number of TQ in a bit, such that tseg1 and tseg2 result in a sample point
-  // (SP) that is as close to 75% as possible, as this is the preferred sample point for
-  // protocols such as CANopen and DeviceNet. Made static to lower ROM and stack load.
-  static const struct
-  {
-    uint8_t tq;
-    uint8_t tseg1;
-    uint8_t tseg2;
-  } bitTimingTbl[] =
-  {
-    { 23U, 16U,  6U },  // SP = 100 - (6 / 23) * 100 = 74%
-    { 22U, 16U,  5U },  // SP = 100 - (5 / 22) * 100 = 77%
-    { 21U, 15U,  5U },  // SP = 100 - (5 / 21) * 100 = 76%
-    { 20U, 14U,  5U },  // SP = 100 - (5 / 20) * 100 = 75%
-    { 19U, 13U,  5U },  // SP = 100 - (5 / 19) * 100 = 74%
-    { 18U, 13U,  4U },  // SP = 100 - (4 / 18) * 100 = 78%
-    { 17U, 12U,  4U },  // SP = 100 - (4 / 17) * 100 = 76%
-    { 16U, 11U,  4U },  // SP = 100 - (4 / 16) * 100 = 75%
-    { 15U, 10U,  4U },  // SP = 100 - (4 / 15) * 100 = 72%
-    { 14U, 10U,  3U },  // SP = 100 - (3 / 14) * 100 = 79%
-    { 13U,  9U,  3U },  // SP = 100 - (3 / 13) * 100 = 77%
-    { 12U,  8U,  3U },  // SP = 100 - (3 / 12) * 100 = 75%
-    { 11U,  7U,  3U },  // SP = 100 - (3 / 11) * 100 = 73%
-    { 10U,  7U,  2U },  // SP = 100 - (2 / 10) * 100 = 80%
-    {  9U,  6U,  2U },  // SP = 100 - (2 /  9) * 100 = 78%
-    {  8U,  5U,  2U },  // SP = 100 - (2 /  8) * 100 = 75%
-    {  7U,  4U,  2U },  // SP = 100 - (2 /  7) * 100 = 71%
-    {  6U,  4U,  1U },  // SP = 100 - (1 /  6) * 100 = 83%
-    {  5U,  3U,  1U },  // SP = 100 - (1 /  5) * 100 = 80%
-    {  4U,  3U,  1U },  // SP = 100 - (1 /  4) * 100 = 75%
-    {  3U,  2U,  1U }   // SP = 100 - (1 /  3) * 100 = 67%
-  };
-  constexpr size_t     bitTimeTblSize = sizeof(bitTimingTbl)/sizeof(bitTimingTbl[0]);
-  constexpr uint16_t   maxPrescaler = 1024U;
-  constexpr uint16_t   minPrescaler = 1U;
-  const uint32_t       baudrate = static_cast<uint32_t>(m_Baudrate);
-  size_t               tblIdx;
-  uint16_t             prescaler;
+  const uint32_t baudrate = static_cast<uint32_t>(m_Baudrate);
   LL_RCC_ClocksTypeDef rccClocks{ };
 
   // Determine the speed of the clock that drives the CAN peripheral.
@@ -788,31 +1809,25 @@ uint8_t BxCan::findBitTimingSettings(uint16_t& t_Prescaler, uint8_t& t_Tseg1,
   TBX_ASSERT(rccClocks.PCLK1_Frequency != 0);
   uint32_t canClockFreqHz = rccClocks.PCLK1_Frequency;
 
-  // Search for a fitting prescaler by looping through all its possible values.
-  for (prescaler = minPrescaler; prescaler <= maxPrescaler; prescaler++)
+  // Look up the settings, if they were already determined at compile time.
+  if (canClockFreqHz == canClockHz)
   {
-    // Determine if this prescaler, combined with a TQ per bit results in an exact match
-    // for the requested baudrate, while taking into account that a larger amount of TQ
-    // per bit, allows for a better sample point configuration.
-    for (tblIdx = 0U; tblIdx < bitTimeTblSize; tblIdx++)
+    for (BitTimingTblEntry const& entry : bitTimingTbl)
     {
-      // Exact baudrate match using this prescaler and TQ per bit configuration?
-      if ((canClockFreqHz / prescaler / bitTimingTbl[tblIdx].tq) == baudrate)
+      if (entry.baudrate == baudrate)
       {
-        // Found a match. Store the bit timing settings, update the result and break
-        // this loop, since we are done.
-        t_Prescaler = prescaler;
-        t_Tseg1 = bitTimingTbl[tblIdx].tseg1;
-        t_Tseg2 = bitTimingTbl[tblIdx].tseg2;
-        result = TBX_OK;
+        t_BitTiming = entry.bitTiming;
+        result = entry.found;
         break;
       }
     }
-    // Stop looping if a match was already found.
-    if (result == TBX_OK)
-    {
-      break;
-    }
+  }
+  // Run the solver if the settings were not yet determined at compile time.
+  if (result != TBX_OK)
+  {
+    result = BxCanBitTiming::solve(canClockFreqHz, baudrate, samplePointPermille,
+                                   oscTolerancePpm, BxCanBitTiming::SJWMAX,
+                                   t_BitTiming);
   }
   // Give the result back to the caller.
   return result;
@@ -40,9 +40,10 @@
 // Include files
 //***************************************************************************************
 #include <memory>
+#include <array>
 #include "can.hpp"
+#include "bxcanbittiming.hpp"
 #include "thread.hpp"
-#include "queue.hpp"
 #include "microtbx.h"
 
 
@@ -58,57 +59,198 @@ extern "C" void CAN_SCE_IRQHandler(void);
 //***************************************************************************************
 // Class definitions
 //***************************************************************************************
-/// \brief Basic Extended CAN event class.
+/// \brief   Basic Extended CAN frame class.
+/// \details Stores a frame in the exact layout of the mailbox registers. The transmit
+///          and receive mailboxes share this layout. This way the interrupts can copy
+///          a frame from or to a mailbox, without any further conversion. Intentionally
+///          kept trivially copyable.
+class BxCanFrame
+{
+public:
+  // Members.
+  uint32_t ir;
+  uint32_t dtr;
+  uint32_t dlr;
+  uint32_t dhr;
+};
+
+
+/// \brief   Basic Extended CAN event class.
+/// \details Intentionally kept trivially copyable, such that the interrupts can fill it
+///          in directly inside the event pool.
 class BxCanEvent
 {
 public: 
   // Enumerations.
-  enum Type
+  enum Type : uint8_t
   {
     TXCOMPLETE,
+    TXABORTED,
     RXINDICATION,
     BUSOFF
   };
-  // Constructors and destructor.
-  explicit BxCanEvent() { }
-  virtual ~BxCanEvent() { }
   // Members.
-  Type type{RXINDICATION};
-  CanMsg msg;
+  Type type;
+  uint32_t cycles; ///< Cycle counter value upon entry of the reception interrupt.
+  BxCanFrame frame;
+};
+
+
+/// \brief   Basic Extended CAN filter bank class.
+/// \details Holds the settings of one reception filter bank, in the exact layout of the
+///          filter bank registers.
+class BxCanFilterBank
+{
+public:
+  // Enumerations.
+  enum Mode : uint8_t
+  {
+    LIST16, ///< Four 11-bit identifiers in 16-bit identifier list mode.
+    LIST32, ///< Two identifiers in 32-bit identifier list mode.
+    MASK16, ///< Two 11-bit code/mask pairs in 16-bit identifier mask mode.
+    MASK32  ///< One code/mask pair in 32-bit identifier mask mode.
+  };
+  // Members.
+  Mode mode;
+  uint8_t fifo;
+  uint32_t fr1;
+  uint32_t fr2;
 };
 
 
 /// \brief Basic Extended CAN driver class.
-class BxCan : public Can, public cpp_freertos::Thread
+class BxCan final : public Can, public cpp_freertos::Thread
 {
 public:
+  // Enumerations.
+  enum ErrorState : uint8_t
+  {
+    ERRORACTIVE,  ///< Error counters below the warning limit.
+    ERRORWARNING, ///< An error counter reached the warning limit of 96.
+    ERRORPASSIVE, ///< An error counter exceeded the error passive limit of 127.
+    ERRORBUSOFF   ///< Transmit error counter exceeded 255.
+  };
   // Constructors and destructor.
-  explicit BxCan(size_t t_EventQueueSize = 16U);
+  explicit BxCan(size_t t_TxQueueSize = 32U, uint32_t t_TxDeadlineMs = 100U);
   virtual ~BxCan();
   // Methods.
   void connect(Baudrate t_Baudrate) override;
   void disconnect() override;
   uint8_t transmit(CanMsg& t_Msg) override;
   // Getters and setters.
+  void setBusOffBackoff(uint32_t t_MinMs, uint32_t t_MaxMs);
+  size_t filterBankCount() const override { return c_FilterBankCount; }
   void setFilter(CanFilter& t_Filter) override;
+  uint8_t setFilterSet(CanFilterSet const& t_FilterSet) override;
+  size_t txPendingCount() const override;
+  size_t txQueueHighWaterMark() const { return m_TxQueueHighWaterMark; }
+  uint32_t txQueueOverflowCount() const { return m_TxQueueOverflowCount; }
+  uint32_t txFrameCount() const { return m_TxFrameCount; }
+  uint32_t txAbortCount() const { return m_TxAbortCount; }
+  uint8_t eventPoolHighWaterMark() const { return m_EventPoolHighWaterMark; }
+  uint32_t eventPoolOverflowCount() const { return m_EventPoolOverflowCount; }
+  uint32_t rxOverrunCount() const { return m_RxOverrunCount; }
+  uint32_t busOffCount() const { return m_BusOffCount; }
+  uint32_t busOffRecoveryCount() const { return m_BusOffRecoveryCount; }
+  ErrorState errorState() const { return m_ErrorState; }
+  uint8_t txErrorCounter() const { return m_TxErrorCounter; }
+  uint8_t rxErrorCounter() const { return m_RxErrorCounter; }
+  uint8_t lastErrorCode() const { return m_LastErrorCode; }
+  uint32_t errorWarningCount() const { return m_ErrorWarningCount; }
+  uint32_t errorPassiveCount() const { return m_ErrorPassiveCount; }
+  uint32_t swFilterDropCount() const { return m_SwFilterDropCount; }
+  uint32_t swFilterDropRate() const { return m_SwFilterDropRate; }
 
 private:
+  // Enumerations.
+  enum ConnectState : uint8_t
+  {
+    OFFLINE,
+    ENTERINIT,
+    LEAVEINIT,
+    ONLINE,
+    RECOVERING
+  };
   // Constants.
   static constexpr uint8_t c_InvalidMailboxIdx = 0xFFU;
+  static constexpr uint32_t c_InitAckTimeoutMs = 1000U;
+  static constexpr uint32_t c_TxDeadlinePollMs = 5U;
+  static constexpr uint32_t c_TxDeadlineCyclesMax = UINT32_MAX / 2U;
+  static constexpr uint32_t c_BusOffBackoffMinMs = 10U;
+  static constexpr uint32_t c_BusOffBackoffMaxMs = 1000U;
+  static constexpr uint8_t c_EventPoolSize = 16U;
+  static constexpr uint8_t c_FilterBankCount = 14U;
   // Members.
   static BxCan* s_InstancePtr;
   uint8_t m_Connected{TBX_FALSE};
+  volatile ConnectState m_ConnectState{OFFLINE};
+  TickType_t m_ConnectStateTicks{0U};
   Baudrate m_Baudrate{BR500K};
-  CanFilter m_Filter{0UL, 0UL, CanFilter::BOTH};
-  std::unique_ptr<cpp_freertos::Queue> m_EventQueue{nullptr};
+  CanFilterSet m_FilterSet{ };
+  std::array<BxCanFilterBank, c_FilterBankCount> m_FilterBanks{ };
+  uint8_t m_FilterBankCount{0U};
+  CanFilterSet m_HwFilterSet{ };
+  std::array<uint32_t, (CanMsg::c_StdIdMax + 1U) / 32U> m_SwStdIdBitmap{ };
+  std::array<uint32_t, CanFilterSet::c_EntriesMax> m_SwExtIds{ };
+  size_t m_SwExtIdCount{0U};
+  volatile uint8_t m_SwFilterActive{TBX_FALSE};
+  volatile uint32_t m_SwFilterDropCount{0U};
+  uint32_t m_SwFilterDropRate{0U};
+  std::array<BxCanEvent, c_EventPoolSize + 1U> m_EventPool{ };
+  volatile uint8_t m_EventHead{0U};
+  volatile uint8_t m_EventTail{0U};
+  std::unique_ptr<BxCanFrame[]> m_TxQueue{nullptr};
+  size_t m_TxQueueSlots;
+  volatile size_t m_TxQueueHead{0U};
+  volatile size_t m_TxQueueTail{0U};
+  size_t m_TxQueueHighWaterMark{0U};
+  uint32_t m_TxQueueOverflowCount{0U};
+  uint32_t m_TxFrameCount{0U};
+  uint32_t m_TxDeadlineCycles{0U};
+  std::array<uint32_t, 3U> m_TxMailboxCycles{ };
+  volatile uint32_t m_TxAbortCount{0U};
+  volatile uint8_t m_EventPoolHighWaterMark{0U};
+  volatile uint32_t m_EventPoolOverflowCount{0U};
+  volatile uint32_t m_RxOverrunCount{0U};
+  uint32_t m_BusOffCount{0U};
+  uint32_t m_BusOffRecoveryCount{0U};
+  uint32_t m_BusOffBackoffMinMs{c_BusOffBackoffMinMs};
+  uint32_t m_BusOffBackoffMaxMs{c_BusOffBackoffMaxMs};
+  uint32_t m_BusOffBackoffMs{0U};
+  volatile ErrorState m_ErrorState{ERRORACTIVE};
+  volatile uint8_t m_TxErrorCounter{0U};
+  volatile uint8_t m_RxErrorCounter{0U};
+  volatile uint8_t m_LastErrorCode{0U};
+  volatile uint32_t m_ErrorWarningCount{0U};
+  volatile uint32_t m_ErrorPassiveCount{0U};
   // Methods.
   void Run() override;
+  void processConnect();
+  void processBusOffRecovery();
+  void updateErrorStatus(uint32_t t_Esr);
+  void configureController();
+  uint8_t findEmptyTxMailbox() const;
+  void writeTxMailbox(uint8_t t_MailboxIdx, BxCanFrame const& t_Frame);
+  void refillTxMailboxes();
+  void checkTxDeadlines();
+  BxCanEvent* claimEventFromISR();
+  void commitEventFromISR();
+  uint8_t dispatchFromISR(BxCanEvent const& t_Event);
+  static void frameToMsg(BxCanFrame const& t_Frame, CanMsg& t_Msg);
+  static uint8_t buildFilterBanks(CanFilterSet const& t_FilterSet, 
+                                  BxCanFilterBank t_Banks[]);
+  static BxCanFilterBank::Mode filterBankMode(CanFilterEntry const& t_Entry);
+  static void setFilterBankSlot(BxCanFilterBank& t_Bank, uint8_t t_SlotIdx,
+                                CanFilterEntry const& t_Entry);
+  void applyFilterBanks();
+  void buildSwFilter();
+  uint8_t swFilterAcceptsFromISR(uint32_t t_Rir) const;
+  static uint32_t findFilterSplitBit(uint32_t t_Mask, uint8_t t_IdBits);
   void processTxInterrupt();
   void processRxFifo0Interrupt();
   void processRxFifo1Interrupt();
   void processErrorInterrupt();
-  uint8_t findBitTimingSettings(uint16_t& t_Prescaler, uint8_t& t_Tseg1, 
-                                uint8_t& t_Tseg2);
+  uint8_t findBitTimingSettings(BxCanBitTiming& t_BitTiming);
   // Friends.
   friend void USB_HP_CAN_TX_IRQHandler(void);
   friend void USB_LP_CAN_RX0_IRQHandler(void);
@@ -0,0 +1,190 @@
+///**************************************************************************************
+/// \file         bxcanbittiming.hpp
+/// \brief        Basic Extended CAN bit timing solver header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef BXCANBITTIMING_HPP
+#define BXCANBITTIMING_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include "microtbx.h"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Basic Extended CAN bit timing class.
+/// \details Holds the bit timing settings and offers a solver to find them for any
+///          bitrate. A bit consists of 1 time quantum (TQ) for SYNC, tseg1 TQ and tseg2
+///          TQ. The sample point lies between tseg1 and tseg2. The solver tries all
+///          supported combinations of TQ per bit and tseg2. For each one, it selects
+///          the prescaler that gets closest to the requested bitrate. A candidate is
+///          only valid if the oscillator tolerance that its settings can handle, minus
+///          its bitrate error, still covers the requested oscillator tolerance. The
+///          oscillator tolerance is determined with the usual formulas from the CAN
+///          specification, with tseg2 as the limiting phase segment. Valid candidates
+///          are ranked by their sample point error first and by their number of TQ per
+///          bit second, where more TQ is better.
+///          The solver only relies on constant expressions. So when the clock is known
+///          at build time, the settings can be determined at compile time.
+/// \example Determining the settings for 83.333 kbit/s on a 36 MHz clock:
+///            BxCanBitTiming myTiming{ };
+///            BxCanBitTiming::solve(36000000, 83333, 875, 1000, BxCanBitTiming::SJWMAX,
+///                                  myTiming);
+class BxCanBitTiming
+{
+public:
+  // Enumerations.
+  enum SjwPolicy : uint8_t
+  {
+    SJWMIN, ///< Synchronization jump width of 1 TQ.
+    SJWMAX  ///< Synchronization jump width as large as possible, but no more than tseg2.
+  };
+  // Constants.
+  static constexpr uint16_t c_PrescalerMax = 1024U;
+  static constexpr uint8_t c_Tseg1Max = 16U;
+  static constexpr uint8_t c_Tseg2Max = 8U;
+  static constexpr uint8_t c_SjwMax = 4U;
+  // Methods.
+  static constexpr uint8_t solve(uint32_t t_ClockHz, uint32_t t_Bitrate,
+                                 uint16_t t_SamplePointPermille,
+                                 uint32_t t_OscTolerancePpm, SjwPolicy t_SjwPolicy,
+                                 BxCanBitTiming& t_BitTiming);
+  // Members.
+  uint16_t prescaler;
+  uint8_t tseg1;
+  uint8_t tseg2;
+  uint8_t sjw;
+};
+
+
+//***************************************************************************************
+// Method definitions
+//***************************************************************************************
+///**************************************************************************************
+/// \brief     Determines the bit timing settings for a bitrate.
+/// \param     t_ClockHz Frequency of the clock that drives the CAN peripheral.
+/// \param     t_Bitrate Requested bitrate in bits per second.
+/// \param     t_SamplePointPermille Requested sample point in permille of the bit time.
+/// \param     t_OscTolerancePpm Oscillator tolerance in ppm that the settings must be
+///            able to handle.
+/// \param     t_SjwPolicy Policy for selecting the synchronization jump width.
+/// \param     t_BitTiming Bit timing settings to store the result in.
+/// \return    TBX_OK if fitting bit timing settings could be found, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+constexpr uint8_t BxCanBitTiming::solve(uint32_t t_ClockHz, uint32_t t_Bitrate,
+                                        uint16_t t_SamplePointPermille,
+                                        uint32_t t_OscTolerancePpm,
+                                        SjwPolicy t_SjwPolicy,
+                                        BxCanBitTiming& t_BitTiming)
+{
+  constexpr uint8_t tqMin = 3U;
+  constexpr uint8_t tqMax = 1U + c_Tseg1Max + c_Tseg2Max;
+  uint8_t result = TBX_ERROR;
+  uint32_t bestSpError = 0U;
+  uint8_t bestTq = 0U;
+  bool paramsValid = (t_ClockHz != 0U) && (t_Bitrate != 0U) &&
+                     (t_SamplePointPermille <= 1000U);
+
+  // Try all supported numbers of TQ per bit, but only with valid parameters.
+  for (uint8_t tq = tqMin; (tq <= tqMax) && paramsValid; tq++)
+  {
+    // Select the prescaler that gets closest to the requested bitrate.
+    uint64_t tqRate = static_cast<uint64_t>(t_Bitrate) * tq;
+    uint64_t prescaler = (t_ClockHz + (tqRate / 2U)) / tqRate;
+    if ((prescaler < 1U) || (prescaler > c_PrescalerMax))
+    {
+      continue;
+    }
+    // Determine the bitrate error in ppm.
+    uint64_t actualTqRate = tqRate * prescaler;
+    uint64_t rateDelta = (actualTqRate > t_ClockHz) ? (actualTqRate - t_ClockHz) :
+                                                      (t_ClockHz - actualTqRate);
+    uint64_t bitrateErrorPpm = (rateDelta * 1000000U) / actualTqRate;
+    // Try all supported tseg2 values for this number of TQ per bit.
+    for (uint8_t tseg2 = 1U; tseg2 <= c_Tseg2Max; tseg2++)
+    {
+      // Skip if tseg1 does not fit.
+      if ((tq <= (tseg2 + 1U)) || ((tq - 1U - tseg2) > c_Tseg1Max))
+      {
+        continue;
+      }
+      uint8_t tseg1 = tq - 1U - tseg2;
+      uint8_t sjw = (t_SjwPolicy == SJWMIN) ? 1U :
+                    ((tseg2 > c_SjwMax) ? c_SjwMax : tseg2);
+      // Determine the oscillator tolerance in ppm that these settings can handle.
+      uint8_t phaseSeg = (tseg1 < tseg2) ? tseg1 : tseg2;
+      uint64_t tolerancePpm = (static_cast<uint64_t>(sjw) * 1000000U) / (20U * tq);
+      uint64_t tolerance2Ppm = (static_cast<uint64_t>(phaseSeg) * 1000000U) /
+                               (2U * ((13U * tq) - tseg2));
+      tolerancePpm = (tolerance2Ppm < tolerancePpm) ? tolerance2Ppm : tolerancePpm;
+      // Skip if the settings cannot handle the bitrate error plus the requested
+      // oscillator tolerance.
+      if (tolerancePpm < (bitrateErrorPpm + t_OscTolerancePpm))
+      {
+        continue;
+      }
+      // Determine the sample point error, scaled by the number of TQ per bit, to
+      // prevent a division.
+      uint32_t spScaled = (1U + tseg1) * 1000U;
+      uint32_t spTarget = static_cast<uint32_t>(t_SamplePointPermille) * tq;
+      uint32_t spError = (spScaled > spTarget) ? (spScaled - spTarget) :
+                                                 (spTarget - spScaled);
+      // Keep this candidate if it has a smaller sample point error than the best one
+      // so far, or the same sample point error with more TQ per bit. Note that the
+      // errors are compared with cross multiplication, because they are scaled by
+      // their number of TQ per bit.
+      uint32_t lhs = spError * bestTq;
+      uint32_t rhs = bestSpError * tq;
+      if ((result == TBX_ERROR) || (lhs < rhs) || ((lhs == rhs) && (tq > bestTq)))
+      {
+        t_BitTiming.prescaler = static_cast<uint16_t>(prescaler);
+        t_BitTiming.tseg1 = tseg1;
+        t_BitTiming.tseg2 = tseg2;
+        t_BitTiming.sjw = sjw;
+        bestSpError = spError;
+        bestTq = tq;
+        result = TBX_OK;
+      }
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+#endif // BXCANBITTIMING_HPP
+//********************************** end of bxcanbittiming.hpp **************************
@@ -39,6 +39,7 @@
 //***************************************************************************************
 #include "microtbx.h"
 #include "hardwareboard.hpp"
+#include "latencymonitor.hpp"
 #include "logger.hpp"
 #include "thread.hpp"
 #include "critical.hpp"
@@ -92,6 +93,56 @@ HardwareBoard::HardwareBoard()
   m_BxCan = std::make_unique<BxCan>();
   // Create the bootloader object on the heap.
   m_Bootloader = std::make_unique<Bootloader>();
+  // Create the user push button object on the heap.
+  m_UserButton = std::make_unique<UserButton>();
+  // Create the staging flash object on the heap.
+  m_StagingFlash = std::make_unique<StagingFlash>();
+}
+
+
+///**************************************************************************************
+/// \brief     Logs the forwarding latency histograms and then clears them, such that
+///            the next log only covers what happened since.
+///
+///**************************************************************************************
+void HardwareBoard::logStatistics()
+{
+  latencyMonitor().log();
+  latencyMonitor().clear();
+}
+
+
+///**************************************************************************************
+/// \brief     Takes a snapshot of the board's statistics counters.
+/// \param     t_Statistics Storage for the snapshot.
+///
+///**************************************************************************************
+void HardwareBoard::statistics(HardwareBoardStatistics& t_Statistics)
+{
+  // Obtain mutual exclusive access to the counters, such that the snapshot is
+  // consistent.
+  TbxCriticalSectionEnter();
+  t_Statistics.canTxFrames = m_BxCan->txFrameCount();
+  t_Statistics.usbTxPackets = m_TinyUsbDevice->txPacketCount();
+  t_Statistics.canTxQueueDrops = m_BxCan->txQueueOverflowCount();
+  t_Statistics.usbTxDrops = m_TinyUsbDevice->txDropCount();
+  t_Statistics.canEventPoolDrops = m_BxCan->eventPoolOverflowCount();
+  t_Statistics.canRxOverruns = m_BxCan->rxOverrunCount();
+  t_Statistics.canBusOffs = m_BxCan->busOffCount();
+  t_Statistics.canTxQueueHighWater = m_BxCan->txQueueHighWaterMark();
+  t_Statistics.canEventPoolHighWater = m_BxCan->eventPoolHighWaterMark();
+  t_Statistics.canSwFilterDrops = m_BxCan->swFilterDropCount();
+  t_Statistics.canSwFilterDropRate = m_BxCan->swFilterDropRate();
+  t_Statistics.canTxAborts = m_BxCan->txAbortCount();
+  t_Statistics.canBusOffRecoveries = m_BxCan->busOffRecoveryCount();
+  t_Statistics.canErrorWarnings = m_BxCan->errorWarningCount();
+  t_Statistics.canErrorPassives = m_BxCan->errorPassiveCount();
+  t_Statistics.canErrorState = m_BxCan->errorState();
+  t_Statistics.canTxErrorCounter = m_BxCan->txErrorCounter();
+  t_Statistics.canRxErrorCounter = m_BxCan->rxErrorCounter();
+  t_Statistics.canLastErrorCode = m_BxCan->lastErrorCode();
+  // Release mutual exclusive access to the counters.
+  TbxCriticalSectionExit();
 }
 
 
@@ -210,10 +261,17 @@ void HardwareBoard::mcuInit()
   LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_GPIOF);
   LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_USB);
   LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_CAN);
+  LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_TIM7);
 #if ( configGENERATE_RUN_TIME_STATS == 1 )
   LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_TIM2);
 #endif 
 
+  // Enable the DWT cycle counter. It serves as a high resolution timebase for measuring
+  // short time intervals, such as the USB and CAN transmit deadlines.
+  SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
+  WRITE_REG(DWT->CYCCNT, 0U);
+  SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+
   // Out of reset, the Olimexino-STM32F3 board enables a pull-up on the USB_DP line. If
   // the board already enumerated, then it might stay in that state, even after a reset.
   // It is therefore best to first make sure the USB device disconnects from the USB
@@ -260,12 +318,17 @@ void HardwareBoard::mcuInit()
   NVIC_SetPriority(USB_HP_IRQn, 10);
   NVIC_SetPriority(USB_LP_IRQn, 10);
   NVIC_SetPriority(USBWakeUp_RMP_IRQn, 10);
+  // The USB transmit flush deadline timer defers work to the TinyUSB device task, just
+  // like the USB interrupts, so it runs on the same level.
+  NVIC_SetPriority(TIM7_IRQn, 10);
   
-  // CAN related interrupt configuration.
-  NVIC_SetPriority(USB_HP_CAN_TX_IRQn, 10);
-  NVIC_SetPriority(USB_LP_CAN_RX0_IRQn, 10);
-  NVIC_SetPriority(CAN_RX1_IRQn, 10);
-  NVIC_SetPriority(CAN_SCE_IRQn, 10);
+  // CAN related interrupt configuration. One level above the USB interrupts, such that
+  // USB interrupt handling does not delay emptying the reception FIFOs. All CAN
+  // interrupts must share the same level, because they all write to the event pool.
+  NVIC_SetPriority(USB_HP_CAN_TX_IRQn, 9);
+  NVIC_SetPriority(USB_LP_CAN_RX0_IRQn, 9);
+  NVIC_SetPriority(CAN_RX1_IRQn, 9);
+  NVIC_SetPriority(CAN_SCE_IRQn, 9);
 
   // Configure the system clock from reset.
   setupSystemClock();
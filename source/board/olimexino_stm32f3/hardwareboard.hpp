@@ -45,6 +45,8 @@
 #include "tinyusbdevice.hpp"
 #include "bxcan.hpp"
 #include "bootloader.hpp"
+#include "userbutton.hpp"
+#include "stagingflash.hpp"
 
 
 //***************************************************************************************
@@ -56,6 +58,45 @@ extern "C" void BoardAssertHandler(const char * const file, uint32_t line);
 //***************************************************************************************
 // Class definitions
 //***************************************************************************************
+/// \brief   Board statistics class.
+/// \details Snapshot of the counters that help to find out where frames get lost. The
+///          host reads it as is, via a vendor control request on the USB device. The
+///          order and size of its members therefore form the layout of that response:
+///          all unsigned 32-bit little endian values. Only ever append new members.
+///          Intentionally kept trivially copyable.
+class HardwareBoardStatistics
+{
+public:
+  // Members.
+  uint32_t canTxFrames;            ///< Frames submitted for transmission on CAN.
+  uint32_t usbTxPackets;           ///< Packets submitted for transmission on USB.
+  uint32_t canTxQueueDrops;        ///< Frames dropped, because the CAN transmit
+                                   ///< mailboxes and queue were full.
+  uint32_t usbTxDrops;             ///< Packets dropped, because the USB transmit
+                                   ///< FIFO was full.
+  uint32_t canEventPoolDrops;      ///< CAN events dropped, because the event pool
+                                   ///< was full.
+  uint32_t canRxOverruns;          ///< CAN reception FIFO overruns.
+  uint32_t canBusOffs;             ///< CAN bus off events.
+  uint32_t canTxQueueHighWater;    ///< High-water mark of the CAN transmit queue.
+  uint32_t canEventPoolHighWater;  ///< High-water mark of the CAN event pool.
+  uint32_t canSwFilterDrops;       ///< CAN frames dropped by the software acceptance
+                                   ///< filter.
+  uint32_t canSwFilterDropRate;    ///< CAN frames dropped by the software acceptance
+                                   ///< filter during the last second.
+  uint32_t canTxAborts;            ///< CAN frames aborted, because they were not
+                                   ///< acknowledged before their transmit deadline.
+  uint32_t canBusOffRecoveries;    ///< CAN bus off recoveries.
+  uint32_t canErrorWarnings;       ///< CAN error warning state entries.
+  uint32_t canErrorPassives;       ///< CAN error passive state entries.
+  uint32_t canErrorState;          ///< CAN error state: 0 = error active, 1 = error
+                                   ///< warning, 2 = error passive, 3 = bus off.
+  uint32_t canTxErrorCounter;      ///< CAN transmit error counter (TEC).
+  uint32_t canRxErrorCounter;      ///< CAN receive error counter (REC).
+  uint32_t canLastErrorCode;       ///< Last detected CAN error code (LEC).
+};
+
+
 /// \brief   Board support package class that represents the hardware abstraction layer.
 ///          It implements the getters of the abstract class that it derives from.
 /// \details Note that the getters actually return a reference to the hardware specific
@@ -63,7 +104,7 @@ extern "C" void BoardAssertHandler(const char * const file, uint32_t line);
 ///          hardware dependent parts. For example: m_StatusLed is of type StatusLed but
 ///          the statusLed() getter returns the reference of the generic hardware
 ///          abstracted type Led.
-class HardwareBoard : public Board
+class HardwareBoard final : public Board
 {
 public:
   // Constructors and destructor.
@@ -74,7 +115,11 @@ public:
   UsbDevice& usbDevice() override { return *m_TinyUsbDevice; }
   Can& can() override { return *m_BxCan; }
   Boot& boot() override { return *m_Bootloader; }
+  Button& userButton() override { return *m_UserButton; }
+  Storage& storage() override { return *m_StagingFlash; }
   // Methods.
+  void logStatistics() override;
+  void statistics(HardwareBoardStatistics& t_Statistics);
   void suspend();
   void resume();
 
@@ -84,6 +129,8 @@ private:
   std::unique_ptr<TinyUsbDevice> m_TinyUsbDevice{nullptr};
   std::unique_ptr<BxCan> m_BxCan{nullptr};
   std::unique_ptr<Bootloader> m_Bootloader{nullptr};
+  std::unique_ptr<UserButton> m_UserButton{nullptr};
+  std::unique_ptr<StagingFlash> m_StagingFlash{nullptr};
   // Methods.
   void mcuInit();
   void setupSystemClock();
@@ -0,0 +1,233 @@
+///**************************************************************************************
+/// \file         latencymonitor.cpp
+/// \brief        Forwarding latency monitor source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include "latencymonitor.hpp"
+#include "logger.hpp"
+
+
+//***************************************************************************************
+// Local data declarations
+//***************************************************************************************
+namespace
+{
+  // Declare the latency monitor instance at namespace scope, instead of lazily inside
+  // its getter. Its getter is also called from interrupt context and this avoids the
+  // guard of a function local static object.
+  LatencyMonitor s_LatencyMonitor;
+}
+
+
+///**************************************************************************************
+/// \brief     Global getter for the latency monitor.
+///
+///**************************************************************************************
+LatencyMonitor& latencyMonitor()
+{
+  return s_LatencyMonitor;
+}
+
+
+///**************************************************************************************
+/// \brief     Global getter for the latency recorder. This is the latency monitor.
+///
+///**************************************************************************************
+LatencyRecorder& latencyRecorder()
+{
+  return s_LatencyMonitor;
+}
+
+
+///**************************************************************************************
+/// \brief     Adds a latency to the histogram.
+/// \param     t_Micros The latency in microseconds.
+///
+///**************************************************************************************
+void LatencyHistogram::add(uint32_t t_Micros)
+{
+  size_t bucketIdx = 0U;
+
+  // Determine the bucket index. This is the index of the most significant bit that is
+  // set in the latency.
+  if (t_Micros > 1U)
+  {
+    bucketIdx = 31U - __CLZ(t_Micros);
+  }
+  // The last bucket also counts all latencies beyond its range.
+  if (bucketIdx >= c_BucketCount)
+  {
+    bucketIdx = c_BucketCount - 1U;
+  }
+  // Count the latency.
+  m_Buckets[bucketIdx]++;
+}
+
+
+///**************************************************************************************
+/// \brief     Clears the counts of all the buckets.
+///
+///**************************************************************************************
+void LatencyHistogram::clear()
+{
+  m_Buckets.fill(0U);
+}
+
+
+///**************************************************************************************
+/// \brief     Obtains the total number of latencies in the histogram.
+/// \return    Total number of latencies.
+///
+///**************************************************************************************
+uint32_t LatencyHistogram::total() const
+{
+  uint32_t result = 0U;
+
+  // Sum the counts of all the buckets.
+  for (auto count : m_Buckets)
+  {
+    result += count;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Obtains the upper bound of the bucket that holds the specified percentile
+///            of the latencies. So at least that percentage of the latencies is below
+///            the bound. Keep in mind that the last bucket also counts all latencies
+///            beyond its range.
+/// \param     t_Percent The percentile [1..100].
+/// \return    Upper bound in microseconds or 0 if the histogram is empty.
+///
+///**************************************************************************************
+uint32_t LatencyHistogram::bound(uint32_t t_Percent) const
+{
+  uint32_t result = 0U;
+  uint64_t threshold = ((static_cast<uint64_t>(total()) * t_Percent) + 99U) / 100U;
+  uint64_t count = 0U;
+
+  // Verify the parameter.
+  TBX_ASSERT((t_Percent >= 1U) && (t_Percent <= 100U));
+
+  // Find the first bucket where the cumulative count reaches the threshold.
+  for (size_t idx = 0U; (idx < c_BucketCount) && (result == 0U); idx++)
+  {
+    count += m_Buckets[idx];
+    if ((count >= threshold) && (count > 0U))
+    {
+      result = static_cast<uint32_t>(1UL << (idx + 1U));
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Clears all the histograms.
+///
+///**************************************************************************************
+void LatencyMonitor::clear()
+{
+  // Obtain mutual exclusive access to the histograms.
+  TbxCriticalSectionEnter();
+  for (auto& histogram : m_Histograms)
+  {
+    histogram.clear();
+  }
+  // Release mutual exclusive access to the histograms.
+  TbxCriticalSectionExit();
+}
+
+
+///**************************************************************************************
+/// \brief     Logs a summary of each histogram: the number of latencies, the median, the
+///            99th percentile and the maximum, each one as the upper bound in
+///            microseconds of the bucket that holds it. This is a single event per path,
+///            such that the dump fits in the logger's record pool with plenty of room
+///            to spare. Logging each bucket separately could take up to 48 events.
+///
+///**************************************************************************************
+void LatencyMonitor::log()
+{
+  static constexpr std::array<const char *, PATHCOUNT> pathFmt = 
+  {
+    "USB->CAN latency of %u frames: 50%% below %u us, 99%% below %u us, max below %u us",
+    "CAN->USB latency of %u frames: 50%% below %u us, 99%% below %u us, max below %u us",
+    "Round trip latency of %u frames: 50%% below %u us, 99%% below %u us, max below %u us"
+  };
+
+  // Log the summary of each histogram that actually holds latencies.
+  for (size_t pathIdx = 0U; pathIdx < PATHCOUNT; pathIdx++)
+  {
+    LatencyHistogram const& histogram = m_Histograms[pathIdx];
+    uint32_t total = histogram.total();
+    if (total > 0U)
+    {
+      logger().info(pathFmt[pathIdx], total, histogram.bound(50U),
+                    histogram.bound(99U), histogram.bound(100U));
+    }
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Records the latency of a frame in the histogram of the specified path.
+/// \details   Can also be called from interrupt context.
+/// \param     t_Path The forwarding path of the frame.
+/// \param     t_RxTimestamp Cycle counter value upon entry of the reception interrupt
+///            of the frame.
+///
+///**************************************************************************************
+void LatencyMonitor::record(Path t_Path, uint32_t t_RxTimestamp)
+{
+  // Determine the latency in microseconds. Note that the unsigned subtraction properly
+  // handles an overflow of the cycle counter.
+  uint32_t latencyMicros = (now() - t_RxTimestamp) / (SystemCoreClock / 1000000UL);
+  // Verify the parameter.
+  TBX_ASSERT(t_Path < PATHCOUNT);
+  // Obtain mutual exclusive access to the histograms. Needed because the forwarding
+  // paths of both directions record latencies, some from interrupt context.
+  TbxCriticalSectionEnter();
+  m_Histograms[t_Path].add(latencyMicros);
+  // Release mutual exclusive access to the histograms.
+  TbxCriticalSectionExit();
+}
+
+//********************************** end of latencymonitor.cpp **************************
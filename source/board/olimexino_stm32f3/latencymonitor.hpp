@@ -0,0 +1,122 @@
+///**************************************************************************************
+/// \file         latencymonitor.hpp
+/// \brief        Forwarding latency monitor header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef LATENCYMONITOR_HPP
+#define LATENCYMONITOR_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include <array>
+#include "latencyrecorder.hpp"
+#include "microtbx.h"
+#include "stm32f3xx.h"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Latency histogram class with log2 sized buckets.
+/// \details Bucket 0 counts latencies below 2 microseconds. Each next bucket covers
+///          twice the range of the previous one. So bucket n counts latencies from
+///          2^n up to 2^(n+1) microseconds. The last bucket also counts all latencies
+///          beyond its range. Method bound() gives the upper bound of the bucket that
+///          holds the specified percentile of the latencies.
+class LatencyHistogram
+{
+public:
+  // Constants.
+  static constexpr size_t c_BucketCount = 16U;
+  // Constructors and destructor.
+  explicit LatencyHistogram() { }
+  virtual ~LatencyHistogram() { }
+  // Methods.
+  void add(uint32_t t_Micros);
+  void clear();
+  // Getters and setters.
+  uint32_t bucket(size_t t_Idx) const { return m_Buckets[t_Idx]; }
+  uint32_t total() const;
+  uint32_t bound(uint32_t t_Percent) const;
+
+private:
+  // Members.
+  std::array<uint32_t, c_BucketCount> m_Buckets{ };
+
+  // Flag the class as non-copyable.
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  const LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+};
+
+
+/// \brief   Forwarding latency monitor class.
+/// \details Keeps track of how long frames spend inside the adapter. The drivers
+///          timestamp frames with the DWT cycle counter upon entry of the reception
+///          interrupt. The gateway records the latency of a frame with its own
+///          timestamp, once it handed the frame over to the driver on the other side.
+class LatencyMonitor : public LatencyRecorder
+{
+public:
+  // Constructors and destructor.
+  explicit LatencyMonitor() : LatencyRecorder() { }
+  virtual ~LatencyMonitor() { }
+  // Methods.
+  static uint32_t now() { return DWT->CYCCNT; }
+  void record(Path t_Path, uint32_t t_RxTimestamp) override;
+  void clear();
+  void log();
+  // Getters and setters.
+  LatencyHistogram const& histogram(Path t_Path) const { return m_Histograms[t_Path]; }
+
+private:
+  // Members.
+  std::array<LatencyHistogram, PATHCOUNT> m_Histograms;
+
+  // Flag the class as non-copyable.
+  LatencyMonitor(const LatencyMonitor&) = delete;
+  const LatencyMonitor& operator=(const LatencyMonitor&) = delete;
+};
+
+
+//***************************************************************************************
+// Function prototypes
+//***************************************************************************************
+// Global getter of the latency monitor's instance. The board uses it to log and clear
+// the histograms. The gateway records the latencies via latencyRecorder().
+LatencyMonitor& latencyMonitor();
+
+
+#endif // LATENCYMONITOR_HPP
+//********************************** end of latencymonitor.hpp **************************
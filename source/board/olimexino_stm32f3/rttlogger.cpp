@@ -42,6 +42,7 @@
 #include "SEGGER_RTT.h"
 #include "rttlogger.hpp"
 #include "ticks.hpp"
+#include "stm32f3xx.h"
 
 
 ///**************************************************************************************
@@ -71,25 +72,121 @@ Logger& logger()
 ///
 ///**************************************************************************************
 RttLogger::RttLogger()
-  : Logger()
+  : Logger(), cpp_freertos::Thread("LoggerThread", configMINIMAL_STACK_SIZE + 96, 1)
 {
   // Configure UP-buffer 0 to not block when data written to it does not fit. Discard the
   // data that does not fit. Make sure to never use SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL
   // here, because then the system hangs if the buffer is full. This can happen when no
   // RTT terminal is attached through the debugger, to read out the data.
   SEGGER_RTT_ConfigUpBuffer(0, NULL, NULL, 0, SEGGER_RTT_MODE_NO_BLOCK_TRIM);
+  // Start the thread.
+  Start();
 }
 
 
 ///**************************************************************************************
 /// \brief     Logs the event with the specified severity level. Basically a printf()
 ///            like function with an additional severity level parameter.
+/// \details   Info and warning events are only stored in their raw form in the record
+///            pool. The logger task formats and outputs them later on. Error events are
+///            formatted and output right away.
 /// \param     t_Level Severity level of the log event.
 /// \param     t_Fmt Format string.
 /// \param     t_ParamList Pointer to the list of arguments for the format string.
 ///
 ///**************************************************************************************
 void RttLogger::log(Logger::Level t_Level, const char t_Fmt[], va_list * t_ParamList)
+{
+  // Verify the parameters.
+  TBX_ASSERT((t_Level<=Logger::ERROR) && (t_Fmt != nullptr) && (t_ParamList != nullptr));
+
+  // Only continue with valid parameters.
+  if ((t_Level <= Logger::ERROR) && (t_Fmt != nullptr) && (t_ParamList != nullptr))
+  {
+    RttLogRecord record;
+
+    // Store the event in its raw form.
+    record.fmt = t_Fmt;
+    record.ticks = cpp_freertos::Ticks::GetTicks();
+    record.level = t_Level;
+    uint8_t argCount = countArgs(t_Fmt);
+    for (uint8_t idx = 0U; idx < RttLogRecord::c_ArgCountMax; idx++)
+    {
+      record.args[idx] = (idx < argCount) ? va_arg(*t_ParamList, uint32_t) : 0U;
+    }
+    // Output error events right away.
+    if (t_Level == Logger::ERROR)
+    {
+      output(record);
+    }
+    // Defer the output of all other events to the logger task.
+    else
+    {
+      // Obtain mutual exclusive access to the record pool, because multiple tasks can
+      // log events. Only held for the short time it takes to copy the record.
+      TbxCriticalSectionEnter();
+      uint8_t nextHead = (m_RecordHead + 1U) % m_RecordPool.size();
+      // Only store the record if the pool is not yet full. Note that one slot always
+      // stays unused, such that a full pool can be distinguished from an empty one.
+      if (nextHead != m_RecordTail)
+      {
+        m_RecordPool[m_RecordHead] = record;
+        m_RecordHead = nextHead;
+      }
+      else
+      {
+        m_RecordsDropped = m_RecordsDropped + 1U;
+      }
+      // Release mutual exclusive access to the record pool.
+      TbxCriticalSectionExit();
+    }
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Logger task function. Formats and outputs the events that were stored in
+///            the record pool.
+///
+///**************************************************************************************
+void RttLogger::Run()
+{
+  const TickType_t pollTicks = cpp_freertos::Ticks::MsToTicks(20U);
+
+  // Enter the task body, which should be an infinite loop.
+  for (;;)
+  {
+    // Periodically check for new events. Polling instead of getting notified keeps the
+    // cost of logging an event in the caller's context to a minimum.
+    Delay(pollTicks);
+    // Output all the events that are waiting in the record pool.
+    while (m_RecordTail != m_RecordHead)
+    {
+      output(m_RecordPool[m_RecordTail]);
+      // Make sure all accesses to the record slot completed, before releasing it.
+      __DMB();
+      m_RecordTail = (m_RecordTail + 1U) % m_RecordPool.size();
+    }
+    // Report the number of events that did not fit in the record pool, if any.
+    if (m_RecordsDropped > 0U)
+    {
+      TbxCriticalSectionEnter();
+      uint32_t recordsDropped = m_RecordsDropped;
+      m_RecordsDropped = 0U;
+      TbxCriticalSectionExit();
+      SEGGER_RTT_printf(0, RTT_CTRL_TEXT_YELLOW "%u log events dropped." 
+                        RTT_CTRL_RESET "\n", recordsDropped);
+    }
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Formats and outputs the event.
+/// \param     t_Record The event in its raw form.
+///
+///**************************************************************************************
+void RttLogger::output(RttLogRecord const& t_Record)
 {
   static constexpr std::array<char[8], 3> colorLevel = 
   {
@@ -98,28 +195,56 @@ void RttLogger::log(Logger::Level t_Level, const char t_Fmt[], va_list * t_Param
     RTT_CTRL_TEXT_RED
   };
 
-  // Verify the parameters.
-  TBX_ASSERT((t_Level<=Logger::ERROR) && (t_Fmt != nullptr) && (t_ParamList != nullptr));
+  // Get the system time in seconds.
+  TickType_t currentMillis = cpp_freertos::Ticks::TicksToMs(t_Record.ticks);
+  uint32_t sysTimeSec = currentMillis / 1000UL;
+  // Convert to hours, minutes and seconds.
+  int hours = (sysTimeSec / 3600) % 24;
+  int minutes = (sysTimeSec / 60) % 60;
+  int seconds = sysTimeSec % 60;
+  // Print the timestamp.
+  SEGGER_RTT_printf(0, "[%02d:%02d:%02d] ", hours, minutes, seconds);
+  // Print the formatted string in a color based on the severity level. Passing more
+  // arguments than the format string uses is harmless.
+  SEGGER_RTT_WriteString(0, colorLevel[t_Record.level]);
+  SEGGER_RTT_printf(0, t_Record.fmt, t_Record.args[0], t_Record.args[1], 
+                    t_Record.args[2], t_Record.args[3]);
+  // Add trailing new line.
+  SEGGER_RTT_WriteString(0, RTT_CTRL_RESET "\n");
+}
 
-  // Only continue with valid parameters.
-  if ((t_Level <= Logger::ERROR) && (t_Fmt != nullptr) && (t_ParamList != nullptr))
+
+///**************************************************************************************
+/// \brief     Counts the number of arguments that the format string expects, which is
+///            the number of conversion specifications. An escaped percent sign does not
+///            count.
+/// \param     t_Fmt Format string.
+/// \return    Number of arguments, limited to RttLogRecord::c_ArgCountMax.
+///
+///**************************************************************************************
+uint8_t RttLogger::countArgs(const char t_Fmt[])
+{
+  uint8_t result = 0U;
+
+  // Walk through the format string.
+  for (size_t idx = 0U; t_Fmt[idx] != '\0'; idx++)
   {
-    // Get the system time in seconds.
-    TickType_t currentTicks = cpp_freertos::Ticks::GetTicks();
-    TickType_t currentMillis = cpp_freertos::Ticks::TicksToMs(currentTicks);
-    uint32_t sysTimeSec = currentMillis / 1000UL;
-    // Convert to hours, minutes and seconds.
-    int hours = (sysTimeSec / 3600) % 24;
-    int minutes = (sysTimeSec / 60) % 60;
-    int seconds = sysTimeSec % 60;
-    // Print the timestamp.
-    SEGGER_RTT_printf(0, "[%02d:%02d:%02d] ", hours, minutes, seconds);
-    // Print the formatted string in a color based on the severity level.
-    SEGGER_RTT_WriteString(0, colorLevel[t_Level]);
-    SEGGER_RTT_vprintf(0, t_Fmt, t_ParamList);
-    // Add trailing new line.
-    SEGGER_RTT_WriteString(0, RTT_CTRL_RESET "\n");
+    // Start of a conversion specification?
+    if (t_Fmt[idx] == '%')
+    {
+      // Escaped percent sign?
+      if (t_Fmt[idx + 1U] == '%')
+      {
+        idx++;
+      }
+      else if (result < RttLogRecord::c_ArgCountMax)
+      {
+        result++;
+      }
+    }
   }
+  // Give the result back to the caller.
+  return result;
 }
 
 
@@ -39,14 +39,41 @@
 //***************************************************************************************
 // Include files
 //***************************************************************************************
+#include <array>
 #include "logger.hpp"
+#include "thread.hpp"
+#include "microtbx.h"
 
 
 //***************************************************************************************
 // Class definitions
 //***************************************************************************************
-/// \brief Segger RTT based event logger class.
-class RttLogger : public Logger
+/// \brief   Event log record class.
+/// \details Holds an event in its raw form: the format string, which serves as its
+///          identifier, the system time and the raw 32-bit arguments. Intentionally kept
+///          trivially copyable.
+class RttLogRecord
+{
+public:
+  // Constants.
+  static constexpr uint8_t c_ArgCountMax = 4U;
+  // Members.
+  const char * fmt;
+  uint32_t ticks;
+  uint8_t level;
+  std::array<uint32_t, c_ArgCountMax> args;
+};
+
+
+/// \brief   Segger RTT based event logger class.
+/// \details Info and warning events are not formatted in the caller's context. Instead
+///          their raw form is stored in a record pool, which is a cheap
+///          operation. A low priority task does the actual formatting and output. This
+///          means that these events only support up to four arguments, each one 32-bit
+///          in size, and that string arguments must have a static storage duration.
+///          Error events are still formatted and output right away, because they might
+///          be followed by a halt of the program.
+class RttLogger : public Logger, public cpp_freertos::Thread
 {
 public:
   // Constructors and destructor.
@@ -54,8 +81,18 @@ public:
   virtual ~RttLogger() { }
 
 private:
+  // Constants.
+  static constexpr uint8_t c_RecordPoolSize = 32U;
+  // Members.
+  std::array<RttLogRecord, c_RecordPoolSize + 1U> m_RecordPool{ };
+  volatile uint8_t m_RecordHead{0U};
+  volatile uint8_t m_RecordTail{0U};
+  volatile uint32_t m_RecordsDropped{0U};
   // Methods.
   void log(Level t_Level, const char t_Fmt[], va_list * t_ParamList) override;
+  void Run() override;
+  void output(RttLogRecord const& t_Record);
+  static uint8_t countArgs(const char t_Fmt[]);
 
   // Flag the class as non-copyable.
   RttLogger(const RttLogger&) = delete;
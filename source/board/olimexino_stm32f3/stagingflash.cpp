@@ -0,0 +1,314 @@
+///**************************************************************************************
+/// \file         stagingflash.cpp
+/// \brief        Staging flash driver source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include "stagingflash.hpp"
+#include "ticks.hpp"
+#include "stm32f3xx.h"
+
+
+//***************************************************************************************
+// External data declarations
+//***************************************************************************************
+// The start and end of the STAGING region are declared externally in the linker script.
+extern "C"
+{
+  extern uint8_t _sstaging[];
+  extern uint8_t _estaging[];
+}
+
+
+///**************************************************************************************
+/// \brief     Staging flash constructor.
+///
+///**************************************************************************************
+StagingFlash::StagingFlash()
+  : Storage(), m_Base(&_sstaging[0]),
+    m_Size(static_cast<size_t>(&_estaging[0] - &_sstaging[0]))
+{
+}
+
+
+///**************************************************************************************
+/// \brief     Erases the entire staging flash. Must be called from a task, because it
+///            yields the CPU for one tick after each erased page.
+/// \details   The CPU stalls for the duration of each page erase, so the stall cannot be
+///            made shorter than one page. Yielding in between bounds it to one page at
+///            a time, instead of the entire staging flash at once. This gives the other
+///            tasks and the pending interrupts a chance to catch up between the pages.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t StagingFlash::erase()
+{
+  uint8_t result = TBX_OK;
+  size_t offset = 0U;
+
+  // Erase the pages one at a time, until done or an error occurred.
+  while ((offset < m_Size) && (result == TBX_OK))
+  {
+    // Only erase the page if it is not yet blank.
+    if (pageBlank(offset) == TBX_FALSE)
+    {
+      // Unlock the flash controller, erase the page and lock the flash controller again.
+      // It stays locked while other tasks run.
+      unlock();
+      result = erasePage(offset);
+      lock();
+      // Let the other tasks run, before stalling the CPU with the next page erase.
+      vTaskDelay(1U);
+    }
+    // Continue with the next page.
+    offset += c_PageSize;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Writes data to the staging flash.
+/// \param     t_Offset Offset into the staging flash. Must be aligned to c_WriteAlign.
+/// \param     t_Data Byte array with the data to write.
+/// \param     t_Len Number of bytes to write.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t StagingFlash::write(size_t t_Offset, uint8_t const t_Data[], size_t t_Len)
+{
+  uint8_t result = TBX_ERROR;
+  size_t alignedLen = (t_Len + (c_WriteAlign - 1U)) & ~(c_WriteAlign - 1U);
+
+  // Only continue with an aligned offset and if the data fits.
+  if (((t_Offset % c_WriteAlign) == 0U) && (t_Offset <= m_Size) &&
+      (alignedLen <= (m_Size - t_Offset)))
+  {
+    size_t idx = 0U;
+
+    // Unlock the flash controller.
+    unlock();
+    result = TBX_OK;
+    // Program the data, one half-word at a time, until done or an error occurred. Pad
+    // the last partial unit with 0xFF bytes.
+    while ((idx < alignedLen) && (result == TBX_OK))
+    {
+      uint16_t lowByte = (idx < t_Len) ? t_Data[idx] : 0xFFU;
+      uint16_t highByte = ((idx + 1U) < t_Len) ? t_Data[idx + 1U] : 0xFFU;
+      uint16_t value = static_cast<uint16_t>(lowByte | (highByte << 8U));
+      // An erased half-word already holds this value.
+      if (value != c_ErasedHalfWord)
+      {
+        result = programHalfWord(t_Offset + idx, value);
+      }
+      // Continue with the next half-word.
+      idx += 2U;
+    }
+    // Lock the flash controller again.
+    lock();
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Reads data from the staging flash.
+/// \param     t_Offset Offset into the staging flash.
+/// \param     t_Data Byte array where the read data should be stored.
+/// \param     t_Len Number of bytes to read.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t StagingFlash::read(size_t t_Offset, uint8_t t_Data[], size_t t_Len) const
+{
+  uint8_t result = TBX_ERROR;
+
+  // Only continue if the data is inside the staging flash.
+  if ((t_Offset <= m_Size) && (t_Len <= (m_Size - t_Offset)))
+  {
+    // The flash memory is memory mapped, so just copy the data.
+    for (size_t idx = 0U; idx < t_Len; idx++)
+    {
+      t_Data[idx] = m_Base[t_Offset + idx];
+    }
+    result = TBX_OK;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Unlocks the flash controller, such that it accepts erase and program
+///            operations.
+///
+///**************************************************************************************
+void StagingFlash::unlock()
+{
+  // Only write the key sequence if the flash controller is actually locked. Writing it
+  // while unlocked, locks the flash controller until the next reset.
+  if (READ_BIT(FLASH->CR, FLASH_CR_LOCK) != 0U)
+  {
+    WRITE_REG(FLASH->KEYR, FLASH_KEY1);
+    WRITE_REG(FLASH->KEYR, FLASH_KEY2);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Locks the flash controller, such that it rejects erase and program
+///            operations.
+///
+///**************************************************************************************
+void StagingFlash::lock()
+{
+  SET_BIT(FLASH->CR, FLASH_CR_LOCK);
+}
+
+
+///**************************************************************************************
+/// \brief     Waits for the flash controller to complete the ongoing operation.
+/// \return    TBX_OK if the operation completed without errors, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t StagingFlash::waitReady()
+{
+  uint8_t result = TBX_OK;
+
+  // Wait for the flash controller to no longer be busy.
+  while (READ_BIT(FLASH->SR, FLASH_SR_BSY) != 0U)
+  {
+    ;
+  }
+  // Check for programming and write protection errors.
+  if (READ_BIT(FLASH->SR, FLASH_SR_PGERR | FLASH_SR_WRPERR) != 0U)
+  {
+    result = TBX_ERROR;
+  }
+  // Clear the status flags. These bits are cleared by writing a 1.
+  WRITE_REG(FLASH->SR, FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR);
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Determines if a page of the staging flash is blank.
+/// \param     t_Offset Offset of the page into the staging flash.
+/// \return    TBX_TRUE if all bytes of the page are erased, TBX_FALSE otherwise.
+///
+///**************************************************************************************
+uint8_t StagingFlash::pageBlank(size_t t_Offset) const
+{
+  uint8_t result = TBX_TRUE;
+  uint32_t const * pageWords = reinterpret_cast<uint32_t const *>(&m_Base[t_Offset]);
+  size_t idx = 0U;
+
+  // Check all words of the page, until a programmed one is found.
+  while ((idx < (c_PageSize / sizeof(uint32_t))) && (result == TBX_TRUE))
+  {
+    if (pageWords[idx] != 0xFFFFFFFFUL)
+    {
+      result = TBX_FALSE;
+    }
+    idx++;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Erases a page of the staging flash. The flash controller should already
+///            be unlocked.
+/// \param     t_Offset Offset of the page into the staging flash.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t StagingFlash::erasePage(size_t t_Offset)
+{
+  uint8_t result;
+
+  // Make sure no other operation is ongoing.
+  (void)waitReady();
+  // Start the page erase operation and wait for it to complete.
+  SET_BIT(FLASH->CR, FLASH_CR_PER);
+  WRITE_REG(FLASH->AR, reinterpret_cast<uint32_t>(&m_Base[t_Offset]));
+  SET_BIT(FLASH->CR, FLASH_CR_STRT);
+  result = waitReady();
+  CLEAR_BIT(FLASH->CR, FLASH_CR_PER);
+  // Verify that the page is now actually blank.
+  if ((result == TBX_OK) && (pageBlank(t_Offset) == TBX_FALSE))
+  {
+    result = TBX_ERROR;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Programs a half-word in the staging flash. The flash controller should
+///            already be unlocked.
+/// \param     t_Offset Offset of the half-word into the staging flash.
+/// \param     t_Value The value to program.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t StagingFlash::programHalfWord(size_t t_Offset, uint16_t t_Value)
+{
+  uint8_t result;
+  volatile uint16_t* halfWord = reinterpret_cast<volatile uint16_t*>(&m_Base[t_Offset]);
+
+  // Make sure no other operation is ongoing.
+  (void)waitReady();
+  // Start the program operation and wait for it to complete.
+  SET_BIT(FLASH->CR, FLASH_CR_PG);
+  *halfWord = t_Value;
+  result = waitReady();
+  CLEAR_BIT(FLASH->CR, FLASH_CR_PG);
+  // Verify that the half-word now actually holds the value.
+  if ((result == TBX_OK) && (*halfWord != t_Value))
+  {
+    result = TBX_ERROR;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+//********************************** end of stagingflash.cpp ****************************
@@ -0,0 +1,92 @@
+///**************************************************************************************
+/// \file         stagingflash.hpp
+/// \brief        Staging flash driver header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef STAGINGFLASH_HPP
+#define STAGINGFLASH_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include "storage.hpp"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Staging flash class.
+/// \details Implements the non-volatile storage in the STAGING region of the internal
+///          flash memory, as reserved by the linker script. The internal flash memory
+///          has just one bank. The CPU therefore stalls while the flash controller
+///          erases a page or programs a half-word, interrupts included. Erasing a page
+///          takes up to 40 milliseconds. Pages that are already blank are not erased
+///          again. Erasing the entire staging flash therefore takes seconds. Method
+///          erase yields between the pages, such that the stall lasts one page at a
+///          time. Still, the CAN and USB peripherals are not serviced during the
+///          stall, so frames can get lost while a page is being erased.
+class StagingFlash final : public Storage
+{
+public:
+  // Constructors and destructor.
+  explicit StagingFlash();
+  virtual ~StagingFlash() { }
+  // Methods.
+  uint8_t erase() override;
+  uint8_t write(size_t t_Offset, uint8_t const t_Data[], size_t t_Len) override;
+  uint8_t read(size_t t_Offset, uint8_t t_Data[], size_t t_Len) const override;
+  // Getters and setters.
+  size_t size() const override { return m_Size; }
+
+private:
+  // Constants.
+  static constexpr size_t c_PageSize = 2048U;
+  static constexpr uint16_t c_ErasedHalfWord = 0xFFFFU;
+  // Members.
+  uint8_t* m_Base;
+  size_t m_Size;
+  // Methods.
+  void unlock();
+  void lock();
+  uint8_t waitReady();
+  uint8_t pageBlank(size_t t_Offset) const;
+  uint8_t erasePage(size_t t_Offset);
+  uint8_t programHalfWord(size_t t_Offset, uint16_t t_Value);
+
+  // Flag the class as non-copyable.
+  StagingFlash(const StagingFlash&) = delete;
+  const StagingFlash& operator=(const StagingFlash&) = delete;
+};
+
+#endif // STAGINGFLASH_HPP
+//********************************** end of stagingflash.hpp ****************************
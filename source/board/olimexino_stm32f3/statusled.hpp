@@ -46,7 +46,7 @@
 // Class definitions
 //***************************************************************************************
 /// \brief Status LED class.
-class StatusLed : public Led
+class StatusLed final : public Led
 {
 public:
   // Constructors and destructor.
@@ -40,8 +40,13 @@
 #include "microtbx.h"
 #include "tinyusbdevice.hpp"
 #include "hardwareboard.hpp"
+#include "latencymonitor.hpp"
+#include "stm32f3xx.h"
 #include "stm32f3xx_ll_gpio.h"
 #include "stm32f3xx_ll_exti.h"
+#include "stm32f3xx_ll_rcc.h"
+#include "stm32f3xx_ll_tim.h"
+#include "device/usbd_pvt.h"
 
 
 //***************************************************************************************
@@ -57,17 +62,25 @@ TinyUsbDevice* TinyUsbDevice::s_InstancePtr = nullptr;
 
 ///**************************************************************************************
 /// \brief     TinyUSB device constructor. 
+/// \param     t_HardwareBoard Reference to the board that owns this device.
+/// \param     t_TxFlushDeadlineUs Maximum time in microseconds that transmit data can
+///            be held back, while waiting for more data to coalesce into the same bulk
+///            IN transfer. A value of 0 disables coalescing. Timer TIM7 enforces the
+///            deadline, so it can be up to c_TxFlushDeadlineUsMax.
 ///
 ///**************************************************************************************
-TinyUsbDevice::TinyUsbDevice(HardwareBoard& t_HardwareBoard)
+TinyUsbDevice::TinyUsbDevice(HardwareBoard& t_HardwareBoard, 
+                             uint32_t t_TxFlushDeadlineUs)
   : UsbDevice(),
     cpp_freertos::Thread("UsbDeviceThread", configMINIMAL_STACK_SIZE + 64, 6),
-    m_HardwareBoard(t_HardwareBoard)
+    m_HardwareBoard(t_HardwareBoard),
+    m_TxFlushDeadlineCycles(t_TxFlushDeadlineUs * (SystemCoreClock / 1000000UL))
 {
   LL_GPIO_InitTypeDef GPIO_InitStruct{ };
 
-  // Verify that only one instance of TinyUsbDevice is created.
+  // Verify that only one instance of TinyUsbDevice is created and the parameters.
   TBX_ASSERT(s_InstancePtr == nullptr);
+  TBX_ASSERT(t_TxFlushDeadlineUs <= c_TxFlushDeadlineUsMax);
   // Store a pointer to ourselves.
   s_InstancePtr = this;
 
@@ -86,6 +99,35 @@ TinyUsbDevice::TinyUsbDevice(HardwareBoard& t_HardwareBoard)
   LL_EXTI_EnableRisingTrig_0_31(LL_EXTI_LINE_18);
   LL_EXTI_EnableIT_0_31(LL_EXTI_LINE_18);
 
+  // Configure TIM7 as a one-shot timer that expires once the transmit flush deadline
+  // passed, counting in microseconds. Note that the timer clock is twice the APB1 clock,
+  // unless the APB1 prescaler is 1.
+  if (t_TxFlushDeadlineUs > 0U)
+  {
+    LL_TIM_InitTypeDef TIM_InitStruct{ };
+    LL_RCC_ClocksTypeDef rccClocks{ };
+    uint32_t timerClock;
+
+    LL_RCC_GetSystemClocksFreq(&rccClocks);
+    timerClock = rccClocks.PCLK1_Frequency;
+    if (LL_RCC_GetAPB1Prescaler() != LL_RCC_APB1_DIV_1)
+    {
+      timerClock *= 2U;
+    }
+    TIM_InitStruct.Prescaler = static_cast<uint16_t>((timerClock / 1000000UL) - 1U);
+    TIM_InitStruct.CounterMode = LL_TIM_COUNTERMODE_UP;
+    TIM_InitStruct.Autoreload = t_TxFlushDeadlineUs - 1U;
+    TIM_InitStruct.ClockDivision = LL_TIM_CLOCKDIVISION_DIV1;
+    LL_TIM_Init(TIM7, &TIM_InitStruct);
+    // Stop counting upon expiry and only interrupt upon expiry, not when LL_TIM_Init()
+    // generated the update event that loads the prescaler.
+    LL_TIM_SetOnePulseMode(TIM7, LL_TIM_ONEPULSEMODE_SINGLE);
+    LL_TIM_SetUpdateSource(TIM7, LL_TIM_UPDATESOURCE_COUNTER);
+    LL_TIM_ClearFlag_UPDATE(TIM7);
+    LL_TIM_EnableIT_UPDATE(TIM7);
+    NVIC_EnableIRQ(TIM7_IRQn);
+  }
+
   // Start the thread.
   Start();
 }
@@ -97,6 +139,10 @@ TinyUsbDevice::TinyUsbDevice(HardwareBoard& t_HardwareBoard)
 ///**************************************************************************************
 TinyUsbDevice::~TinyUsbDevice()
 {
+  // Stop the transmit flush deadline timer.
+  NVIC_DisableIRQ(TIM7_IRQn);
+  LL_TIM_DisableCounter(TIM7);
+
   // Disable EXTI Line for USB wakeup.
   LL_EXTI_DisableIT_0_31(LL_EXTI_LINE_18);
   LL_EXTI_ClearFlag_0_31(LL_EXTI_LINE_18);
@@ -112,6 +158,12 @@ TinyUsbDevice::~TinyUsbDevice()
 
 ///**************************************************************************************
 /// \brief     Submits data for transmission on the USB bulk endpoint.
+/// \details   The data is not necessarily sent right away. To reduce the number of short
+///            bulk IN transfers, consecutive data is coalesced in the transmit FIFO. The
+///            FIFO is flushed once it cannot hold another packet, or once the oldest
+///            data in it has been waiting for longer than the flush deadline. A one-shot
+///            timer, started when the first data enters the FIFO, enforces the
+///            deadline. The start of each USB frame serves as a fallback.
 /// \param     t_Data Byte array with data to transmit.
 /// \param     t_Len Number of bytes from the array to transmit.
 /// \return    TBX_OK if successful, TBX_ERROR otherwise.
@@ -127,17 +179,99 @@ uint8_t TinyUsbDevice::transmit(uint8_t const t_Data[], uint32_t t_Len)
   // Only continue with valid parameters.
   if ((t_Data != nullptr) && (t_Len > 0))
   {
-    // Store the data in the transmit FIFO.
-    if (tud_vendor_write(t_Data, t_Len) == t_Len)
+    // Store the data in the transmit FIFO. Only do so if all of it fits, to prevent
+    // a partially stored packet from corrupting the data stream.
+    if ((tud_vendor_write_available() >= t_Len) && 
+        (tud_vendor_write(t_Data, t_Len) == t_Len))
+    {
+      // Start the flush deadline, if this is the first data waiting in the FIFO. Note
+      // that this method is called from more than one task and that the TinyUSB device
+      // task clears the flag, when it flushes. The critical section makes sure the
+      // check and the arming of the deadline happen as one.
+      TbxCriticalSectionEnter();
+      if (m_TxFlushPending == TBX_FALSE)
+      {
+        m_TxPendingSinceCycles = DWT->CYCCNT;
+        m_TxFlushPending = TBX_TRUE;
+        startTxFlushTimer();
+      }
+      TbxCriticalSectionExit();
+      // Flush right away if coalescing is disabled, if the FIFO cannot hold another
+      // packet or if the flush deadline already expired.
+      if ((m_TxFlushDeadlineCycles == 0U) || 
+          (tud_vendor_write_available() < c_TxPacketLenMax) ||
+          (txFlushDeadlineExpired() == TBX_TRUE))
+      {
+        flushTx();
+      }
+      // Update the result.
+      result = TBX_OK;
+    }
+    // Keep track of the number of transmitted and dropped packets. Note that this
+    // method is called from more than one task.
+    TbxCriticalSectionEnter();
+    if (result == TBX_OK)
+    {
+      m_TxPacketCount++;
+    }
+    else
+    {
+      m_TxDropCount++;
+    }
+    TbxCriticalSectionExit();
+  }
+  /* Give the result back to the caller. */
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Submits data for transmission on the USB bulk endpoint, from interrupt
+///            context.
+/// \details   TinyUSB's transmit FIFO cannot be accessed from interrupt context. The data
+///            is therefore stored in a small pool and its actual transmission is deferred
+///            to the TinyUSB device task. This is done by queueing a function call in
+///            TinyUSB's own event queue, so without the need for an extra task.
+/// \attention Only call this method from interrupt context and only from interrupts
+///            that run on the same priority, because the pool supports just one
+///            producer.
+/// \param     t_Data Byte array with data to transmit.
+/// \param     t_Len Number of bytes from the array to transmit. Can be up to 
+///            TinyUsbTxPacket::c_DataLenMax.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t TinyUsbDevice::transmitFromISR(uint8_t const t_Data[], uint32_t t_Len)
+{
+  uint8_t result = TBX_ERROR;
+
+  // Verify the parameters.
+  TBX_ASSERT((t_Data != nullptr) && (t_Len > 0) && 
+             (t_Len <= TinyUsbTxPacket::c_DataLenMax));
+
+  // Only continue with valid parameters.
+  if ((t_Data != nullptr) && (t_Len > 0) && (t_Len <= TinyUsbTxPacket::c_DataLenMax))
+  {
+    uint8_t nextHead = (m_IsrTxHead + 1U) % m_IsrTxPool.size();
+    // Only continue if the pool is not yet full. Note that one slot always stays
+    // unused, such that a full pool can be distinguished from an empty one.
+    if (nextHead != m_IsrTxTail)
     {
-      // Request transmission start of the data currently stored in the transmit
-      // FIFO. No need to check the return value, because worst case the endpoint
-      // is already busy with a transfer. That's okay, because the data was already
-      // successfully stored in the transmit FIFO, meaning that it will go out
-      // eventually, since TinyUSB checks at the end of an endpoint transfer if data
-      // is still left in the transmit FIFO. If so, it automatically starts the next
-      // endpoint transfer.
-      (void)tud_vendor_flush();
+      // Store the data in the pool.
+      TinyUsbTxPacket& txPacket = m_IsrTxPool[m_IsrTxHead];
+      txPacket.len = static_cast<uint8_t>(t_Len);
+      for (uint8_t idx = 0U; idx < txPacket.len; idx++)
+      {
+        txPacket.data[idx] = t_Data[idx];
+      }
+      // Hand the packet over to the task.
+      m_IsrTxHead = nextHead;
+      // Defer the actual transmission to the task, unless already done so.
+      if (m_IsrTxDeferred == TBX_FALSE)
+      {
+        m_IsrTxDeferred = TBX_TRUE;
+        usbd_defer_func(&TinyUsbDevice::deferredIsrTx, this, true);
+      }
       // Update the result.
       result = TBX_OK;
     }
@@ -147,6 +281,155 @@ uint8_t TinyUsbDevice::transmit(uint8_t const t_Data[], uint32_t t_Len)
 }
 
 
+///**************************************************************************************
+/// \brief     Transmits all the packets that were submitted from interrupt context.
+/// \attention Only call this method from the TinyUSB device task.
+///
+///**************************************************************************************
+void TinyUsbDevice::processIsrTx()
+{
+  // Allow the interrupts to defer the transmission again. Done before emptying the
+  // pool, such that a packet added during this loop is never left behind.
+  m_IsrTxDeferred = TBX_FALSE;
+  // Transmit all the packets that are waiting in the pool.
+  while (m_IsrTxTail != m_IsrTxHead)
+  {
+    TinyUsbTxPacket const& txPacket = m_IsrTxPool[m_IsrTxTail];
+    // Submit the packet for transmission. No need to check the return value. Worst
+    // case the transmit FIFO is full. The packet is then lost, just like when the
+    // data was submitted with transmit() directly.
+    (void)transmit(txPacket.data.data(), txPacket.len);
+    // Make sure all accesses to the packet slot completed, before releasing it back to
+    // the interrupts.
+    __DMB();
+    m_IsrTxTail = (m_IsrTxTail + 1U) % m_IsrTxPool.size();
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Deferred function that TinyUSB calls from its device task, after
+///            transmitFromISR() queued it.
+/// \param     t_Param Pointer to the TinyUsbDevice instance.
+///
+///**************************************************************************************
+void TinyUsbDevice::deferredIsrTx(void* t_Param)
+{
+  // Verify the parameter.
+  TBX_ASSERT(t_Param != nullptr);
+
+  // Only continue with a valid parameter.
+  if (t_Param != nullptr)
+  {
+    // Call the instance's method for processing the packets.
+    static_cast<TinyUsbDevice*>(t_Param)->processIsrTx();
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Timestamps the reception of new data on an OUT endpoint. Only the first
+///            reception since the device task last picked up the timestamp is kept, such
+///            that the oldest data determines the latency.
+/// \attention Only call this method upon entry of the USB interrupts.
+///
+///**************************************************************************************
+void TinyUsbDevice::stampRxFromISR()
+{
+  uint16_t istr = READ_REG(USB->ISTR);
+
+  // Did an OUT transaction complete and is no timestamp pending yet?
+  if (((istr & USB_ISTR_CTR) != 0U) && ((istr & USB_ISTR_DIR) != 0U) && 
+      (m_RxCyclesValid == TBX_FALSE))
+  {
+    m_RxCycles = LatencyMonitor::now();
+    m_RxCyclesValid = TBX_TRUE;
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Requests transmission start of the data currently stored in the transmit
+///            FIFO.
+///
+///**************************************************************************************
+void TinyUsbDevice::flushTx()
+{
+  // Reset the flush deadline. Stopping its timer is not strictly needed, because the
+  // deferred flush checks if data is still pending. It just saves an interrupt. The
+  // critical section prevents another task from arming the deadline in between, which
+  // would leave its data pending without a running timer.
+  TbxCriticalSectionEnter();
+  m_TxFlushPending = TBX_FALSE;
+  LL_TIM_DisableCounter(TIM7);
+  TbxCriticalSectionExit();
+  // No need to check the return value, because worst case the endpoint is already busy
+  // with a transfer. That's okay, because the data was already successfully stored in
+  // the transmit FIFO, meaning that it will go out eventually, since TinyUSB checks at
+  // the end of an endpoint transfer if data is still left in the transmit FIFO. If so,
+  // it automatically starts the next endpoint transfer.
+  (void)tud_vendor_flush();
+}
+
+
+///**************************************************************************************
+/// \brief     Starts the one-shot timer that expires once the flush deadline passed. Its
+///            interrupt then defers the flush to the TinyUSB device task.
+///
+///**************************************************************************************
+void TinyUsbDevice::startTxFlushTimer()
+{
+  // Only start the timer if coalescing is enabled.
+  if (m_TxFlushDeadlineCycles != 0U)
+  {
+    LL_TIM_SetCounter(TIM7, 0U);
+    LL_TIM_EnableCounter(TIM7);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Deferred function that TinyUSB calls from its device task, after the
+///            transmit flush deadline timer expired.
+/// \param     t_Param Pointer to the TinyUsbDevice instance.
+///
+///**************************************************************************************
+void TinyUsbDevice::deferredTxFlush(void* t_Param)
+{
+  // Verify the parameter.
+  TBX_ASSERT(t_Param != nullptr);
+
+  // Only continue with a valid parameter.
+  if (t_Param != nullptr)
+  {
+    // Call the instance's method for processing the callback.
+    static_cast<TinyUsbDevice*>(t_Param)->processCallback(TXFLUSHDEADLINE);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Determines if the data waiting in the transmit FIFO has been held back for
+///            longer than the flush deadline.
+/// \return    TBX_TRUE if the flush deadline expired, TBX_FALSE otherwise.
+///
+///**************************************************************************************
+uint8_t TinyUsbDevice::txFlushDeadlineExpired() const
+{
+  uint8_t result = TBX_FALSE;
+
+  // Only check the deadline if data is actually waiting. Note that the unsigned
+  // subtraction properly handles an overflow of the cycle counter.
+  if ((m_TxFlushPending == TBX_TRUE) &&
+      ((DWT->CYCCNT - m_TxPendingSinceCycles) >= m_TxFlushDeadlineCycles))
+  {
+    result = TBX_TRUE;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
 ///**************************************************************************************
 /// \brief     Runs the TinyUSB device task.
 ///
@@ -161,6 +444,9 @@ void TinyUsbDevice::Run()
   // after the kernel is started. This is because it enables the USB interrupts and 
   // these use FreeRTOS API calls.
   tud_init(BOARD_TUD_RHPORT);
+  // Enable the start of frame callback, which backs up the transmit flush deadline timer
+  // and picks up packets submitted from interrupt context that are still waiting.
+  (void)tud_sof_cb_enable(true);
 
   // Enter the task body, which should be an infinite loop.
   for (;;)
@@ -191,7 +477,17 @@ void TinyUsbDevice::processCallback(CallbackId t_CallbackId)
       // Only trigger the event handler if it was assigned and the data size is not zero.
       if ((onDataReceived) && (rxCount > 0))
       {
-        onDataReceived(m_RxBuf.data(), rxCount);
+        // Pass the reception timestamp along with the data. Fall back to the current
+        // time in the unlikely case that the interrupt did not catch it.
+        uint32_t rxCycles = LatencyMonitor::now();
+        TbxCriticalSectionEnter();
+        if (m_RxCyclesValid == TBX_TRUE)
+        {
+          rxCycles = m_RxCycles;
+          m_RxCyclesValid = TBX_FALSE;
+        }
+        TbxCriticalSectionExit();
+        onDataReceived(m_RxBuf.data(), rxCount, rxCycles);
       }
     }
     break;
@@ -218,6 +514,35 @@ void TinyUsbDevice::processCallback(CallbackId t_CallbackId)
     }
     break;
 
+    case STARTOFFRAME:
+    {
+      // Transmit packets that were submitted from interrupt context, if any. Normally
+      // the deferred function call already took care of this. This just covers the
+      // unlikely case that TinyUSB's event queue was full at the time.
+      if (m_IsrTxTail != m_IsrTxHead)
+      {
+        processIsrTx();
+      }
+      // Flush the transmit FIFO if its data has been held back for long enough. The
+      // deadline timer normally already took care of this. This just covers the
+      // unlikely case that TinyUSB's event queue was full at the time.
+      if (txFlushDeadlineExpired() == TBX_TRUE)
+      {
+        flushTx();
+      }
+    }
+    break;
+
+    case TXFLUSHDEADLINE:
+    {
+      // Flush the transmit FIFO, unless that already happened in the meantime.
+      if (m_TxFlushPending == TBX_TRUE)
+      {
+        flushTx();
+      }
+    }
+    break;
+
     default:
     {
       // Not a valid callback ID.
@@ -290,6 +615,56 @@ void tud_resume_cb(void)
 }
 
 
+///**************************************************************************************
+/// \brief     TinyUSB device callback function that gets called upon reception of the
+///            start of frame (SOF) token, which the host sends every millisecond.
+/// \param     frame_count The current frame number.
+///
+///**************************************************************************************
+void tud_sof_cb(uint32_t frame_count)
+{
+  TBX_UNUSED_ARG(frame_count);
+
+  // Only continue if an instance of TinyUsbDevice was actually created.
+  if (TinyUsbDevice::s_InstancePtr != nullptr)
+  {
+    // Call the instance's method for processing the callback.
+    TinyUsbDevice::s_InstancePtr->processCallback(TinyUsbDevice::STARTOFFRAME);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Obtains a snapshot of the board's statistics counters, for handing it to
+///            the host as the response of a vendor control request.
+/// \attention Only call this function from the TinyUSB device task.
+/// \param     t_Data Pointer to where the address of the snapshot is stored. The snapshot
+///            remains valid until the next call of this function.
+/// \return    Size of the snapshot in bytes or 0 if not available.
+///
+///**************************************************************************************
+uint16_t TinyUsbDeviceStatisticsGet(uint8_t const ** t_Data)
+{
+  static HardwareBoardStatistics statistics;
+  uint16_t result = 0U;
+
+  // Verify the parameter.
+  TBX_ASSERT(t_Data != nullptr);
+
+  // Only continue with a valid parameter and if an instance of TinyUsbDevice was
+  // actually created.
+  if ((t_Data != nullptr) && (TinyUsbDevice::s_InstancePtr != nullptr))
+  {
+    // Take the snapshot.
+    TinyUsbDevice::s_InstancePtr->m_HardwareBoard.statistics(statistics);
+    *t_Data = reinterpret_cast<uint8_t const *>(&statistics);
+    result = sizeof(statistics);
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
 //***************************************************************************************
 //           I N T E R R U P T   S E R V I C E   R O U T I N E S
 //***************************************************************************************
@@ -299,6 +674,11 @@ void tud_resume_cb(void)
 ///**************************************************************************************
 void USB_HP_IRQHandler(void)
 {
+  // Timestamp the reception of new data, if any, for latency monitoring.
+  if (TinyUsbDevice::s_InstancePtr != nullptr)
+  {
+    TinyUsbDevice::s_InstancePtr->stampRxFromISR();
+  }
   // Pass the event on to the TinyUSB device stack on the configured roothub port.
   tud_int_handler(BOARD_TUD_RHPORT);
 }
@@ -310,11 +690,37 @@ void USB_HP_IRQHandler(void)
 ///**************************************************************************************
 void USB_LP_IRQHandler(void)
 {
+  // Timestamp the reception of new data, if any, for latency monitoring.
+  if (TinyUsbDevice::s_InstancePtr != nullptr)
+  {
+    TinyUsbDevice::s_InstancePtr->stampRxFromISR();
+  }
   // Pass the event on to the TinyUSB device stack on the configured roothub port.
   tud_int_handler(BOARD_TUD_RHPORT);
 }
 
 
+///**************************************************************************************
+/// \brief     This function handles the TIM7 global interrupt. The timer expires once
+///            the USB transmit flush deadline passed.
+///
+///**************************************************************************************
+void TIM7_IRQHandler(void)
+{
+  // Clear the update interrupt flag.
+  LL_TIM_ClearFlag_UPDATE(TIM7);
+
+  // Only continue if an instance of TinyUsbDevice was actually created.
+  if (TinyUsbDevice::s_InstancePtr != nullptr)
+  {
+    // Defer the flush to the TinyUSB device task, because TinyUSB's transmit FIFO
+    // cannot be accessed from interrupt context.
+    usbd_defer_func(&TinyUsbDevice::deferredTxFlush, TinyUsbDevice::s_InstancePtr,
+                    true);
+  }
+}
+
+
 ///**************************************************************************************
 /// \brief     This function handles USB wake-up interrupt through EXTI line 18.
 ///
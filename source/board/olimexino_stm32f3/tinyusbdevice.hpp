@@ -39,8 +39,10 @@
 //***************************************************************************************
 // Include files
 //***************************************************************************************
+#include <array>
 #include "usbdevice.hpp"
 #include "thread.hpp"
+#include "microtbx.h"
 #include "tusb.h"
 
 
@@ -48,6 +50,10 @@
 // Function prototypes
 //***************************************************************************************
 extern "C" void USBWakeUp_RMP_IRQHandler(void);
+extern "C" void TIM7_IRQHandler(void);
+extern "C" void USB_HP_IRQHandler(void);
+extern "C" void USB_LP_IRQHandler(void);
+extern "C" uint16_t TinyUsbDeviceStatisticsGet(uint8_t const ** t_Data);
 
 
 //***************************************************************************************
@@ -59,15 +65,34 @@ class HardwareBoard;
 //***************************************************************************************
 // Class definitions
 //***************************************************************************************
+/// \brief   TinyUSB device transmit packet class.
+/// \details Storage for a packet that was submitted for transmission from interrupt
+///          context. Intentionally kept trivially copyable.
+class TinyUsbTxPacket
+{
+public:
+  // Constants.
+  static constexpr uint8_t c_DataLenMax = 9U;
+  // Members.
+  uint8_t len;
+  std::array<uint8_t, c_DataLenMax> data;
+};
+
+
 /// \brief TinyUSB device class.
-class TinyUsbDevice : public UsbDevice, public cpp_freertos::Thread
+class TinyUsbDevice final : public UsbDevice, public cpp_freertos::Thread
 {
 public:
   // Constructors and destructor.
-  explicit TinyUsbDevice(HardwareBoard& t_HardwareBoard);
+  explicit TinyUsbDevice(HardwareBoard& t_HardwareBoard, 
+                         uint32_t t_TxFlushDeadlineUs = 250U);
   virtual ~TinyUsbDevice();
   // Methods.
   uint8_t transmit(uint8_t const t_Data[], uint32_t t_Len) override;
+  uint8_t transmitFromISR(uint8_t const t_Data[], uint32_t t_Len) override;
+  // Getters and setters.
+  uint32_t txPacketCount() const { return m_TxPacketCount; }
+  uint32_t txDropCount() const { return m_TxDropCount; }
 
 private:
   // Enumerations.
@@ -75,20 +100,49 @@ private:
   {
     RXNEWDATA,
     SUSPEND,
-    RESUME
+    RESUME,
+    STARTOFFRAME,
+    TXFLUSHDEADLINE
   };
+  // Constants.
+  static constexpr uint32_t c_TxPacketLenMax = 9U;
+  static constexpr uint8_t c_IsrTxPoolSize = 8U;
+  static constexpr uint32_t c_TxFlushDeadlineUsMax = 65536U;
   // Members.
   static TinyUsbDevice* s_InstancePtr;
   HardwareBoard& m_HardwareBoard;
   std::array<uint8_t, CFG_TUD_VENDOR_RX_BUFSIZE> m_RxBuf;
+  uint32_t m_TxFlushDeadlineCycles;
+  volatile uint8_t m_TxFlushPending{TBX_FALSE};
+  volatile uint32_t m_TxPendingSinceCycles{0U};
+  std::array<TinyUsbTxPacket, c_IsrTxPoolSize + 1U> m_IsrTxPool{ };
+  volatile uint8_t m_IsrTxHead{0U};
+  volatile uint8_t m_IsrTxTail{0U};
+  volatile uint8_t m_IsrTxDeferred{TBX_FALSE};
+  volatile uint32_t m_RxCycles{0U};
+  volatile uint8_t m_RxCyclesValid{TBX_FALSE};
+  uint32_t m_TxPacketCount{0U};
+  uint32_t m_TxDropCount{0U};
   // Methods.
   void Run() override;
   void processCallback(CallbackId t_CallbackId);
+  void flushTx();
+  void startTxFlushTimer();
+  uint8_t txFlushDeadlineExpired() const;
+  void processIsrTx();
+  void stampRxFromISR();
+  static void deferredIsrTx(void* t_Param);
+  static void deferredTxFlush(void* t_Param);
   // Friends.
   friend void tud_vendor_rx_cb(uint8_t itf);
   friend void tud_suspend_cb(bool remote_wakeup_en);
   friend void tud_resume_cb(void);
+  friend void tud_sof_cb(uint32_t frame_count);
   friend void USBWakeUp_RMP_IRQHandler(void);
+  friend void TIM7_IRQHandler(void);
+  friend void USB_HP_IRQHandler(void);
+  friend void USB_LP_IRQHandler(void);
+  friend uint16_t TinyUsbDeviceStatisticsGet(uint8_t const ** t_Data);
 
   // Flag the class as non-copyable.
   TinyUsbDevice(const TinyUsbDevice&) = delete;
@@ -234,6 +234,11 @@ uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
 #define MS_OS_20_DESC_LEN         0x9E
 
 #define VENDOR_REQUEST_MICROSOFT  1
+#define VENDOR_REQUEST_STATISTICS 2
+
+// Obtains a snapshot of the board's statistics counters. Implemented in
+// tinyusbdevice.cpp.
+uint16_t TinyUsbDeviceStatisticsGet(uint8_t const ** t_Data);
 
 // BOS Descriptor is required for MS OS 2.0.
 uint8_t const desc_bos[] =
@@ -298,6 +303,21 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_requ
             return false;
           }
 
+        case VENDOR_REQUEST_STATISTICS:
+          if ( request->bmRequestType_bit.direction == TUSB_DIR_IN )
+          {
+            // Get the snapshot of the board's statistics counters. Handled on the
+            // control endpoint, so it does not disturb the bulk data transfers.
+            uint8_t const * stats_data;
+            uint16_t stats_len = TinyUsbDeviceStatisticsGet(&stats_data);
+
+            if ( stats_len == 0 ) return false;
+            return tud_control_xfer(rhport, request, (void*)(uintptr_t) stats_data, stats_len);
+          }else
+          {
+            return false;
+          }
+
         default:
          break;
       }
@@ -0,0 +1,81 @@
+///**************************************************************************************
+/// \file         userbutton.cpp
+/// \brief        User push button driver source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include "userbutton.hpp"
+#include "stm32f3xx_ll_gpio.h"
+
+
+///**************************************************************************************
+/// \brief     User push button constructor.
+///
+///**************************************************************************************
+UserButton::UserButton()
+  : Button()
+{
+  LL_GPIO_InitTypeDef GPIO_InitStruct{ };
+
+  // Configure GPIO pin PC9 as a digital input. The BUT push button on the
+  // Olimexino-STM32F3 pulls it high when pressed, so enable the pull-down resistor.
+  GPIO_InitStruct.Pin = LL_GPIO_PIN_9;
+  GPIO_InitStruct.Mode = LL_GPIO_MODE_INPUT;
+  GPIO_InitStruct.Pull = LL_GPIO_PULL_DOWN;
+  LL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+}
+
+
+///**************************************************************************************
+/// \brief     Obtains the state of the push button. Note that the state is not
+///            debounced.
+/// \return    TBX_TRUE if the push button is pressed, TBX_FALSE otherwise.
+///
+///**************************************************************************************
+uint8_t UserButton::pressed()
+{
+  uint8_t result = TBX_FALSE;
+
+  // Is the push button pressed?
+  if (LL_GPIO_IsInputPinSet(GPIOC, LL_GPIO_PIN_9) != 0U)
+  {
+    result = TBX_TRUE;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+//********************************** end of userbutton.cpp ******************************
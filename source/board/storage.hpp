@@ -0,0 +1,79 @@
+///**************************************************************************************
+/// \file         storage.hpp
+/// \brief        Non-volatile storage driver header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef STORAGE_HPP
+#define STORAGE_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstddef>
+#include "microtbx.h"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Abstract non-volatile storage driver class.
+/// \details Holds data that should survive a reset, such as a staged firmware image for
+///          a target. Write data only to erased storage and only once. Each write
+///          starts at an offset aligned to c_WriteAlign bytes. The last partial unit of
+///          a write is padded with 0xFF bytes.
+class Storage
+{
+public:
+  // Constants.
+  static constexpr size_t c_WriteAlign = 4U;
+  // Destructor.
+  virtual ~Storage() { }
+  // Methods.
+  virtual uint8_t erase() = 0;
+  virtual uint8_t write(size_t t_Offset, uint8_t const t_Data[], size_t t_Len) = 0;
+  virtual uint8_t read(size_t t_Offset, uint8_t t_Data[], size_t t_Len) const = 0;
+  // Getters and setters.
+  virtual size_t size() const = 0;
+
+protected:
+  // Flag the class as abstract.
+  explicit Storage() { }
+
+private:
+  // Flag the class as non-copyable.
+  Storage(const Storage&) = delete;
+  const Storage& operator=(const Storage&) = delete;
+};
+
+#endif // STORAGE_HPP
+//********************************** end of storage.hpp *********************************
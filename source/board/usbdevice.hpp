@@ -47,6 +47,10 @@
 // Class definitions
 //***************************************************************************************
 /// \brief   Abstract USB device driver class.
+/// \details Method transmitFromISR() is the interrupt safe variant of transmit(). It 
+///          should only be called from interrupt context. Its maximum data length is
+///          implementation specific. The onDataReceived event handler also gets the
+///          timestamp of the data's reception, in the time base of latencyRecorder().
 class UsbDevice
 {
 public:
@@ -54,8 +58,10 @@ public:
   virtual ~UsbDevice() { }
   // Methods.
   virtual uint8_t transmit(uint8_t const t_Data[], uint32_t t_Len) = 0;  
+  virtual uint8_t transmitFromISR(uint8_t const t_Data[], uint32_t t_Len) = 0;
   // Events.
-  std::function<void(uint8_t const t_Data[], uint32_t t_Len)> onDataReceived;
+  std::function<void(uint8_t const t_Data[], uint32_t t_Len,
+                     uint32_t t_Timestamp)> onDataReceived;
   std::function<void()> onSuspend;
   std::function<void()> onResume;
 
@@ -0,0 +1,239 @@
+///**************************************************************************************
+/// \file         decompressor.cpp
+/// \brief        Streaming decompressor source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include "decompressor.hpp"
+
+
+///**************************************************************************************
+/// \brief     Resets the decompressor, such that it is ready for a new compressed
+///            stream.
+///
+///**************************************************************************************
+void Decompressor::reset()
+{
+  // The compressor assumes a window that initially holds all zeros.
+  m_Window.fill(0U);
+  m_WindowHead = 0U;
+  // Discard the fed data, including the unused bits of its last byte.
+  m_InputPtr = nullptr;
+  m_InputLen = 0U;
+  m_InputMask = 0U;
+  // A stream starts with the tag bit of its first literal byte or back-reference.
+  startField(TAGBIT, 1U);
+}
+
+
+///**************************************************************************************
+/// \brief     Feeds compressed data to the decompressor. The data must remain valid,
+///            until poll() returned zero.
+/// \param     t_Data Byte array with the compressed data.
+/// \param     t_Len Number of bytes of compressed data.
+///
+///**************************************************************************************
+void Decompressor::feed(uint8_t const t_Data[], size_t t_Len)
+{
+  // Verify parameters.
+  TBX_ASSERT(t_Data != nullptr);
+
+  // Only continue with valid parameters.
+  if (t_Data != nullptr)
+  {
+    m_InputPtr = t_Data;
+    m_InputLen = t_Len;
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Decompresses the fed data, until the output buffer is full or the fed
+///            data is used up. Note that the decompressor keeps the state of a
+///            partially read literal byte or back-reference, so the next fed data just
+///            continues the stream.
+/// \param     t_Out Byte array where the decompressed data should be stored.
+/// \param     t_OutMax Size of the output byte array.
+/// \return    Number of decompressed bytes stored in the output byte array. Zero if the
+///            fed data is used up.
+///
+///**************************************************************************************
+size_t Decompressor::poll(uint8_t t_Out[], size_t t_OutMax)
+{
+  size_t outLen = 0U;
+  uint8_t progress = TBX_TRUE;
+
+  // Verify parameters.
+  TBX_ASSERT(t_Out != nullptr);
+
+  // Decompress until the output buffer is full or the fed data is used up.
+  while ((outLen < t_OutMax) && (progress == TBX_TRUE))
+  {
+    // Copying the bytes of a back-reference from the window?
+    if (m_State == BACKREF)
+    {
+      emit(m_Window[(m_WindowHead - m_BackrefIndex) & (c_WindowSize - 1U)], t_Out,
+           outLen);
+      m_BackrefCount--;
+      if (m_BackrefCount == 0U)
+      {
+        startField(TAGBIT, 1U);
+      }
+    }
+    // Fed data used up, before the field of the current state was complete?
+    else if (readField() != TBX_TRUE)
+    {
+      progress = TBX_FALSE;
+    }
+    // Process the complete field.
+    else
+    {
+      switch (m_State)
+      {
+        case TAGBIT:
+        {
+          // A set tag bit announces a literal byte, otherwise a back-reference.
+          if (m_Field != 0U)
+          {
+            startField(LITERAL, 8U);
+          }
+          else
+          {
+            startField(INDEX, c_WindowBits);
+          }
+        }
+        break;
+
+        case LITERAL:
+        {
+          emit(static_cast<uint8_t>(m_Field), t_Out, outLen);
+          startField(TAGBIT, 1U);
+        }
+        break;
+
+        case INDEX:
+        {
+          // Both the distance and the number of bytes are stored minus one.
+          m_BackrefIndex = static_cast<uint16_t>(m_Field + 1U);
+          startField(COUNT, c_LookaheadBits);
+        }
+        break;
+
+        case COUNT:
+        {
+          m_BackrefCount = static_cast<uint16_t>(m_Field + 1U);
+          m_State = BACKREF;
+        }
+        break;
+
+        default:
+        {
+          // Already handled before reading a field.
+        }
+        break;
+      }
+    }
+  }
+  // Give the result back to the caller.
+  return outLen;
+}
+
+
+///**************************************************************************************
+/// \brief     Reads the remaining bits of the current field from the fed data, most
+///            significant bit first.
+/// \return    TBX_TRUE if the field is complete, TBX_FALSE if the fed data was used up
+///            before that.
+///
+///**************************************************************************************
+uint8_t Decompressor::readField()
+{
+  // Read the bits, one at a time, until the field is complete or the fed data is used
+  // up.
+  while ((m_FieldBitsLeft > 0U) && ((m_InputMask != 0U) || (m_InputLen > 0U)))
+  {
+    // Load the next byte of the fed data, once all bits of the current one are used.
+    if (m_InputMask == 0U)
+    {
+      m_InputByte = *m_InputPtr;
+      m_InputPtr++;
+      m_InputLen--;
+      m_InputMask = 0x80U;
+    }
+    // Shift the bit into the field.
+    m_Field = static_cast<uint16_t>(m_Field << 1U);
+    if ((m_InputByte & m_InputMask) != 0U)
+    {
+      m_Field |= 1U;
+    }
+    m_InputMask >>= 1U;
+    m_FieldBitsLeft--;
+  }
+  // Give the result back to the caller.
+  return (m_FieldBitsLeft == 0U) ? TBX_TRUE : TBX_FALSE;
+}
+
+
+///**************************************************************************************
+/// \brief     Switches to a new state, which starts with reading a field.
+/// \param     t_State The new state.
+/// \param     t_Bits Number of bits of the field.
+///
+///**************************************************************************************
+void Decompressor::startField(State t_State, uint8_t t_Bits)
+{
+  m_State = t_State;
+  m_Field = 0U;
+  m_FieldBitsLeft = t_Bits;
+}
+
+
+///**************************************************************************************
+/// \brief     Outputs a decompressed byte and adds it to the window.
+/// \param     t_Value The decompressed byte.
+/// \param     t_Out Byte array where the decompressed data should be stored.
+/// \param     t_OutLen Number of bytes already stored in the output byte array. It is
+///            incremented by this method.
+///
+///**************************************************************************************
+void Decompressor::emit(uint8_t t_Value, uint8_t t_Out[], size_t& t_OutLen)
+{
+  t_Out[t_OutLen] = t_Value;
+  t_OutLen++;
+  m_Window[m_WindowHead] = t_Value;
+  m_WindowHead = (m_WindowHead + 1U) & (c_WindowSize - 1U);
+}
+
+//********************************** end of decompressor.cpp ****************************
@@ -0,0 +1,107 @@
+///**************************************************************************************
+/// \file         decompressor.hpp
+/// \brief        Streaming decompressor header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef DECOMPRESSOR_HPP
+#define DECOMPRESSOR_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include <array>
+#include "microtbx.h"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Streaming decompressor class.
+/// \details Decompresses a heatshrink compressed stream incrementally, such that neither
+///          the compressed nor the decompressed data needs to be present in RAM as a
+///          whole. The stream should be compressed with a window size of
+///          c_WindowBits and a lookahead size of c_LookaheadBits, for example with
+///          "heatshrink -e -w 10 -l 4". Feed the compressed data with feed() and
+///          collect the decompressed data with poll(), until it returns zero. The
+///          decompressor then needs more compressed data.
+class Decompressor
+{
+public:
+  // Constants.
+  static constexpr uint8_t c_WindowBits = 10U;
+  static constexpr uint8_t c_LookaheadBits = 4U;
+  // Constructors and destructor.
+  explicit Decompressor() { }
+  virtual ~Decompressor() { }
+  // Methods.
+  void reset();
+  void feed(uint8_t const t_Data[], size_t t_Len);
+  size_t poll(uint8_t t_Out[], size_t t_OutMax);
+
+private:
+  // Enumerations.
+  enum State : uint8_t
+  {
+    TAGBIT,  ///< Reading the bit that tells a literal byte from a back-reference.
+    LITERAL, ///< Reading a literal byte.
+    INDEX,   ///< Reading the back-reference's distance into the window.
+    COUNT,   ///< Reading the back-reference's number of bytes.
+    BACKREF  ///< Copying the back-reference's bytes from the window.
+  };
+  // Constants.
+  static constexpr size_t c_WindowSize = 1U << c_WindowBits;
+  // Members.
+  std::array<uint8_t, c_WindowSize> m_Window{ };
+  size_t m_WindowHead{0U};
+  uint8_t const * m_InputPtr{nullptr};
+  size_t m_InputLen{0U};
+  uint8_t m_InputByte{0U};
+  uint8_t m_InputMask{0U};
+  State m_State{TAGBIT};
+  uint16_t m_Field{0U};
+  uint8_t m_FieldBitsLeft{1U};
+  uint16_t m_BackrefIndex{0U};
+  uint16_t m_BackrefCount{0U};
+  // Methods.
+  uint8_t readField();
+  void startField(State t_State, uint8_t t_Bits);
+  void emit(uint8_t t_Value, uint8_t t_Out[], size_t& t_OutLen);
+
+  // Flag the class as non-copyable.
+  Decompressor(const Decompressor&) = delete;
+  const Decompressor& operator=(const Decompressor&) = delete; 
+};
+
+#endif // DECOMPRESSOR_HPP
+//********************************** end of decompressor.hpp ****************************
@@ -40,6 +40,7 @@
 #include <array>
 #include "gateway.hpp"
 #include "logger.hpp"
+#include "latencyrecorder.hpp"
 
 
 ///**************************************************************************************
@@ -47,6 +48,7 @@
 /// \param     t_UsbDevice Reference to the USB device instance.
 /// \param     t_Can Reference to the CAN driver instance.
 /// \param     t_Boot Reference to the Bootloader interaction instance.
+/// \param     t_Storage Reference to the storage instance for the staged image.
 /// \param     t_OwnNodeId Own node identifier for firmware updates. Upon reception of
 ///            an XCP Connect command via USB with the command parameter (CM) set to
 ///            this node identifier value, the XCP packet is not pushed through the
@@ -58,24 +60,58 @@
 ///            microcontroller target via the CAN bus.
 /// \param     t_CanIdFromTarget The CAN identifier for receiving XCP packets from the
 ///            microcontroller target via the CAN bus.
+/// \attention The USB device and CAN driver instances must actually be of type
+///            UsbDeviceT and CanT, respectively. The constructor converts the references
+///            without a check, because the firmware is built without run-time type
+///            information. This is safe, because with the default Can and UsbDevice
+///            types there is no conversion at all. With GATEWAY_STATIC_BINDING enabled,
+///            the board that selects the types in its boardtypes.hpp, is also the one
+///            that creates the single CAN driver and USB device instance, which its
+///            can() and usbDevice() getters return. Only pass those instances. The
+///            class template checks at compile time that the types actually derive from
+///            the interfaces.
 ///
 ///**************************************************************************************
-Gateway::Gateway(UsbDevice& t_UsbDevice, Can& t_Can, Boot& t_Boot, uint8_t t_OwnNodeId,
-                 Can::Baudrate t_CanBaudrate, uint8_t t_CanExtIds, 
-                uint32_t t_CanIdToTarget, uint32_t t_CanIdFromTarget)
+template <class CanT, class UsbDeviceT>
+BasicGateway<CanT, UsbDeviceT>::BasicGateway(UsbDevice& t_UsbDevice, Can& t_Can,
+                                             Boot& t_Boot, Storage& t_Storage,
+                                             uint8_t t_OwnNodeId,
+                                             Can::Baudrate t_CanBaudrate,
+                                             uint8_t t_CanExtIds,
+                                             uint32_t t_CanIdToTarget,
+                                             uint32_t t_CanIdFromTarget)
   : ControlLoopSubscriber(),
-    m_UsbDevice(t_UsbDevice), m_Can(t_Can), m_Boot(t_Boot),
+    m_UsbDevice(static_cast<UsbDeviceT&>(t_UsbDevice)),
+    m_Can(static_cast<CanT&>(t_Can)), m_Boot(t_Boot),
     m_OwnNodeId(t_OwnNodeId), m_CanBaudrate(t_CanBaudrate), m_CanExtIds(t_CanExtIds),
-    m_CanIdToTarget(t_CanIdToTarget), m_CanIdFromTarget(t_CanIdFromTarget)
+    m_CanIdToTarget(t_CanIdToTarget), m_CanIdFromTarget(t_CanIdFromTarget),
+    m_Loader(t_Can, t_Storage, t_CanExtIds, t_CanIdToTarget)
 {
   // Set the USB data received event handler to the onUsbDataReceived() method.
-  m_UsbDevice.onDataReceived = std::bind(&Gateway::onUsbDataReceived, 
+  m_UsbDevice.onDataReceived = std::bind(&BasicGateway::onUsbDataReceived,
                                          this, std::placeholders::_1,
-                                         std::placeholders::_2);
+                                         std::placeholders::_2, std::placeholders::_3);
   // Set the CAN message received event handler to the onCanReceived() method.
-  m_Can.onReceived = std::bind(&Gateway::onCanReceived, this, std::placeholders::_1);
+  m_Can.onReceived = std::bind(&BasicGateway::onCanReceived, this,
+                               std::placeholders::_1);
+  // Set the CAN connected event handler to the onCanConnected() method.
+  m_Can.onConnected = std::bind(&BasicGateway::onCanConnected, this);
   // Set the CAN bus off event handler to the onCanBusOff() method.
-  m_Can.onBusOff = std::bind(&Gateway::onCanBusOff, this);
+  m_Can.onBusOff = std::bind(&BasicGateway::onCanBusOff, this);
+  // Set the CAN bus off recovered event handler to the onCanBusOffRecovered() method.
+  m_Can.onBusOffRecovered = std::bind(&BasicGateway::onCanBusOffRecovered, this);
+  // Set the CAN transmit failed event handler to the onCanTransmitFailed() method.
+  m_Can.onTransmitFailed = std::bind(&BasicGateway::onCanTransmitFailed, this,
+                                     std::placeholders::_1);
+  // Set the XCP loader job done event handler to the onLoaderJobDone() method.
+  m_Loader.onJobDone = std::bind(&BasicGateway::onLoaderJobDone, this,
+                                 std::placeholders::_1);
+#if (GATEWAY_FAST_PATH > 0)
+  // Set the CAN message received at interrupt level event handler to the 
+  // onCanReceivedFromISR() method.
+  m_Can.onReceivedFromISR = std::bind(&BasicGateway::onCanReceivedFromISR, this, 
+                                      std::placeholders::_1);
+#endif
 }
 
 
@@ -83,18 +119,27 @@ Gateway::Gateway(UsbDevice& t_UsbDevice, Can& t_Can, Boot& t_Boot, uint8_t t_Own
 /// \brief     Starts the gateway. 
 ///
 ///**************************************************************************************
-void Gateway::start()
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::start()
 {
   // Configure the CAN reception acceptance filter to just receive XCP packets from
-  // the target.
-  CanFilter canFilter(m_CanIdFromTarget, 0x1FFFFFFFUL, CanFilter::STD);
-  if (m_CanExtIds == TBX_TRUE)
+  // the target. The filter set is a member, to keep it off the caller's stack.
+  CanFilterCompiler canFilterCompiler(m_Can.filterBankCount());
+  canFilterCompiler.compile(&m_CanIdFromTarget, 1U, m_CanExtIds, m_CanFilterSet);
+  m_Can.setFilterSet(m_CanFilterSet);
+  // Start connecting to the CAN bus. This does not block. The CAN driver calls the
+  // onCanConnected() event handler, once it synchronized to the CAN bus.
+  m_Can.connect(m_CanBaudrate);
+  // Discard a partially received XCP packet or adapter command, if any.
+  m_UsbRxPacketLen = 0U;
+  m_UsbCmdLeft = 0U;
+  if (m_UsbCmdDest != nullptr)
   {
-    canFilter.mode = CanFilter::EXT;
+    m_UsbCmdDest = nullptr;
+    m_Loader.release();
   }
-  m_Can.setFilter(canFilter);
-  // Connect to the CAN bus.
-  m_Can.connect(m_CanBaudrate);
+  // No XCP Connect command to retransmit yet.
+  m_ConnectRetryState = RETRYIDLE;
   // Update started state flag.
   m_Started = TBX_TRUE;
 }
@@ -104,25 +149,89 @@ void Gateway::start()
 /// \brief     Stops the gateway. 
 ///
 ///**************************************************************************************
-void Gateway::stop()
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::stop()
 {
   // Disconnect from the CAN bus.
   m_Can.disconnect();
+  // Stop retransmitting the XCP Connect command, if still active.
+  m_ConnectRetryState = RETRYIDLE;
+  // Discard a partially received adapter command, if any.
+  m_UsbCmdLeft = 0U;
+  if (m_UsbCmdDest != nullptr)
+  {
+    m_UsbCmdDest = nullptr;
+    m_Loader.release();
+  }
   // Update started state flag.
   m_Started = TBX_FALSE;
 }
 
 
+///**************************************************************************************
+/// \brief     Starts programming the staged image on the target, without the host. The
+///            gateway calls the onStandaloneDone event handler, once done.
+/// \return    TBX_OK if programming started, TBX_ERROR if the gateway is not started,
+///            an adapter command is being received or the XCP loader is busy.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+uint8_t BasicGateway<CanT, UsbDeviceT>::startStandalone()
+{
+  uint8_t result = TBX_ERROR;
+
+  // Only continue if the gateway is started, not in a session with the host and not
+  // receiving the payload of an adapter command. The XCP loader itself also rejects
+  // the job, while the host's adapter command has it claimed.
+  if ((m_Started == TBX_TRUE) && (m_Connected == TBX_FALSE) && (m_UsbCmdLeft == 0U) &&
+      (m_Loader.claimed() == TBX_FALSE))
+  {
+    // Submit the job to the XCP loader. Its outcome is not reported to the host.
+    if (m_Loader.submit(XcpLoader::STANDALONE, 0U, XcpLoader::ORIGINAPP) ==
+        XcpLoader::STATUSOK)
+    {
+      result = TBX_OK;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Sets the interval for retransmitting an XCP Connect command from the host
+///            on the CAN bus, until the target responds. The gateway keeps doing so for
+///            c_ConnectRetryWindowMillis after the host's latest XCP Connect command.
+///            Note that the interval is rounded up to the step time of the control loop.
+/// \param     t_Interval Retransmit interval. Set to 0 to disable the retransmission.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::setConnectRetryInterval(
+  std::chrono::milliseconds t_Interval)
+{
+  // Store the retransmit interval.
+  m_ConnectRetryInterval = t_Interval;
+}
+
+
 ///**************************************************************************************
 /// \brief     Update method that drives the class. Should be called periodically.
 /// \param     t_Delta Number of milliseconds that passed.
 ///
 ///**************************************************************************************
-void Gateway::update(std::chrono::milliseconds t_Delta)
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::update(std::chrono::milliseconds t_Delta)
 {
   // Update the current time. 
   m_CurrentMillis += t_Delta;
 
+  // Retransmit the XCP Connect command, if needed.
+  if (m_Started == TBX_TRUE)
+  {
+    processConnectRetry();
+  }
+
   // Only need to do gateway inactivity timeout monitoring when the gateway is started
   // and actually connected.
   if ((m_Started == TBX_TRUE) && (m_Connected == TBX_TRUE))
@@ -145,105 +254,441 @@ void Gateway::update(std::chrono::milliseconds t_Delta)
 ///**************************************************************************************
 /// \brief     Event handler that gets called when new data was received on from the USB
 ///            host.
+/// \details   XCP packets on USB always contain the packet length in the first byte.
+///            E.g. the XCP Connect command:
+///              0xFF 0x00
+///            would look like
+///              0x02 0xFF 0x00
+///            A single USB transfer can hold several of these length prefixed packets
+///            back-to-back. A packet can also be split across two consecutive transfers.
+///            This method reassembles the packets and processes each one of them, once
+///            it was completely received. The same applies to adapter commands.
+/// \param     t_Data Byte array with the received data.
+/// \param     t_Len Number of bytes in the array.
+/// \param     t_Timestamp Timestamp of the data's reception. A packet that is split
+///            across two transfers keeps the timestamp of the first one.
 ///
 ///**************************************************************************************
-void Gateway::onUsbDataReceived(uint8_t const t_Data[], uint32_t t_Len)
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::onUsbDataReceived(
+  uint8_t const t_Data[], uint32_t t_Len, uint32_t t_Timestamp)
 {
-  constexpr uint8_t xcpCmdConnect = 0xFFU;
-  constexpr uint8_t xcpCmdDisconnect = 0xFEU;
-  constexpr uint8_t xcpCmdProgramReset = 0xCFU;
+  uint32_t idx = 0U;
 
   // Only process the new data if the gateway is started.
   if (m_Started == TBX_TRUE)
   {
-    CanMsg xcpMsgToTarget(m_CanIdToTarget, m_CanExtIds, t_Len - 1U, { });
-
     // Refresh the last XCP packet received time, used for inactivity timeout monitoring.
     m_LastPacketMillis = m_CurrentMillis;
 
-    // Does this look like a valid XCP command packet? XCP packets on USB always contain
-    // the packet length in the first byte. E.g. the XCP Connect command:
-    //   0xFF 0x00
-    // would look like
-    //   0x02 0xFF 0x00 
-    //Furthermore, since this is a USB-CAN gateway, a packet CAN never be more than 8 bytes
-    // in length, so 9 including the extra lenght byt eat the start.
-    if ((t_Len >= 2U) && (t_Len <= 9U) && (t_Len == (t_Data[0] + 1U)))
+    // Walk through all the received bytes.
+    while (idx < t_Len)
     {
-      // Is it the XCP Connect command? It has a length of 2.
-      if ((t_Data[1] == xcpCmdConnect) && (t_Data[0] == 2U))
+      // Receiving the payload of an adapter command?
+      if (m_UsbCmdLeft > 0U)
       {
-        // Read out the node ID that is located in the connect mode parameter.
-        uint8_t targetNodeId = t_Data[2];
-        // Is a bootloader present on our own system?
-        if (m_Boot.detectLoader() == TBX_TRUE)
+        // Determine how many bytes of the payload are in this transfer.
+        size_t chunkLen = ((t_Len - idx) < m_UsbCmdLeft) ? (t_Len - idx) : m_UsbCmdLeft;
+        // Store them, unless the payload is being discarded.
+        if (m_UsbCmdDest != nullptr)
         {
-          // Is this our own node ID?
-          if (targetNodeId == m_OwnNodeId)
+          for (size_t chunkIdx = 0U; chunkIdx < chunkLen; chunkIdx++)
           {
-            // Host is attempting to connect directly to us. Activate our own
-            // bootloader. Note that this function does not return.
-            m_Boot.activateLoader();
+            *m_UsbCmdDest++ = t_Data[idx + chunkIdx];
           }
         }
-        // Are we not yet in the connected state?
-        if (m_Connected == TBX_FALSE)
+        idx += chunkLen;
+        m_UsbCmdLeft -= chunkLen;
+        // Payload complete?
+        if (m_UsbCmdLeft == 0U)
         {
-          // Transition to the connected state.
-          m_Connected = TBX_TRUE;
-          // Trigger the event handler, if assigned.
-          if (onConnected)
-          {
-            onConnected();
-          }
-        } 
+          processUsbCommand();
+        }
       }
-      // Is it the XCP Disonnect or Program Reset command? Both have a length of 1.
-      else if (((t_Data[1] == xcpCmdDisconnect) || (t_Data[1] == xcpCmdProgramReset)) &&
-               (t_Data[0] == 1U))
+      // Receiving an XCP packet or the header of an adapter command.
+      else
       {
-        // Currently in the connected state?
-        if (m_Connected == TBX_TRUE)
+        // Start of a new packet?
+        if (m_UsbRxPacketLen == 0U)
         {
-          // Transition to the disconnected state.
-          m_Connected = TBX_FALSE;
-          // Trigger the event handler, if assigned.
-          if (onDisconnected)
+          // Since this is a USB-CAN gateway, a packet can never be more than 8 bytes in
+          // length and it should at least hold the XCP command code. The only exception
+          // is the start of an adapter command.
+          if ((t_Data[idx] != c_UsbCmdPrefix) &&
+              ((t_Data[idx] < 1U) || (t_Data[idx] > CanMsg::c_DataLenMax)))
           {
-            onDisconnected();
+            // Not a valid length byte, so the position of the next packet is unknown.
+            // Discard the rest of the transfer. Log this as a warning.
+            logger().warning("Gateway discarded invalid USB data.");
+            break;
           }
+          // Timestamp the packet with the reception of its first byte.
+          m_UsbRxPacketTimestamp = t_Timestamp;
         }
-      }               
+        // Store the next byte of the packet.
+        m_UsbRxPacket[m_UsbRxPacketLen++] = t_Data[idx++];
+        // Header of an adapter command complete?
+        if (m_UsbRxPacket[0] == c_UsbCmdPrefix)
+        {
+          if (m_UsbRxPacketLen == c_UsbCmdHeaderLen)
+          {
+            // Reset the length for the reception of the next packet.
+            m_UsbRxPacketLen = 0U;
+            // Prepare for the reception of the payload.
+            startUsbCommand();
+          }
+        }
+        // Packet complete?
+        else if (m_UsbRxPacketLen == (m_UsbRxPacket[0] + 1U))
+        {
+          // Reset the length for the reception of the next packet.
+          m_UsbRxPacketLen = 0U;
+          // Process the packet, without its length byte. While the XCP loader runs a
+          // job, it is the XCP master on the CAN bus. Discard the packet in this case.
+          if (m_Loader.busy() == TBX_TRUE)
+          {
+            logger().warning("Gateway discarded XCP packet while the loader is busy.");
+          }
+          else
+          {
+            processUsbPacket(&m_UsbRxPacket[1], m_UsbRxPacket[0],
+                             m_UsbRxPacketTimestamp);
+          }
+        }
+      }
+    }
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Prepares the reception of an adapter command's payload, once its header
+///            was received. The payload is stored directly as the XCP loader's job
+///            data. For this the gateway claims the XCP loader right away, such that
+///            the application cannot submit a job while the payload is being stored.
+///            The payload is discarded if the XCP loader cannot be claimed or if it does
+///            not fit.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::startUsbCommand()
+{
+  // Extract the command code and the payload length from the header.
+  m_UsbCmd = m_UsbRxPacket[1];
+  m_UsbCmdLen = static_cast<size_t>(m_UsbRxPacket[2]) |
+                (static_cast<size_t>(m_UsbRxPacket[3]) << 8U);
+  m_UsbCmdLeft = m_UsbCmdLen;
+  // Select where to store the payload.
+  m_UsbCmdDest = nullptr;
+  if ((m_UsbCmdLen <= XcpLoader::c_JobDataSizeMax) &&
+      (m_Loader.claim(XcpLoader::ORIGINHOST) == TBX_OK))
+  {
+    m_UsbCmdDest = m_Loader.jobData();
+  }
+  // Process the command right away, if it does not have a payload.
+  if (m_UsbCmdLeft == 0U)
+  {
+    processUsbCommand();
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Processes an adapter command, once its payload was completely received,
+///            by submitting it as a job to the XCP loader. The XCP loader reports the
+///            result when the job is done. A rejected command is answered right away.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::processUsbCommand()
+{
+  XcpLoaderResult jobResult{ m_UsbCmd, XcpLoader::ORIGINHOST, XcpLoader::STATUSBUSY,
+                             0U, 0U };
+
+  // Submit the job, if its payload was stored. Its outcome is reported to the host.
+  // This also ends the claim on the XCP loader.
+  if (m_UsbCmdDest != nullptr)
+  {
+    m_UsbCmdDest = nullptr;
+    jobResult.status = m_Loader.submit(m_UsbCmd, m_UsbCmdLen, XcpLoader::ORIGINHOST);
+  }
+  // Payload too large?
+  else if (m_UsbCmdLen > XcpLoader::c_JobDataSizeMax)
+  {
+    jobResult.status = XcpLoader::STATUSINVALID;
+  }
+  // Answer the command right away, if it was rejected.
+  if (jobResult.status != XcpLoader::STATUSOK)
+  {
+    sendUsbCommandResult(jobResult);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Sends the result record of an adapter command to the host.
+/// \param     t_Result The command's result.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::sendUsbCommandResult(
+  XcpLoaderResult const& t_Result)
+{
+  std::array<uint8_t, c_UsbCmdResultLen> resultRecord
+  {
+    c_UsbCmdPrefix, t_Result.command, t_Result.status, t_Result.xcpError,
+    static_cast<uint8_t>(t_Result.address),
+    static_cast<uint8_t>(t_Result.address >> 8U),
+    static_cast<uint8_t>(t_Result.address >> 16U),
+    static_cast<uint8_t>(t_Result.address >> 24U)
+  };
+
+  // Send the result record to the host via USB.
+  if (m_UsbDevice.transmit(resultRecord.data(), resultRecord.size()) == TBX_ERROR)
+  {
+    // USB transmit FIFO full. Log this as a warning.
+    logger().warning("Gateway USB transmit FIFO full.");
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Processes a single XCP packet received from the USB host, by pushing it
+///            through the gateway onto the CAN bus.
+/// \param     t_Packet Byte array with the XCP packet data, so without the length byte.
+/// \param     t_Len Number of bytes in the XCP packet [1..8].
+/// \param     t_Timestamp Timestamp of the packet's reception.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::processUsbPacket(
+  uint8_t const t_Packet[], uint8_t t_Len, uint32_t t_Timestamp)
+{
+  CanMsg xcpMsgToTarget(m_CanIdToTarget, m_CanExtIds, t_Len, { });
+
+  // Verify the parameters.
+  TBX_ASSERT((t_Len >= 1U) && (t_Len <= CanMsg::c_DataLenMax));
+
+  // Is it the XCP Connect command? It has a length of 2.
+  if ((t_Packet[0] == c_XcpCmdConnect) && (t_Len == 2U))
+  {
+    // Read out the node ID that is located in the connect mode parameter.
+    uint8_t targetNodeId = t_Packet[1];
+    // Is a bootloader present on our own system?
+    if (m_Boot.detectLoader() == TBX_TRUE)
+    {
+      // Is this our own node ID?
+      if (targetNodeId == m_OwnNodeId)
+      {
+        // Host is attempting to connect directly to us. Activate our own
+        // bootloader. Note that this function does not return.
+        m_Boot.activateLoader();
+      }
+    }
+    // Are we not yet in the connected state?
+    if (m_Connected == TBX_FALSE)
+    {
+      // Transition to the connected state.
+      m_Connected = TBX_TRUE;
+      // Trigger the event handler, if assigned.
+      if (onConnected)
+      {
+        onConnected();
+      }
+    } 
+    // Retransmit the XCP Connect command until the target responds, if enabled. Each
+    // XCP Connect command from the host restarts the retransmit time window.
+    if (m_ConnectRetryInterval.count() != 0)
+    {
+      TbxCriticalSectionEnter();
+      if (m_ConnectRetryState != RETRYACTIVE)
+      {
+        m_ConnectRetryCount = 0U;
+      }
+      m_ConnectRetryMode = targetNodeId;
+      m_ConnectRetryStartMillis = m_CurrentMillis;
+      m_ConnectRetryLastMillis = m_CurrentMillis;
+      m_ConnectRetryState = RETRYACTIVE;
+      TbxCriticalSectionExit();
+    }
+  }
+  // Is it the XCP Disonnect or Program Reset command? Both have a length of 1.
+  else if (((t_Packet[0] == c_XcpCmdDisconnect) ||
+            (t_Packet[0] == c_XcpCmdProgramReset)) &&
+           (t_Len == 1U))
+  {
+    // Currently in the connected state?
+    if (m_Connected == TBX_TRUE)
+    {
+      // Transition to the disconnected state.
+      m_Connected = TBX_FALSE;
+      // Trigger the event handler, if assigned.
+      if (onDisconnected)
+      {
+        onDisconnected();
+      }
+    }
+  }               
+  // Any other packet from the host means that the host moved on. Stop retransmitting
+  // the XCP Connect command and dropping duplicate responses.
+  if (t_Packet[0] != c_XcpCmdConnect)
+  {
+    m_ConnectRetryState = RETRYIDLE;
+  }
+  // Copy the packet data.
+  for (uint8_t idx=0; idx < t_Len; idx++)
+  {
+    xcpMsgToTarget[idx] = t_Packet[idx];
+  }
+  // Place the XCP packet on the CAN bus.
+  if (m_Can.transmit(xcpMsgToTarget) == TBX_ERROR)
+  {
+    // No more space in the CAN transmit queue. Log this as a warning.
+    logger().warning("Gateway CAN transmit queue full.");
+  }
+  else
+  {
+    // Record the forwarding latency of the XCP command and start its round trip. An
+    // XCP command has at most one response, so a pending round trip of an earlier XCP
+    // command that did not get a response is simply dropped.
+    latencyRecorder().record(LatencyRecorder::USBTOCAN, t_Timestamp);
+    TbxCriticalSectionEnter();
+    m_RoundTripTimestamp = t_Timestamp;
+    m_RoundTripPending = TBX_TRUE;
+    TbxCriticalSectionExit();
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Retransmits the XCP Connect command on the CAN bus, while waiting for the
+///            target to respond. A new retransmission is only started once all frames
+///            that were submitted before it left the CAN driver. This way no stale XCP
+///            Connect commands pile up in the transmit queue while the target is still
+///            in reset and does not acknowledge them. Called from the control loop.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::processConnectRetry()
+{
+  // Retransmitting the XCP Connect command?
+  if (m_ConnectRetryState == RETRYACTIVE)
+  {
+    // Did the retransmit time window pass without a response from the target? Then
+    // leave it up to the host to retry.
+    if ((m_CurrentMillis - m_ConnectRetryStartMillis) > c_ConnectRetryWindowMillis)
+    {
+      TbxCriticalSectionEnter();
+      if (m_ConnectRetryState == RETRYACTIVE)
+      {
+        m_ConnectRetryState = RETRYIDLE;
+      }
+      TbxCriticalSectionExit();
     }
-    // Copy the packet data.
-    for (uint8_t idx=0; idx < t_Data[0]; idx++)
+    // Time for the next retransmission?
+    else if (((m_CurrentMillis - m_ConnectRetryLastMillis) >= m_ConnectRetryInterval) &&
+             (m_Can.txPendingCount() == 0U))
     {
-      xcpMsgToTarget[idx] = t_Data[idx + 1];
+      CanMsg xcpMsgToTarget(m_CanIdToTarget, m_CanExtIds, 2U,
+                            { c_XcpCmdConnect, m_ConnectRetryMode });
+      // Place the XCP packet on the CAN bus.
+      if (m_Can.transmit(xcpMsgToTarget) == TBX_OK)
+      {
+        m_ConnectRetryLastMillis = m_CurrentMillis;
+        m_ConnectRetryCount++;
+      }
     }
-    // Place the XCP packet on the CAN bus.
-    if (m_Can.transmit(xcpMsgToTarget) == TBX_ERROR)
+  }
+  // Dropping duplicate responses to the XCP Connect command?
+  else if (m_ConnectRetryState == RETRYANSWERED)
+  {
+    // Stop doing so after the guard time.
+    if ((m_CurrentMillis - m_ConnectRetryLastMillis) > c_ConnectRetryGuardMillis)
     {
-      // No more transmit mailboxes available. Log this as a warning.
-      logger().warning("Gateway CAN transmit mailboxes all busy.");
+      TbxCriticalSectionEnter();
+      if (m_ConnectRetryState == RETRYANSWERED)
+      {
+        m_ConnectRetryState = RETRYIDLE;
+      }
+      TbxCriticalSectionExit();
     }
   }
 }
 
 
+///**************************************************************************************
+/// \brief     Decides if an XCP response packet from the target should be forwarded to
+///            the host, while retransmitting the XCP Connect command. The first
+///            response ends the retransmission and is forwarded. After that, duplicate
+///            positive responses to the XCP Connect command are dropped, until the
+///            host sends its next command or the guard time passes.
+/// \param     t_Msg The XCP response packet from the target.
+/// \return    TBX_TRUE if the packet should be forwarded, TBX_FALSE otherwise.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+uint8_t BasicGateway<CanT, UsbDeviceT>::connectRetryForward(CanMsg const& t_Msg)
+{
+  uint8_t result = TBX_TRUE;
+  uint8_t answered = TBX_FALSE;
+
+  // Obtain mutual exclusive access to the retransmission state, as the control loop
+  // and the USB device also change it.
+  TbxCriticalSectionEnter();
+  // First response from the target, while retransmitting the XCP Connect command?
+  if (m_ConnectRetryState == RETRYACTIVE)
+  {
+    // The target is listening, so stop retransmitting.
+    m_ConnectRetryState = RETRYANSWERED;
+    m_ConnectRetryLastMillis = m_CurrentMillis;
+    answered = TBX_TRUE;
+  }
+  // Duplicate positive response to the XCP Connect command?
+  else if ((m_ConnectRetryState == RETRYANSWERED) &&
+           (t_Msg.len() == c_XcpConnectResLen) && (t_Msg[0] == c_XcpPidResponse))
+  {
+    // Drop it.
+    result = TBX_FALSE;
+  }
+  // Release mutual exclusive access to the retransmission state.
+  TbxCriticalSectionExit();
+  // Log info.
+  if (answered == TBX_TRUE)
+  {
+    logger().info("Gateway XCP Connect answered after %u retransmissions.",
+                  m_ConnectRetryCount);
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
 ///**************************************************************************************
 /// \brief     Event handler that gets called when a new CAN message was received.
 /// \param     t_Msg The newly received CAN message.
 ///
 ///**************************************************************************************
-void Gateway::onCanReceived(CanMsg& t_Msg)
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::onCanReceived(CanMsg& t_Msg)
 {
+  // While the XCP loader runs a job, it is the XCP master on the CAN bus. It then
+  // processes the XCP response packets from the target.
+  if ((m_Started == TBX_TRUE) && (m_Loader.busy() == TBX_TRUE))
+  {
+    if ((t_Msg.id() == m_CanIdFromTarget) && (t_Msg.ext() == m_CanExtIds) &&
+        (t_Msg.len() >= 1U))
+    {
+      m_Loader.processResponse(t_Msg);
+    }
+  }
   // Only process the message if the the gateway is started and actually connected.
-  if ((m_Started == TBX_TRUE) && (m_Connected == TBX_TRUE))
+  else if ((m_Started == TBX_TRUE) && (m_Connected == TBX_TRUE))
   {
     // Only process the message if it in fact is the XCP response packet we expect. Note
-    // that an XCP response packet always has a length of at least 1.
+    // that an XCP response packet always has a length of at least 1. Duplicate
+    // responses to a retransmitted XCP Connect command are not forwarded.
     if ((t_Msg.id() == m_CanIdFromTarget) && (t_Msg.ext() == m_CanExtIds) &&
-        (t_Msg.len() >= 1U))
+        (t_Msg.len() >= 1U) && (connectRetryForward(t_Msg) == TBX_TRUE))
     {
       // Prepare the XCP packet for sending via USB by adding one extra byte at the
       // front with the length.
@@ -260,8 +705,136 @@ void Gateway::onCanReceived(CanMsg& t_Msg)
         // USB transmit FIFO full. Log this as a warning.
         logger().warning("Gateway USB transmit FIFO full.");
       }
+      else
+      {
+        // Record the forwarding latency of the XCP response packet.
+        recordResponseLatency(t_Msg);
+      }
+    }
+  }
+#if (GATEWAY_FAST_PATH > 0)
+  // An XCP response packet that onCanReceivedFromISR() passed on to this task is now
+  // handled. Done last, such that a newer packet cannot overtake this one.
+  if ((t_Msg.id() == m_CanIdFromTarget) && (t_Msg.ext() == m_CanExtIds) &&
+      (t_Msg.len() >= 1U))
+  {
+    TbxCriticalSectionEnter();
+    if (m_TaskPathPending > 0U)
+    {
+      m_TaskPathPending = m_TaskPathPending - 1U;
     }
+    TbxCriticalSectionExit();
   }
+#endif
+}
+
+
+///**************************************************************************************
+/// \brief     Event handler that gets called directly from the CAN reception interrupt,
+///            when a new CAN message was received. It forwards the XCP response packet
+///            to the host straight away, such that it does not need to pass through the
+///            CAN driver's task first.
+/// \details   An XCP response packet that is passed on to onCanReceived() is counted as
+///            pending. As long as packets are pending, the next ones are passed on as
+///            well. Otherwise they would reach the host before the pending ones.
+/// \attention This method runs in interrupt context.
+/// \param     t_Msg The newly received CAN message.
+/// \return    TBX_TRUE if the message was fully handled, TBX_FALSE if it should still
+///            be passed on to onCanReceived().
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+uint8_t BasicGateway<CanT, UsbDeviceT>::onCanReceivedFromISR(CanMsg& t_Msg)
+{
+  uint8_t result = TBX_FALSE;
+
+  // Only process the message if it in fact is the XCP response packet we expect. Note
+  // that an XCP response packet always has a length of at least 1.
+  if ((t_Msg.id() == m_CanIdFromTarget) && (t_Msg.ext() == m_CanExtIds) &&
+      (t_Msg.len() >= 1U))
+  {
+    // Only process the message if the gateway is started and actually connected
+    // and no older packets are pending. While retransmitting the XCP Connect command,
+    // the responses take the regular path through onCanReceived(), which filters out
+    // the duplicates. The same applies while the XCP loader runs a job, as it processes
+    // the responses itself.
+    if ((m_Started == TBX_TRUE) && (m_Connected == TBX_TRUE) &&
+        (m_ConnectRetryState == RETRYIDLE) && (m_Loader.busy() == TBX_FALSE) &&
+        (m_TaskPathPending == 0U))
+    {
+      // Prepare the XCP packet for sending via USB by adding one extra byte at the
+      // front with the length.
+      std::array<uint8_t, CanMsg::c_DataLenMax + 1U> xcpPacketToHost;
+      xcpPacketToHost[0] = t_Msg.len();
+      // Copy the packet data.
+      for (uint8_t idx=0; idx < t_Msg.len(); idx++)
+      {
+        xcpPacketToHost[idx + 1] = t_Msg[idx];
+      }
+      // Send the XCP response packet to the host via USB. If this fails, the message
+      // is not marked as handled. This way it takes the regular path through
+      // onCanReceived(), which is allowed to log the problem.
+      if (m_UsbDevice.transmitFromISR(xcpPacketToHost.data(), 
+                                      t_Msg.len() + 1U) == TBX_OK)
+      {
+        // Record the forwarding latency of the XCP response packet.
+        recordResponseLatency(t_Msg);
+        result = TBX_TRUE;
+      }
+    }
+    // Keep track of the packets that take the regular path.
+    if (result == TBX_FALSE)
+    {
+      m_TaskPathPending = m_TaskPathPending + 1U;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Records the forwarding latency of an XCP response packet that was handed
+///            over to the USB device. The first response after an XCP command from the
+///            host also completes the command's round trip.
+/// \details   Can also be called from interrupt context.
+/// \param     t_Msg The XCP response packet from the target.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::recordResponseLatency(CanMsg const& t_Msg)
+{
+  uint8_t roundTripDone = TBX_FALSE;
+  uint32_t roundTripTimestamp = 0U;
+
+  // Record the latency from the packet's own reception on CAN.
+  latencyRecorder().record(LatencyRecorder::CANTOUSB, t_Msg.timestamp());
+  // Complete the round trip of the XCP command that this packet responds to, if any.
+  TbxCriticalSectionEnter();
+  if (m_RoundTripPending == TBX_TRUE)
+  {
+    m_RoundTripPending = TBX_FALSE;
+    roundTripTimestamp = m_RoundTripTimestamp;
+    roundTripDone = TBX_TRUE;
+  }
+  TbxCriticalSectionExit();
+  if (roundTripDone == TBX_TRUE)
+  {
+    latencyRecorder().record(LatencyRecorder::ROUNDTRIP, roundTripTimestamp);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Event handler that gets called when the CAN driver synchronized to the
+///            CAN bus.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::onCanConnected()
+{
+  // Log info.
+  logger().info("Gateway CAN bus synchronized.");
 }
 
 
@@ -270,7 +843,8 @@ void Gateway::onCanReceived(CanMsg& t_Msg)
 ///            detected.
 ///
 ///**************************************************************************************
-void Gateway::onCanBusOff()
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::onCanBusOff()
 {
   // Trigger the event handler, if assigned.
   if (onError)
@@ -281,4 +855,87 @@ void Gateway::onCanBusOff()
   logger().warning("Gateway CAN bus off error detected.");
 }
 
+
+///**************************************************************************************
+/// \brief     Event handler that gets called when the CAN driver recovered from a bus
+///            off event and is back on the bus. The gateway session, if any, simply
+///            continues.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::onCanBusOffRecovered()
+{
+  // Trigger the event handler, if assigned.
+  if (onRecovered)
+  {
+    onRecovered();
+  }
+  // Log info.
+  logger().info("Gateway CAN bus off recovered.");
+}
+
+
+///**************************************************************************************
+/// \brief     Event handler that gets called when the transmission of a CAN message was
+///            aborted, because no other node acknowledged it in time. This typically
+///            means that the target is not connected or not powered.
+/// \param     t_Msg The CAN message that could not be transmitted.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::onCanTransmitFailed(CanMsg& t_Msg)
+{
+  TBX_UNUSED_ARG(t_Msg);
+
+  // While retransmitting the XCP Connect command, the target is possibly still in
+  // reset. Unacknowledged frames are then expected and not an error. The same applies
+  // while the XCP loader connects to the target.
+  if ((m_ConnectRetryState != RETRYACTIVE) && (m_Loader.connecting() == TBX_FALSE))
+  {
+    // Trigger the event handler, if assigned.
+    if (onError)
+    {
+      onError();
+    }
+    // Log warning
+    logger().warning("Gateway CAN frame not acknowledged by target.");
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Event handler that gets called when the XCP loader completed a job. Note
+///            that it is called from the XCP loader's task.
+/// \param     t_Result The job's result.
+///
+///**************************************************************************************
+template <class CanT, class UsbDeviceT>
+void BasicGateway<CanT, UsbDeviceT>::onLoaderJobDone(XcpLoaderResult const& t_Result)
+{
+  // Report the result to the host, if the job came from an adapter command.
+  if (t_Result.origin == XcpLoader::ORIGINHOST)
+  {
+    sendUsbCommandResult(t_Result);
+  }
+  // Report the outcome of programming the staged image.
+  if (t_Result.command == XcpLoader::STANDALONE)
+  {
+    // Trigger the event handler, if assigned.
+    if (onStandaloneDone)
+    {
+      onStandaloneDone((t_Result.status == XcpLoader::STATUSOK) ? TBX_TRUE : TBX_FALSE);
+    }
+  }
+}
+
+
+//***************************************************************************************
+// Explicit template instantiations
+//***************************************************************************************
+#if (GATEWAY_STATIC_BINDING > 0)
+template class BasicGateway<BoardCan, BoardUsbDevice>;
+#else
+template class BasicGateway<Can, UsbDevice>;
+#endif
+
 //********************************** end of gateway.cpp *********************************
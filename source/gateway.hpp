@@ -40,64 +40,179 @@
 // Include files
 //***************************************************************************************
 #include <cstdint>
+#include <array>
 #include <functional>
 #include <chrono>
+#include <type_traits>
 #include "controlloop.hpp"
 #include "usbdevice.hpp"
 #include "can.hpp"
+#include "canfiltercompiler.hpp"
 #include "boot.hpp"
+#include "storage.hpp"
+#include "xcploader.hpp"
 #include "microtbx.h"
+#if (GATEWAY_STATIC_BINDING > 0)
+#include "boardtypes.hpp"
+#endif
 
 
 //***************************************************************************************
 // Class definitions
 //***************************************************************************************
-/// \brief Gateway for XCP USB-CAN class.
-class Gateway : public ControlLoopSubscriber
+/// \brief   Gateway for XCP USB-CAN class template.
+/// \details The template parameters select the types through which the gateway
+///          accesses the CAN driver and the USB device. With the hardware independent
+///          Can and UsbDevice interfaces, each access goes through a virtual method
+///          call. With the hardware specific classes, which are declared final, the
+///          compiler binds these calls at compile time and is free to inline them.
+///          Use the Gateway type alias instead of this class template directly.
+///          When built with GATEWAY_FAST_PATH enabled, XCP response packets from the
+///          target are forwarded to the USB device directly from the CAN reception
+///          interrupt, bypassing the CAN driver's task. Once a response packet takes the
+///          regular path through the task, the next ones follow it there, until the
+///          task caught up. This keeps the response packets in order.
+///          The gateway records the forwarding latency of each XCP packet that it
+///          passes on with latencyRecorder(), using the packet's own reception
+///          timestamp. Packets that the gateway or the XCP loader send on their own
+///          are not recorded.
+///          With the connect retry interval set, the gateway retransmits an XCP Connect
+///          command from the host on the CAN bus, until the target responds. This
+///          helps with targets that only listen for a short time after a reset, such
+///          as a bootloader. Only the first positive response is forwarded to the
+///          host.
+///          Besides XCP packets, the host can send adapter commands via USB. These
+///          start with byte c_UsbCmdPrefix, which is never a valid XCP packet length,
+///          followed by the command code and the 16-bit payload length in little endian
+///          byte order. The payload forms the job data of the XCP loader. The gateway
+///          answers each adapter command with a result record: c_UsbCmdPrefix, the
+///          command code, the status, the XCP error code and the 32-bit address in
+///          little endian byte order. While the XCP loader runs a job, XCP packets from
+///          the host are discarded and the target's responses go to the XCP loader.
+///          Besides via an adapter command, the application can start programming the
+///          staged image on the target with startStandalone(). This works without a
+///          host. The gateway reports the outcome with the onStandaloneDone event.
+///          It rejects this while an adapter command's payload is being received.
+template <class CanT, class UsbDeviceT>
+class BasicGateway : public ControlLoopSubscriber
 {
 public:
   // Constructors and destructor.
-  explicit Gateway(UsbDevice& t_UsbDevice, Can& t_Can, Boot& t_Boot, 
-                   uint8_t t_OwnNodeId, Can::Baudrate t_CanBaudrate, uint8_t t_CanExtIds, 
-                   uint32_t t_CanIdToTarget, uint32_t t_CanIdFromTarget);
-  explicit Gateway(UsbDevice& t_UsbDevice, Can& t_Can, Boot& t_Boot)
-    : Gateway(t_UsbDevice, t_Can, t_Boot, 255U, Can::BR500K, 
-              TBX_FALSE, 0x667UL, 0x7E1UL) { }
-  virtual ~Gateway() { }
+  explicit BasicGateway(UsbDevice& t_UsbDevice, Can& t_Can, Boot& t_Boot,
+                        Storage& t_Storage, uint8_t t_OwnNodeId,
+                        Can::Baudrate t_CanBaudrate, uint8_t t_CanExtIds,
+                        uint32_t t_CanIdToTarget, uint32_t t_CanIdFromTarget);
+  explicit BasicGateway(UsbDevice& t_UsbDevice, Can& t_Can, Boot& t_Boot,
+                        Storage& t_Storage)
+    : BasicGateway(t_UsbDevice, t_Can, t_Boot, t_Storage, 255U, Can::BR500K, 
+                   TBX_FALSE, 0x667UL, 0x7E1UL) { }
+  virtual ~BasicGateway() { }
   // Methods.
   void start();
   void stop();
   void update(std::chrono::milliseconds t_Delta) override;
+  uint8_t startStandalone();
+  // Getters and setters.
+  uint8_t connected() const { return m_Connected; }
+  void setConnectRetryInterval(std::chrono::milliseconds t_Interval);
   // Events.
   std::function<void()> onConnected;
   std::function<void()> onDisconnected;
   std::function<void()> onError;
+  std::function<void()> onRecovered;
+  std::function<void(uint8_t t_Ok)> onStandaloneDone;
 
 private:
+  // Enumerations.
+  enum ConnectRetryState : uint8_t
+  {
+    RETRYIDLE,     ///< Not retransmitting the XCP Connect command.
+    RETRYACTIVE,   ///< Retransmitting the XCP Connect command, until the target responds.
+    RETRYANSWERED  ///< Target responded. Dropping duplicate positive responses.
+  };
   // Constants.
   static constexpr std::chrono::milliseconds c_IdleTimeoutMillis{12000};
+  static constexpr std::chrono::milliseconds c_ConnectRetryWindowMillis{1000};
+  static constexpr std::chrono::milliseconds c_ConnectRetryGuardMillis{50};
+  static constexpr uint8_t c_XcpCmdConnect = 0xFFU;
+  static constexpr uint8_t c_XcpCmdDisconnect = 0xFEU;
+  static constexpr uint8_t c_XcpCmdProgramReset = 0xCFU;
+  static constexpr uint8_t c_XcpPidResponse = 0xFFU;
+  static constexpr uint8_t c_XcpConnectResLen = 8U;
+  static constexpr uint8_t c_UsbCmdPrefix = 0xA0U;
+  static constexpr size_t c_UsbCmdHeaderLen = 4U;
+  static constexpr size_t c_UsbCmdResultLen = 8U;
   // Members.
-  UsbDevice& m_UsbDevice;
-  Can& m_Can;
+  UsbDeviceT& m_UsbDevice;
+  CanT& m_Can;
   Boot& m_Boot;
   uint8_t m_OwnNodeId;
   Can::Baudrate m_CanBaudrate;
   uint8_t m_CanExtIds;
   uint32_t m_CanIdToTarget;
   uint32_t m_CanIdFromTarget;
+  XcpLoader m_Loader;
+  CanFilterSet m_CanFilterSet{ };
   uint8_t m_Started{TBX_FALSE};
   uint8_t m_Connected{TBX_FALSE};
   std::chrono::milliseconds m_LastPacketMillis{0};
   std::chrono::milliseconds m_CurrentMillis{0};
+  std::array<uint8_t, CanMsg::c_DataLenMax + 1U> m_UsbRxPacket{ };
+  size_t m_UsbRxPacketLen{0U};
+  uint32_t m_UsbRxPacketTimestamp{0U};
+  uint8_t m_UsbCmd{0U};
+  size_t m_UsbCmdLen{0U};
+  size_t m_UsbCmdLeft{0U};
+  uint8_t* m_UsbCmdDest{nullptr};
+  volatile uint32_t m_TaskPathPending{0U};
+  uint32_t m_RoundTripTimestamp{0U};
+  volatile uint8_t m_RoundTripPending{TBX_FALSE};
+  std::chrono::milliseconds m_ConnectRetryInterval{0};
+  volatile ConnectRetryState m_ConnectRetryState{RETRYIDLE};
+  uint8_t m_ConnectRetryMode{0U};
+  std::chrono::milliseconds m_ConnectRetryStartMillis{0};
+  std::chrono::milliseconds m_ConnectRetryLastMillis{0};
+  uint32_t m_ConnectRetryCount{0U};
   // Methods.
-  void onUsbDataReceived(uint8_t const t_Data[], uint32_t t_Len);
+  void processUsbPacket(uint8_t const t_Packet[], uint8_t t_Len, uint32_t t_Timestamp);
+  void processConnectRetry();
+  void startUsbCommand();
+  void processUsbCommand();
+  void sendUsbCommandResult(XcpLoaderResult const& t_Result);
+  uint8_t connectRetryForward(CanMsg const& t_Msg);
+  void recordResponseLatency(CanMsg const& t_Msg);
+  void onUsbDataReceived(uint8_t const t_Data[], uint32_t t_Len, uint32_t t_Timestamp);
   void onCanReceived(CanMsg& t_Msg);
+  uint8_t onCanReceivedFromISR(CanMsg& t_Msg);
+  void onCanConnected();
   void onCanBusOff();
+  void onCanBusOffRecovered();
+  void onCanTransmitFailed(CanMsg& t_Msg);
+  void onLoaderJobDone(XcpLoaderResult const& t_Result);
+
+  // The constructor converts the CAN driver and USB device references to these types.
+  static_assert(std::is_base_of<Can, CanT>::value, "CanT must derive from Can");
+  static_assert(std::is_base_of<UsbDevice, UsbDeviceT>::value,
+                "UsbDeviceT must derive from UsbDevice");
 
   // Flag the class as non-copyable.
-  Gateway(const Gateway&) = delete;
-  const Gateway& operator=(const Gateway&) = delete; 
+  BasicGateway(const BasicGateway&) = delete;
+  const BasicGateway& operator=(const BasicGateway&) = delete;
 };
 
+
+//***************************************************************************************
+// Type definitions
+//***************************************************************************************
+#if (GATEWAY_STATIC_BINDING > 0)
+/// \brief Gateway for XCP USB-CAN, bound at compile time to the board's CAN driver and
+///        USB device classes, as selected by the board in boardtypes.hpp.
+using Gateway = BasicGateway<BoardCan, BoardUsbDevice>;
+#else
+/// \brief Gateway for XCP USB-CAN, bound at run time to the board's CAN driver and USB
+///        device classes via their hardware independent interfaces.
+using Gateway = BasicGateway<Can, UsbDevice>;
+#endif
+
 #endif // GATEWAY_HPP
 //********************************** end of gateway.hpp *********************************
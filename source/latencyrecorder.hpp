@@ -0,0 +1,91 @@
+///**************************************************************************************
+/// \file         latencyrecorder.hpp
+/// \brief        Forwarding latency recorder header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef LATENCYRECORDER_HPP
+#define LATENCYRECORDER_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   Abstract forwarding latency recorder class.
+/// \details The drivers timestamp a packet upon its reception and pass the timestamp
+///          along with the packet. The gateway records the latency of a packet, once it
+///          handed the packet over to the driver on the other side, by calling record()
+///          with the packet's own reception timestamp. The time base of the timestamps
+///          is up to the board.
+class LatencyRecorder
+{
+public:
+  // Enumerations.
+  enum Path : uint8_t
+  {
+    USBTOCAN = 0, ///< From USB reception to CAN transmit.
+    CANTOUSB,     ///< From CAN reception to USB transmit.
+    ROUNDTRIP,    ///< From USB reception of an XCP command to USB transmit of its
+                  ///< response.
+    PATHCOUNT
+  };
+  // Destructor.
+  virtual ~LatencyRecorder() { }
+  // Methods.
+  virtual void record(Path t_Path, uint32_t t_RxTimestamp) = 0;
+
+protected:
+  // Flag the class as abstract.
+  explicit LatencyRecorder() { }
+
+private:
+  // Flag the class as non-copyable.
+  LatencyRecorder(const LatencyRecorder&) = delete;
+  const LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+};
+
+
+//***************************************************************************************
+// Function prototypes
+//***************************************************************************************
+// Global getter of the latency recorder's instance. Made global for the same reason as
+// the logger: there is exactly one and it is needed deep inside the forwarding paths.
+LatencyRecorder& latencyRecorder();
+
+
+#endif // LATENCYRECORDER_HPP
+//********************************** end of latencyrecorder.hpp *************************
@@ -42,6 +42,17 @@
 #include <cstdarg>
 
 
+//***************************************************************************************
+// Macro definitions
+//***************************************************************************************
+/// \brief Minimum severity level of the events to log: 0 = info, 1 = warning and 
+///        2 = error. Calls for events with a lower severity level are stripped at 
+///        compile time.
+#ifndef LOGGER_LEVEL_MIN
+#define LOGGER_LEVEL_MIN     (0)
+#endif
+
+
 //***************************************************************************************
 // Class definitions
 //***************************************************************************************
@@ -54,27 +65,36 @@ public:
   // Methods.
   void info(const char t_Fmt[], ...)
   { 
-    va_list paramList;
+    if constexpr (LOGGER_LEVEL_MIN <= INFO)
+    {
+      va_list paramList;
 
-    va_start(paramList, t_Fmt);
-    log(INFO, t_Fmt, &paramList);
-    va_end(paramList);
+      va_start(paramList, t_Fmt);
+      log(INFO, t_Fmt, &paramList);
+      va_end(paramList);
+    }
   }
   void warning(const char t_Fmt[], ...)
   { 
-    va_list paramList;
+    if constexpr (LOGGER_LEVEL_MIN <= WARNING)
+    {
+      va_list paramList;
 
-    va_start(paramList, t_Fmt);
-    log(WARNING, t_Fmt, &paramList);
-    va_end(paramList);
+      va_start(paramList, t_Fmt);
+      log(WARNING, t_Fmt, &paramList);
+      va_end(paramList);
+    }
   }
   void error(const char t_Fmt[], ...)
   { 
-    va_list paramList;
+    if constexpr (LOGGER_LEVEL_MIN <= ERROR)
+    {
+      va_list paramList;
 
-    va_start(paramList, t_Fmt);
-    log(ERROR, t_Fmt, &paramList);
-    va_end(paramList);
+      va_start(paramList, t_Fmt);
+      log(ERROR, t_Fmt, &paramList);
+      va_end(paramList);
+    }
   }
 
 protected:
@@ -0,0 +1,1765 @@
+///**************************************************************************************
+/// \file         xcploader.cpp
+/// \brief        XCP loader source file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include "xcploader.hpp"
+#include "ticks.hpp"
+#include "logger.hpp"
+
+
+///**************************************************************************************
+/// \brief     XCP loader constructor.
+/// \param     t_Can Reference to the CAN driver instance.
+/// \param     t_Storage Reference to the storage instance for the staged image.
+/// \param     t_CanExtIds TBX_TRUE if the CAN identifier is 29-bit extended, TBX_FALSE
+///            for an 11-bit standard CAN identifier.
+/// \param     t_CanIdToTarget The CAN identifier to use when sending XCP packets to the
+///            microcontroller target via the CAN bus.
+///
+///**************************************************************************************
+XcpLoader::XcpLoader(Can& t_Can, Storage& t_Storage, uint8_t t_CanExtIds,
+                     uint32_t t_CanIdToTarget)
+  : cpp_freertos::Thread("LoaderThread", configMINIMAL_STACK_SIZE + 128, 5),
+    m_Can(t_Can), m_Storage(t_Storage), m_CanExtIds(t_CanExtIds),
+    m_CanIdToTarget(t_CanIdToTarget)
+{
+  // Start the thread.
+  Start();
+}
+
+
+///**************************************************************************************
+/// \brief     Starts a job. The job data should already be stored with jobData().
+/// \param     t_Command The job's command.
+/// \param     t_Len Number of bytes of job data.
+/// \param     t_Origin Origin of the job, one of XcpLoader::Origin. It is passed back
+///            in the job's result.
+/// \return    STATUSOK if the job was started, STATUSBUSY if another job is still
+///            running or the loader is claimed for another origin, or STATUSINVALID if
+///            the job is not supported.
+///
+///**************************************************************************************
+uint8_t XcpLoader::submit(uint8_t t_Command, size_t t_Len, uint8_t t_Origin)
+{
+  uint8_t result = STATUSINVALID;
+
+  // Both the host and the application can submit a job. Make sure only one of them
+  // gets to start its job.
+  TbxCriticalSectionEnter();
+  // The submit ends the claim of the same origin, regardless of its outcome.
+  if ((m_Claimed == TBX_TRUE) && (m_ClaimOrigin == t_Origin))
+  {
+    m_Claimed = TBX_FALSE;
+  }
+  // Is another job still running or is the loader claimed for another origin?
+  if ((m_Busy == TBX_TRUE) || (m_Claimed == TBX_TRUE))
+  {
+    result = STATUSBUSY;
+  }
+  // Only continue with a supported job and job data that fits.
+  else if ((t_Command >= BULKDOWNLOAD) && (t_Command <= VERIFY) &&
+           (t_Len <= c_JobDataSizeMax))
+  {
+    // Store the job details and hand the job over to the task.
+    m_JobCommand = t_Command;
+    m_JobLen = t_Len;
+    m_JobOrigin = t_Origin;
+    m_Busy = TBX_TRUE;
+    xTaskNotifyGive(GetHandle());
+    // Update the result.
+    result = STATUSOK;
+  }
+  TbxCriticalSectionExit();
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Reserves the loader for the next job of an origin, before storing its job
+///            data with jobData(). Until the origin's next submit() or release(), the
+///            loader rejects jobs from any other origin.
+/// \param     t_Origin Origin of the next job, one of XcpLoader::Origin.
+/// \return    TBX_OK if the loader was claimed, TBX_ERROR if a job is still running or
+///            the loader is already claimed.
+///
+///**************************************************************************************
+uint8_t XcpLoader::claim(uint8_t t_Origin)
+{
+  uint8_t result = TBX_ERROR;
+
+  // Only continue if no job is running and the loader is not yet claimed.
+  TbxCriticalSectionEnter();
+  if ((m_Busy == TBX_FALSE) && (m_Claimed == TBX_FALSE))
+  {
+    // Reserve the loader for the origin.
+    m_ClaimOrigin = t_Origin;
+    m_Claimed = TBX_TRUE;
+    // Update the result.
+    result = TBX_OK;
+  }
+  TbxCriticalSectionExit();
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Ends the claim on the loader, without submitting a job.
+///
+///**************************************************************************************
+void XcpLoader::release()
+{
+  // End the claim.
+  m_Claimed = TBX_FALSE;
+}
+
+
+///**************************************************************************************
+/// \brief     Processes an XCP response packet from the target. The gateway calls this
+///            method, as opposed to forwarding the packet to the host, while a job runs.
+/// \param     t_Msg The CAN message with the XCP response packet.
+///
+///**************************************************************************************
+void XcpLoader::processResponse(CanMsg const& t_Msg)
+{
+  // Store the response and signal its reception to the task.
+  TbxCriticalSectionEnter();
+  m_Response = t_Msg;
+  TbxCriticalSectionExit();
+  (void)m_ResponseSemaphore.Give();
+}
+
+
+///**************************************************************************************
+/// \brief     XCP loader task function. Runs the submitted jobs.
+///
+///**************************************************************************************
+void XcpLoader::Run()
+{
+  XcpLoaderResult jobResult;
+
+  // Enter the task body, which should be an infinite loop.
+  for (;;)
+  {
+    // Wait for the next job.
+    (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    // Only continue if a job was actually submitted.
+    if (m_Busy == TBX_TRUE)
+    {
+      // Initialize the job result.
+      jobResult.command = m_JobCommand;
+      jobResult.origin = m_JobOrigin;
+      jobResult.status = STATUSOK;
+      jobResult.xcpError = 0U;
+      jobResult.address = 0U;
+      // Run the job.
+      switch (m_JobCommand)
+      {
+        case BULKDOWNLOAD:
+        {
+          runBulkDownload(jobResult);
+        }
+        break;
+
+        case STAGEERASE:
+        {
+          runStageErase(jobResult);
+        }
+        break;
+
+        case STAGEWRITE:
+        {
+          runStageWrite(jobResult);
+        }
+        break;
+
+        case STAGECOMMIT:
+        {
+          runStageCommit(jobResult);
+        }
+        break;
+
+        case STANDALONE:
+        {
+          runStandalone(jobResult);
+        }
+        break;
+
+        case VERIFY:
+        {
+          runVerify(jobResult);
+        }
+        break;
+
+        default:
+        {
+          jobResult.status = STATUSINVALID;
+        }
+        break;
+      }
+      // Ready for the next job. Done before calling the event handler, such that the
+      // host can submit its next job, as soon as it received the result.
+      m_Busy = TBX_FALSE;
+      // Trigger the event handler, if assigned.
+      if (onJobDone)
+      {
+        onJobDone(jobResult);
+      }
+    }
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Runs the bulk download job. Programs the memory block from the job data
+///            on the target. It sets the memory transfer address once and then streams
+///            the data with PROGRAM_MAX and PROGRAM commands. Compressed data is
+///            decompressed on the fly.
+/// \param     t_Result Job result.
+///
+///**************************************************************************************
+void XcpLoader::runBulkDownload(XcpLoaderResult& t_Result)
+{
+  constexpr size_t headerLen = 5U;
+
+  // Verify the job data. It should at least hold the header and one data byte.
+  if ((m_JobLen <= headerLen) || (m_JobLen > c_JobDataSizeMax))
+  {
+    t_Result.status = STATUSINVALID;
+  }
+  else
+  {
+    uint8_t flags = m_JobData[0];
+
+    // Extract the header.
+    m_Motorola = ((flags & c_FlagMotorola) != 0U) ? TBX_TRUE : TBX_FALSE;
+    t_Result.address = loadLe32(&m_JobData[1]);
+    // Set the memory transfer address.
+    if (xcpSetMta(t_Result.address, t_Result) == TBX_OK)
+    {
+      // Decompress the data while programming it?
+      if ((flags & c_FlagCompressed) != 0U)
+      {
+        decompressStart();
+        // A compressed stream without any data is invalid.
+        if ((xcpProgramDecompressed(&m_JobData[headerLen], m_JobLen - headerLen,
+                                    t_Result) == TBX_OK) &&
+            (xcpProgramDecompressedEnd(t_Result) == TBX_OK) &&
+            (m_DecompressTotal == 0U))
+        {
+          t_Result.status = STATUSINVALID;
+        }
+      }
+      // Program the data.
+      else
+      {
+        (void)xcpProgram(&m_JobData[headerLen], m_JobLen - headerLen, t_Result);
+      }
+    }
+  }
+  // Log a warning in case the job failed.
+  if (t_Result.status != STATUSOK)
+  {
+    logger().warning("Loader bulk download failed at 0x%08x.", t_Result.address);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Runs the stage erase job. Erases the storage and starts staging a new
+///            image. This also invalidates the previously staged image. The job data
+///            is either empty or holds the flags byte. With flag c_FlagCompressed, the
+///            memory blocks of the new image are compressed streams.
+/// \param     t_Result Job result.
+///
+///**************************************************************************************
+void XcpLoader::runStageErase(XcpLoaderResult& t_Result)
+{
+  // Verify the job data.
+  if (m_JobLen > 1U)
+  {
+    t_Result.status = STATUSINVALID;
+    m_StageOffset = 0U;
+  }
+  // Erase the storage.
+  else if (m_Storage.erase() != TBX_OK)
+  {
+    t_Result.status = STATUSSTORAGEERROR;
+    m_StageOffset = 0U;
+  }
+  // Start a new image. Its header is written last, upon completion.
+  else
+  {
+    m_StageOffset = c_StageHeaderLen;
+    m_StageNextAddress = 0U;
+    m_StageFlags = (m_JobLen == 1U) ? (m_JobData[0] & c_FlagCompressed) : 0U;
+  }
+  // Report the number of used bytes in the storage.
+  t_Result.address = static_cast<uint32_t>(m_StageOffset);
+  // Log a warning in case the job failed.
+  if (t_Result.status != STATUSOK)
+  {
+    logger().warning("Loader could not erase the staged image.");
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Runs the stage write job. Appends the memory block from the job data to
+///            the staged image. In the storage, each memory block starts with its
+///            32-bit address, the length of its data and the length of the stored
+///            data, all in little endian byte order. The two lengths only differ for a
+///            compressed image, in which case the stored data is a compressed stream.
+///            The memory blocks must be appended in ascending order of their
+///            addresses, without overlap. This way the memory blocks of a target sector
+///            are always consecutive.
+/// \param     t_Result Job result.
+///
+///**************************************************************************************
+void XcpLoader::runStageWrite(XcpLoaderResult& t_Result)
+{
+  constexpr size_t headerLen = 4U;
+
+  // Verify that staging started and the job data. It should at least hold the header
+  // and one data byte. Also check the order of the memory blocks.
+  if ((m_StageOffset == 0U) || (m_JobLen <= headerLen) ||
+      (m_JobLen > c_JobDataSizeMax) || (loadLe32(&m_JobData[0]) < m_StageNextAddress))
+  {
+    t_Result.status = STATUSINVALID;
+  }
+  else
+  {
+    std::array<uint8_t, c_StageBlockHeaderLen> blockHeader;
+    size_t storedLen = m_JobLen - headerLen;
+    size_t dataLen = storedLen;
+
+    // The length of a compressed memory block is only known after decompressing it.
+    if ((m_StageFlags & c_FlagCompressed) != 0U)
+    {
+      dataLen = decompressedLen(&m_JobData[headerLen], storedLen);
+    }
+    // Construct the header of the memory block.
+    storeLe32(&blockHeader[0], loadLe32(&m_JobData[0]));
+    storeLe32(&blockHeader[4], static_cast<uint32_t>(dataLen));
+    storeLe32(&blockHeader[8], static_cast<uint32_t>(storedLen));
+    // A compressed stream without any data is invalid.
+    if (dataLen == 0U)
+    {
+      t_Result.status = STATUSINVALID;
+    }
+    // Append the memory block to the staged image.
+    else if ((m_Storage.write(m_StageOffset, blockHeader.data(),
+                              blockHeader.size()) != TBX_OK) ||
+             (m_Storage.write(m_StageOffset + c_StageBlockHeaderLen,
+                              &m_JobData[headerLen], storedLen) != TBX_OK))
+    {
+      // The contents of the storage is now unknown. Staging needs to start over.
+      t_Result.status = STATUSSTORAGEERROR;
+      m_StageOffset = 0U;
+    }
+    else
+    {
+      m_StageOffset += c_StageBlockHeaderLen + stageAlign(storedLen);
+      m_StageNextAddress = loadLe32(&m_JobData[0]) + static_cast<uint32_t>(dataLen);
+    }
+  }
+  // Report the number of used bytes in the storage.
+  t_Result.address = static_cast<uint32_t>(m_StageOffset);
+}
+
+
+///**************************************************************************************
+/// \brief     Runs the stage commit job. Completes the staged image by writing its
+///            header: the magic value, flags, the length of its memory blocks and the
+///            target's sector size, all 32-bit values in little endian byte order. The
+///            job data is either empty or holds the flags byte and the 32-bit sector
+///            size in little endian byte order. With flag c_FlagDelta, the standalone
+///            job only programs the target sectors that differ from the staged image.
+///            The sector size must then be a power of two and the image uncompressed.
+///            Flag c_FlagCompressed is taken from the stage erase job.
+/// \param     t_Result Job result.
+///
+///**************************************************************************************
+void XcpLoader::runStageCommit(XcpLoaderResult& t_Result)
+{
+  constexpr size_t settingsLen = 5U;
+  uint8_t flags = 0U;
+  uint32_t sectorSize = 0U;
+
+  // Extract the settings from the job data, if present.
+  if (m_JobLen == settingsLen)
+  {
+    flags = m_JobData[0];
+    sectorSize = loadLe32(&m_JobData[1]);
+  }
+  flags = static_cast<uint8_t>((flags & ~c_FlagCompressed) | m_StageFlags);
+  // Verify that the staged image holds at least one memory block and the settings.
+  if ((m_StageOffset <= c_StageHeaderLen) ||
+      ((m_JobLen != 0U) && (m_JobLen != settingsLen)) ||
+      (((flags & c_FlagDelta) != 0U) &&
+       (((flags & c_FlagCompressed) != 0U) || (sectorSize == 0U) ||
+        ((sectorSize & (sectorSize - 1U)) != 0U))))
+  {
+    t_Result.status = STATUSINVALID;
+  }
+  else
+  {
+    std::array<uint8_t, c_StageHeaderLen> imageHeader;
+
+    // Construct the header of the image.
+    storeLe32(&imageHeader[0], c_StageMagic);
+    storeLe32(&imageHeader[4], flags);
+    storeLe32(&imageHeader[8], static_cast<uint32_t>(m_StageOffset - c_StageHeaderLen));
+    storeLe32(&imageHeader[12], sectorSize);
+    // Write the header, which makes the staged image valid.
+    if (m_Storage.write(0U, imageHeader.data(), imageHeader.size()) != TBX_OK)
+    {
+      t_Result.status = STATUSSTORAGEERROR;
+    }
+    // Report the number of used bytes in the storage.
+    t_Result.address = static_cast<uint32_t>(m_StageOffset);
+    // The image is complete. Staging a new one starts with erasing the storage.
+    m_StageOffset = 0U;
+  }
+  // Log a warning in case the job failed.
+  if (t_Result.status != STATUSOK)
+  {
+    logger().warning("Loader could not complete the staged image.");
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Runs the standalone job. Programs the staged image on the target, by
+///            running the complete XCP programming sequence. With flag c_FlagDelta in
+///            the staged image, it only programs the target sectors that differ.
+/// \param     t_Result Job result.
+///
+///**************************************************************************************
+void XcpLoader::runStandalone(XcpLoaderResult& t_Result)
+{
+  size_t imageLen = 0U;
+  uint8_t flags = 0U;
+  uint32_t sectorSize = 0U;
+
+  // Only continue with a valid staged image.
+  if (stagedImageInfo(imageLen, flags, sectorSize) != TBX_OK)
+  {
+    t_Result.status = STATUSINVALID;
+  }
+  // Connect to the target and start the programming session.
+  else if ((xcpConnect(t_Result) == TBX_OK) && (xcpProgramStart(t_Result) == TBX_OK))
+  {
+    uint8_t result;
+
+    // Only erase and program the target sectors that differ?
+    if ((flags & c_FlagDelta) != 0U)
+    {
+      result = processDeltaSectors(imageLen, sectorSize, t_Result);
+    }
+    // Erase all memory blocks first and then program them.
+    else
+    {
+      result = processStagedBlocks(imageLen, flags, TBX_FALSE, t_Result);
+      if (result == TBX_OK)
+      {
+        result = processStagedBlocks(imageLen, flags, TBX_TRUE, t_Result);
+      }
+    }
+    // Ending the programming session makes the target's bootloader finalize the
+    // programming.
+    if ((result == TBX_OK) && (xcpProgramEnd(t_Result) == TBX_OK))
+    {
+      // Reset the target, such that it starts the newly programmed firmware.
+      (void)xcpProgramReset(t_Result);
+    }
+  }
+  // Log the outcome of the job.
+  if (t_Result.status != STATUSOK)
+  {
+    logger().warning("Loader standalone programming failed at 0x%08x.",
+                     t_Result.address);
+  }
+  else
+  {
+    logger().info("Loader standalone programming completed.");
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Runs the verify job. Uploads the memory range from the job data on the
+///            target and checks each segment against its CRC-32 from the job data. It
+///            sets the memory transfer address once and then uploads the memory range
+///            with back-to-back UPLOAD commands. The last segment is possibly shorter
+///            than the segment length.
+/// \param     t_Result Job result. Upon a mismatch, its address is the start of the
+///            first segment that differs.
+///
+///**************************************************************************************
+void XcpLoader::runVerify(XcpLoaderResult& t_Result)
+{
+  constexpr size_t headerLen = 13U;
+  uint32_t verifyLen = 0U;
+  uint32_t segmentLen = 0U;
+  size_t segmentCount = 0U;
+
+  // Extract the lengths from the header, if present.
+  if ((m_JobLen >= headerLen) && (m_JobLen <= c_JobDataSizeMax))
+  {
+    verifyLen = loadLe32(&m_JobData[5]);
+    segmentLen = loadLe32(&m_JobData[9]);
+    segmentCount = (m_JobLen - headerLen) / 4U;
+  }
+  // Verify the job data. It should hold exactly one CRC-32 for each segment.
+  if ((verifyLen == 0U) || (segmentLen == 0U) || (((m_JobLen - headerLen) % 4U) != 0U) ||
+      (segmentCount != ((verifyLen / segmentLen) +
+                        (((verifyLen % segmentLen) != 0U) ? 1U : 0U))))
+  {
+    t_Result.status = STATUSINVALID;
+  }
+  else
+  {
+    // Extract the rest of the header.
+    m_Motorola = ((m_JobData[0] & c_FlagMotorola) != 0U) ? TBX_TRUE : TBX_FALSE;
+    t_Result.address = loadLe32(&m_JobData[1]);
+    // Set the memory transfer address and verify the memory range.
+    if (xcpSetMta(t_Result.address, t_Result) == TBX_OK)
+    {
+      (void)xcpUploadVerify(verifyLen, segmentLen, &m_JobData[headerLen], t_Result);
+    }
+  }
+  // Log a warning in case the job failed.
+  if (t_Result.status != STATUSOK)
+  {
+    logger().warning("Loader verification failed at 0x%08x.", t_Result.address);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Verifies the header of the staged image and extracts its settings.
+/// \param     t_Len Storage for the length of the image's memory blocks.
+/// \param     t_Flags Storage for the image's flags.
+/// \param     t_SectorSize Storage for the target's sector size.
+/// \return    TBX_OK if the staged image is valid, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::stagedImageInfo(size_t& t_Len, uint8_t& t_Flags,
+                                   uint32_t& t_SectorSize)
+{
+  uint8_t result = TBX_ERROR;
+  std::array<uint8_t, c_StageHeaderLen> imageHeader;
+
+  // Read the header of the image and check its magic value and length.
+  if ((m_Storage.read(0U, imageHeader.data(), imageHeader.size()) == TBX_OK) &&
+      (loadLe32(&imageHeader[0]) == c_StageMagic))
+  {
+    t_Flags = static_cast<uint8_t>(loadLe32(&imageHeader[4]));
+    t_Len = loadLe32(&imageHeader[8]);
+    t_SectorSize = loadLe32(&imageHeader[12]);
+    if ((t_Len > 0U) && (t_Len <= (m_Storage.size() - c_StageHeaderLen)) &&
+        (((t_Flags & c_FlagDelta) == 0U) ||
+         (((t_Flags & c_FlagCompressed) == 0U) && (t_SectorSize != 0U) &&
+          ((t_SectorSize & (t_SectorSize - 1U)) == 0U))))
+    {
+      result = TBX_OK;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Walks through the memory blocks of the staged image and either erases or
+///            programs them on the target. Compressed memory blocks are decompressed on
+///            the fly, while programming them.
+/// \param     t_ImageLen Length of the image's memory blocks.
+/// \param     t_Flags The image's flags.
+/// \param     t_Program TBX_TRUE to program the memory blocks, TBX_FALSE to erase them.
+/// \param     t_Result Job result. Its address and status are updated.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::processStagedBlocks(size_t t_ImageLen, uint8_t t_Flags,
+                                       uint8_t t_Program, XcpLoaderResult& t_Result)
+{
+  uint8_t result = TBX_OK;
+  size_t offset = c_StageHeaderLen;
+  size_t endOffset = c_StageHeaderLen + t_ImageLen;
+
+  // Process the memory blocks, one at a time, until done or an error occurred.
+  while ((offset < endOffset) && (result == TBX_OK))
+  {
+    std::array<uint8_t, c_StageBlockHeaderLen> blockHeader;
+    size_t blockLen = 0U;
+    size_t storedLen = 0U;
+
+    // Read the header of the memory block.
+    result = TBX_ERROR;
+    if (((endOffset - offset) >= c_StageBlockHeaderLen) &&
+        (m_Storage.read(offset, blockHeader.data(), blockHeader.size()) == TBX_OK))
+    {
+      t_Result.address = loadLe32(&blockHeader[0]);
+      blockLen = loadLe32(&blockHeader[4]);
+      storedLen = loadLe32(&blockHeader[8]);
+      offset += c_StageBlockHeaderLen;
+      // Verify that the memory block fits in the image. Only the data of a compressed
+      // memory block is stored with a different length.
+      if ((blockLen > 0U) && (storedLen > 0U) && (storedLen <= (endOffset - offset)) &&
+          (((t_Flags & c_FlagCompressed) != 0U) || (storedLen == blockLen)))
+      {
+        result = TBX_OK;
+      }
+    }
+    // Staged image corrupt?
+    if (result != TBX_OK)
+    {
+      t_Result.status = STATUSSTORAGEERROR;
+    }
+    // Set the memory transfer address and erase or program the memory block.
+    else if (xcpSetMta(t_Result.address, t_Result) != TBX_OK)
+    {
+      result = TBX_ERROR;
+    }
+    else if ((t_Program == TBX_TRUE) && ((t_Flags & c_FlagCompressed) != 0U))
+    {
+      result = xcpProgramStagedCompressed(offset, storedLen, blockLen, t_Result);
+    }
+    else if (t_Program == TBX_TRUE)
+    {
+      result = xcpProgramStaged(offset, blockLen, t_Result);
+    }
+    else
+    {
+      result = xcpProgramClear(static_cast<uint32_t>(blockLen), t_Result);
+    }
+    // Continue with the next memory block.
+    offset += stageAlign(storedLen);
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Walks through the target sectors that the staged image covers. For each
+///            sector, it compares the staged data with the target's memory. It only
+///            erases and programs the sectors that differ. Note that the target's
+///            bootloader erases entire sectors, so all data of a differing sector is
+///            programmed again.
+/// \param     t_ImageLen Length of the image's memory blocks.
+/// \param     t_SectorSize The target's sector size. Must be a power of two.
+/// \param     t_Result Job result. Its address and status are updated.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::processDeltaSectors(size_t t_ImageLen, uint32_t t_SectorSize,
+                                       XcpLoaderResult& t_Result)
+{
+  uint8_t result = TBX_OK;
+  size_t endOffset = c_StageHeaderLen + t_ImageLen;
+  StagedCursor cursor{ c_StageHeaderLen, 0U };
+  uint32_t sectorCount = 0U;
+  uint32_t sectorsProgrammed = 0U;
+
+  // Process the target sectors, one at a time, until done or an error occurred.
+  while ((cursor.blockOffset < endOffset) && (result == TBX_OK))
+  {
+    StagedCursor sectorCursor = cursor;
+    uint32_t sectorBase = 0U;
+    uint32_t sectorStart = 0U;
+    uint32_t sectorEnd = 0U;
+    size_t pieceCount = 0U;
+    uint8_t sectorDone = TBX_FALSE;
+    uint8_t differs = TBX_FALSE;
+
+    // Compare the pieces of the staged image that lie in this sector. The memory
+    // blocks are in ascending order, so these pieces are consecutive.
+    while ((sectorDone == TBX_FALSE) && (result == TBX_OK))
+    {
+      StagedCursor pieceCursor = cursor;
+      StagedPiece piece;
+
+      // Reached the end of the image?
+      if (cursor.blockOffset >= endOffset)
+      {
+        sectorDone = TBX_TRUE;
+      }
+      // Staged image corrupt?
+      else if (nextStagedPiece(cursor, endOffset, t_SectorSize, piece) != TBX_OK)
+      {
+        t_Result.status = STATUSSTORAGEERROR;
+        result = TBX_ERROR;
+      }
+      // Piece already in the next sector? Then leave it for the next sector.
+      else if ((pieceCount > 0U) &&
+               ((piece.address & ~(t_SectorSize - 1U)) != sectorBase))
+      {
+        cursor = pieceCursor;
+        sectorDone = TBX_TRUE;
+      }
+      else
+      {
+        // Keep track of the range that the pieces span inside the sector.
+        if (pieceCount == 0U)
+        {
+          sectorBase = piece.address & ~(t_SectorSize - 1U);
+          sectorStart = piece.address;
+        }
+        sectorEnd = piece.address + static_cast<uint32_t>(piece.len);
+        pieceCount++;
+        // Compare the piece, unless a difference was already found.
+        if (differs == TBX_FALSE)
+        {
+          result = comparePiece(piece, differs, t_Result);
+        }
+      }
+    }
+    sectorCount++;
+    // Erase and program the sector, if it differs.
+    if ((result == TBX_OK) && (differs == TBX_TRUE))
+    {
+      t_Result.address = sectorStart;
+      result = xcpSetMta(sectorStart, t_Result);
+      if (result == TBX_OK)
+      {
+        result = xcpProgramClear(sectorEnd - sectorStart, t_Result);
+      }
+      // Program the pieces of the sector.
+      while ((pieceCount > 0U) && (result == TBX_OK))
+      {
+        StagedPiece piece;
+
+        (void)nextStagedPiece(sectorCursor, endOffset, t_SectorSize, piece);
+        t_Result.address = piece.address;
+        result = xcpSetMta(piece.address, t_Result);
+        if (result == TBX_OK)
+        {
+          result = xcpProgramStaged(piece.dataOffset, piece.len, t_Result);
+        }
+        pieceCount--;
+      }
+      sectorsProgrammed++;
+    }
+  }
+  // Log info.
+  if (result == TBX_OK)
+  {
+    logger().info("Loader programmed %u of %u sectors.", sectorsProgrammed,
+                  sectorCount);
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Obtains the next piece of the staged image, from the cursor up to the end
+///            of its memory block or the end of its target sector, whichever comes
+///            first. Advances the cursor past the piece.
+/// \param     t_Cursor Position in the staged image.
+/// \param     t_EndOffset Offset of the end of the image into the storage.
+/// \param     t_SectorSize The target's sector size. Must be a power of two.
+/// \param     t_Piece Storage for the piece.
+/// \return    TBX_OK if successful, TBX_ERROR if the staged image is corrupt.
+///
+///**************************************************************************************
+uint8_t XcpLoader::nextStagedPiece(StagedCursor& t_Cursor, size_t t_EndOffset,
+                                   uint32_t t_SectorSize, StagedPiece& t_Piece)
+{
+  uint8_t result = TBX_ERROR;
+  std::array<uint8_t, c_StageBlockHeaderLen> blockHeader;
+
+  // Read the header of the memory block at the cursor.
+  if (((t_EndOffset - t_Cursor.blockOffset) >= c_StageBlockHeaderLen) &&
+      (m_Storage.read(t_Cursor.blockOffset, blockHeader.data(),
+                      blockHeader.size()) == TBX_OK))
+  {
+    size_t blockLen = loadLe32(&blockHeader[4]);
+
+    // Verify that the memory block fits in the image and the cursor in the block.
+    if ((blockLen > t_Cursor.blockPos) &&
+        (blockLen <= (t_EndOffset - t_Cursor.blockOffset - c_StageBlockHeaderLen)))
+    {
+      uint32_t sectorLeft;
+
+      // Determine the piece.
+      t_Piece.address = loadLe32(&blockHeader[0]) +
+                        static_cast<uint32_t>(t_Cursor.blockPos);
+      t_Piece.dataOffset = t_Cursor.blockOffset + c_StageBlockHeaderLen +
+                           t_Cursor.blockPos;
+      t_Piece.len = blockLen - t_Cursor.blockPos;
+      sectorLeft = t_SectorSize - (t_Piece.address & (t_SectorSize - 1U));
+      if (t_Piece.len > sectorLeft)
+      {
+        t_Piece.len = sectorLeft;
+      }
+      // Advance the cursor, possibly to the next memory block.
+      t_Cursor.blockPos += t_Piece.len;
+      if (t_Cursor.blockPos == blockLen)
+      {
+        t_Cursor.blockOffset += c_StageBlockHeaderLen + stageAlign(blockLen);
+        t_Cursor.blockPos = 0U;
+      }
+      result = TBX_OK;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Compares a piece of the staged image with the target's memory. Preferably
+///            by letting the target build a checksum, which is then compared with the
+///            checksum of the staged data. Falls back to uploading the target's memory,
+///            if the target does not support the checksum or builds a type of checksum
+///            that cannot be trusted to detect a difference.
+/// \param     t_Piece The piece of the staged image.
+/// \param     t_Differs Storage for the outcome: TBX_TRUE if the piece differs,
+///            TBX_FALSE otherwise.
+/// \param     t_Result Job result. Its address and status are updated.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::comparePiece(StagedPiece const& t_Piece, uint8_t& t_Differs,
+                                XcpLoaderResult& t_Result)
+{
+  uint8_t result;
+  uint8_t compared = TBX_FALSE;
+
+  // Set the memory transfer address to the start of the piece.
+  t_Result.address = t_Piece.address;
+  result = xcpSetMta(t_Piece.address, t_Result);
+  // Let the target build a checksum, if supported.
+  if ((result == TBX_OK) && (m_ChecksumSupported == TBX_TRUE))
+  {
+    uint8_t checksumType = 0U;
+    uint32_t targetChecksum = 0U;
+    uint32_t stagedChecksum = 0U;
+
+    // Request the checksum from the target.
+    if (xcpBuildChecksum(static_cast<uint32_t>(t_Piece.len), checksumType,
+                         targetChecksum, t_Result) == TBX_OK)
+    {
+      // Compare it with the checksum of the staged data, if the type is supported.
+      if (stagedPieceChecksum(t_Piece, checksumType, stagedChecksum) == TBX_OK)
+      {
+        t_Differs = (targetChecksum != stagedChecksum) ? TBX_TRUE : TBX_FALSE;
+        compared = TBX_TRUE;
+      }
+      // The target always uses the same checksum type. Stop asking for it, if it is
+      // not one that can be trusted.
+      else
+      {
+        m_ChecksumSupported = TBX_FALSE;
+      }
+    }
+    // Target rejected the command? Then fall back to uploading.
+    else if (t_Result.status == STATUSXCPERROR)
+    {
+      // Stop asking for checksums, if the target does not know the command.
+      if (t_Result.xcpError == c_XcpErrCmdUnknown)
+      {
+        m_ChecksumSupported = TBX_FALSE;
+      }
+      t_Result.status = STATUSOK;
+      t_Result.xcpError = 0U;
+    }
+    else
+    {
+      result = TBX_ERROR;
+    }
+    // Set the memory transfer address again, for uploading.
+    if ((result == TBX_OK) && (compared == TBX_FALSE))
+    {
+      result = xcpSetMta(t_Piece.address, t_Result);
+    }
+  }
+  // Upload the target's memory and compare it with the staged data.
+  if ((result == TBX_OK) && (compared == TBX_FALSE))
+  {
+    result = xcpUploadCompare(t_Piece, t_Differs, t_Result);
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Calculates the checksum of a piece of the staged image, the same way as
+///            the target does for the XCP BUILD_CHECKSUM command. Only checksum type
+///            CRC-32 is supported. The additive checksum types do not detect swapped
+///            bytes or values and the shorter ones match by chance far too often. A
+///            matching checksum means that the sector is not programmed, so these
+///            cannot be trusted.
+/// \param     t_Piece The piece of the staged image.
+/// \param     t_Type The XCP checksum type.
+/// \param     t_Checksum Storage for the checksum.
+/// \return    TBX_OK if successful, TBX_ERROR if the checksum type is not supported or
+///            the staged data could not be read.
+///
+///**************************************************************************************
+uint8_t XcpLoader::stagedPieceChecksum(StagedPiece const& t_Piece, uint8_t t_Type,
+                                       uint32_t& t_Checksum)
+{
+  uint8_t result = TBX_ERROR;
+  uint32_t checksum = c_Crc32Initial;
+  size_t idx = 0U;
+
+  // Only continue with a supported checksum type.
+  if (t_Type == c_XcpChecksumCrc32)
+  {
+    result = TBX_OK;
+  }
+  // Calculate the checksum, one chunk at a time. The job data is not used by this job,
+  // so it serves as the buffer for the chunks.
+  while ((idx < t_Piece.len) && (result == TBX_OK))
+  {
+    size_t chunkLen = ((t_Piece.len - idx) < c_BlockSizeMax) ? (t_Piece.len - idx) :
+                      c_BlockSizeMax;
+
+    result = m_Storage.read(t_Piece.dataOffset + idx, m_JobData.data(), chunkLen);
+    checksum = crc32Update(checksum, m_JobData.data(), chunkLen);
+    idx += chunkLen;
+  }
+  // Store the checksum.
+  t_Checksum = checksum ^ c_Crc32Initial;
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Sends an XCP command packet to the target and waits for its response.
+/// \param     t_Cmd CAN message with the XCP command packet. Its identifier is set by
+///            this method.
+/// \param     t_TimeoutMs Maximum time in milliseconds to wait for the response.
+/// \param     t_Result Job result. Its status is updated in case of an error.
+/// \return    TBX_OK if the target responded positively, TBX_ERROR otherwise. The
+///            response is available in m_Response.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpCommand(CanMsg& t_Cmd, uint32_t t_TimeoutMs,
+                              XcpLoaderResult& t_Result)
+{
+  uint8_t result = TBX_ERROR;
+
+  // Set the CAN identifier of the XCP command packet.
+  t_Cmd.setId(m_CanIdToTarget);
+  t_Cmd.setExt(m_CanExtIds);
+  // Discard a response that possibly arrived after the previous command timed out.
+  (void)m_ResponseSemaphore.Take(0U);
+  // Place the XCP command packet on the CAN bus.
+  if (m_Can.transmit(t_Cmd) != TBX_OK)
+  {
+    t_Result.status = STATUSCANERROR;
+  }
+  // Wait for the response.
+  else if (!m_ResponseSemaphore.Take(cpp_freertos::Ticks::MsToTicks(t_TimeoutMs)))
+  {
+    t_Result.status = STATUSTIMEOUT;
+  }
+  else
+  {
+    uint8_t responsePid;
+    uint8_t responseErr;
+
+    // Read out the response.
+    TbxCriticalSectionEnter();
+    responsePid = m_Response[0];
+    responseErr = m_Response[1];
+    TbxCriticalSectionExit();
+    // Evaluate the response.
+    if (responsePid == c_XcpPidResponse)
+    {
+      result = TBX_OK;
+    }
+    else
+    {
+      t_Result.status = STATUSXCPERROR;
+      t_Result.xcpError = (responsePid == c_XcpPidError) ? responseErr : 0U;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Connects to the target. Retransmits the XCP Connect command until the
+///            target responds, for at most c_ConnectWindowMs. This gives the target
+///            time to power up or reset into its bootloader.
+/// \param     t_Result Job result. Its status is updated in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpConnect(XcpLoaderResult& t_Result)
+{
+  constexpr uint32_t attemptsMax = c_ConnectWindowMs / c_XcpTimeoutT6Ms;
+  uint8_t result = TBX_ERROR;
+  uint32_t attempts = 0U;
+
+  // While connecting, unacknowledged frames are expected.
+  m_Connecting = TBX_TRUE;
+  // Retransmit the XCP Connect command until the target responds.
+  while ((result != TBX_OK) && (attempts < attemptsMax))
+  {
+    CanMsg xcpCmd(m_CanIdToTarget, m_CanExtIds, 2U, { c_XcpCmdConnect, 0U });
+
+    // The CAN controller keeps retransmitting an unacknowledged frame by itself, until
+    // its transmit deadline. Only transmit again, once it is done with it.
+    if (m_Can.txPendingCount() == 0U)
+    {
+      t_Result.status = STATUSOK;
+      t_Result.xcpError = 0U;
+      result = xcpCommand(xcpCmd, c_XcpTimeoutT6Ms, t_Result);
+    }
+    else
+    {
+      Delay(cpp_freertos::Ticks::MsToTicks(c_XcpTimeoutT6Ms));
+    }
+    attempts++;
+  }
+  m_Connecting = TBX_FALSE;
+  // Connected?
+  if (result == TBX_OK)
+  {
+    uint8_t commModeBasic;
+
+    // Read out the byte order of the target from the response.
+    TbxCriticalSectionEnter();
+    commModeBasic = m_Response[2];
+    TbxCriticalSectionExit();
+    m_Motorola = ((commModeBasic & c_XcpCommModeMotorola) != 0U) ? TBX_TRUE : TBX_FALSE;
+    // Assume that the target supports the PROGRAM_MAX and BUILD_CHECKSUM commands,
+    // until proven otherwise.
+    m_ProgramMaxSupported = TBX_TRUE;
+    m_ChecksumSupported = TBX_TRUE;
+  }
+  // Not a single attempt was transmitted?
+  else if (t_Result.status == STATUSOK)
+  {
+    t_Result.status = STATUSTIMEOUT;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Starts the programming session on the target.
+/// \param     t_Result Job result. Its status is updated in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpProgramStart(XcpLoaderResult& t_Result)
+{
+  CanMsg xcpCmd(m_CanIdToTarget, m_CanExtIds, 1U, { c_XcpCmdProgramStart });
+
+  // Send the command packet and give the result back to the caller.
+  return xcpCommand(xcpCmd, c_XcpTimeoutT3Ms, t_Result);
+}
+
+
+///**************************************************************************************
+/// \brief     Erases memory on the target, starting at the current memory transfer
+///            address.
+/// \param     t_Len Number of bytes to erase.
+/// \param     t_Result Job result. Its status is updated in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpProgramClear(uint32_t t_Len, XcpLoaderResult& t_Result)
+{
+  CanMsg xcpCmd(m_CanIdToTarget, m_CanExtIds, 8U, { c_XcpCmdProgramClear });
+
+  // Construct the command packet. The clear mode (byte 1) is always 0 for an absolute
+  // access mode.
+  storeValue(&xcpCmd.data()[4], t_Len);
+  // Send the command packet and give the result back to the caller.
+  return xcpCommand(xcpCmd, c_XcpTimeoutT4Ms, t_Result);
+}
+
+
+///**************************************************************************************
+/// \brief     Sets the memory transfer address (MTA) on the target.
+/// \param     t_Address Memory address.
+/// \param     t_Result Job result. Its status is updated in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpSetMta(uint32_t t_Address, XcpLoaderResult& t_Result)
+{
+  CanMsg xcpCmd(m_CanIdToTarget, m_CanExtIds, 8U, { c_XcpCmdSetMta });
+
+  // Construct the command packet. The address extension (byte 3) is always 0.
+  storeValue(&xcpCmd.data()[4], t_Address);
+  // Send the command packet and give the result back to the caller.
+  return xcpCommand(xcpCmd, c_XcpTimeoutT1Ms, t_Result);
+}
+
+
+///**************************************************************************************
+/// \brief     Programs data on the target, starting at the current memory transfer
+///            address. Full packets go out with the PROGRAM_MAX command and the
+///            remainder with the PROGRAM command. Should the target not support the
+///            PROGRAM_MAX command, it falls back to just the PROGRAM command.
+/// \param     t_Data Byte array with the data to program.
+/// \param     t_Len Number of bytes to program.
+/// \param     t_Result Job result. Its address is updated with each programmed packet
+///            and its status in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpProgram(uint8_t const t_Data[], size_t t_Len,
+                              XcpLoaderResult& t_Result)
+{
+  constexpr size_t programMaxLen = CanMsg::c_DataLenMax - 1U;
+  constexpr size_t programLenMax = CanMsg::c_DataLenMax - 2U;
+  uint8_t result = TBX_OK;
+  size_t idx = 0U;
+
+  // Program the data, one packet at a time, until done or an error occurred.
+  while ((idx < t_Len) && (result == TBX_OK))
+  {
+    CanMsg xcpCmd;
+    uint8_t packetLen;
+
+    // Construct a PROGRAM_MAX command packet, if possible.
+    if ((m_ProgramMaxSupported == TBX_TRUE) && ((t_Len - idx) >= programMaxLen))
+    {
+      packetLen = programMaxLen;
+      xcpCmd.setLen(CanMsg::c_DataLenMax);
+      xcpCmd[0] = c_XcpCmdProgramMax;
+      for (uint8_t byteIdx = 0U; byteIdx < packetLen; byteIdx++)
+      {
+        xcpCmd[byteIdx + 1U] = t_Data[idx + byteIdx];
+      }
+    }
+    // Construct a PROGRAM command packet otherwise.
+    else
+    {
+      packetLen = static_cast<uint8_t>(((t_Len - idx) < programLenMax) ?
+                                       (t_Len - idx) : programLenMax);
+      xcpCmd.setLen(packetLen + 2U);
+      xcpCmd[0] = c_XcpCmdProgram;
+      xcpCmd[1] = packetLen;
+      for (uint8_t byteIdx = 0U; byteIdx < packetLen; byteIdx++)
+      {
+        xcpCmd[byteIdx + 2U] = t_Data[idx + byteIdx];
+      }
+    }
+    // Send the command packet.
+    result = xcpCommand(xcpCmd, c_XcpTimeoutT5Ms, t_Result);
+    if (result == TBX_OK)
+    {
+      // Continue with the next packet.
+      idx += packetLen;
+      t_Result.address += packetLen;
+    }
+    // Target does not know the PROGRAM_MAX command? Then retry with just the PROGRAM
+    // command.
+    else if ((xcpCmd[0] == c_XcpCmdProgramMax) &&
+             (t_Result.status == STATUSXCPERROR) &&
+             (t_Result.xcpError == c_XcpErrCmdUnknown))
+    {
+      m_ProgramMaxSupported = TBX_FALSE;
+      t_Result.status = STATUSOK;
+      t_Result.xcpError = 0U;
+      result = TBX_OK;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+///**************************************************************************************
+/// \brief     Programs data from the staged image on the target, starting at the
+///            current memory transfer address.
+/// \param     t_Offset Offset of the data into the storage.
+/// \param     t_Len Number of bytes to program.
+/// \param     t_Result Job result. Its address is updated with each programmed packet
+///            and its status in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpProgramStaged(size_t t_Offset, size_t t_Len,
+                                    XcpLoaderResult& t_Result)
+{
+  uint8_t result = TBX_OK;
+  size_t idx = 0U;
+
+  // Program the data, one chunk at a time, until done or an error occurred. The job
+  // data is not used by this job, so it serves as the buffer for the chunks.
+  while ((idx < t_Len) && (result == TBX_OK))
+  {
+    size_t chunkLen = ((t_Len - idx) < c_BlockSizeMax) ? (t_Len - idx) : c_BlockSizeMax;
+
+    // Read the chunk from the storage.
+    if (m_Storage.read(t_Offset + idx, m_JobData.data(), chunkLen) != TBX_OK)
+    {
+      t_Result.status = STATUSSTORAGEERROR;
+      result = TBX_ERROR;
+    }
+    // Program the chunk.
+    else
+    {
+      result = xcpProgram(m_JobData.data(), chunkLen, t_Result);
+      idx += chunkLen;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Programs a compressed memory block from the staged image on the target,
+///            starting at the current memory transfer address. The memory block is
+///            decompressed on the fly.
+/// \param     t_Offset Offset of the compressed stream into the storage.
+/// \param     t_StoredLen Number of bytes of the compressed stream.
+/// \param     t_Len Number of bytes of the memory block, once decompressed.
+/// \param     t_Result Job result. Its address is updated with each programmed packet
+///            and its status in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpProgramStagedCompressed(size_t t_Offset, size_t t_StoredLen,
+                                              size_t t_Len, XcpLoaderResult& t_Result)
+{
+  uint8_t result = TBX_OK;
+  size_t idx = 0U;
+
+  // Decompress and program the compressed stream, one chunk at a time, until done or
+  // an error occurred. The job data is not used by this job, so it serves as the
+  // buffer for the chunks.
+  decompressStart();
+  while ((idx < t_StoredLen) && (result == TBX_OK))
+  {
+    size_t chunkLen = ((t_StoredLen - idx) < c_BlockSizeMax) ? (t_StoredLen - idx) :
+                      c_BlockSizeMax;
+
+    // Read the chunk from the storage.
+    if (m_Storage.read(t_Offset + idx, m_JobData.data(), chunkLen) != TBX_OK)
+    {
+      t_Result.status = STATUSSTORAGEERROR;
+      result = TBX_ERROR;
+    }
+    // Decompress and program the chunk.
+    else
+    {
+      result = xcpProgramDecompressed(m_JobData.data(), chunkLen, t_Result);
+      idx += chunkLen;
+    }
+  }
+  // Program the remaining decompressed data.
+  if (result == TBX_OK)
+  {
+    result = xcpProgramDecompressedEnd(t_Result);
+  }
+  // The compressed stream should hold exactly the data of the memory block.
+  if ((result == TBX_OK) && (m_DecompressTotal != t_Len))
+  {
+    t_Result.status = STATUSSTORAGEERROR;
+    result = TBX_ERROR;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Prepares for programming a new compressed stream with
+///            xcpProgramDecompressed().
+///
+///**************************************************************************************
+void XcpLoader::decompressStart()
+{
+  m_Decompressor.reset();
+  m_DecompressLen = 0U;
+  m_DecompressTotal = 0U;
+}
+
+
+///**************************************************************************************
+/// \brief     Decompresses a part of a compressed stream and programs the decompressed
+///            data on the target, starting at the current memory transfer address. The
+///            decompressed data is collected in a buffer that holds a multiple of the
+///            PROGRAM_MAX command's data, such that the stream is programmed with full
+///            packets, regardless of how it is split up into parts. Call
+///            xcpProgramDecompressedEnd() after the last part.
+/// \param     t_Data Byte array with the part of the compressed stream.
+/// \param     t_Len Number of bytes of the part.
+/// \param     t_Result Job result. Its address is updated with each programmed packet
+///            and its status in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpProgramDecompressed(uint8_t const t_Data[], size_t t_Len,
+                                          XcpLoaderResult& t_Result)
+{
+  uint8_t result = TBX_OK;
+  uint8_t dataLeft = TBX_TRUE;
+
+  // Decompress the part and program the buffer each time it is full, until the part is
+  // used up or an error occurred.
+  m_Decompressor.feed(t_Data, t_Len);
+  while ((dataLeft == TBX_TRUE) && (result == TBX_OK))
+  {
+    size_t outLen = m_Decompressor.poll(&m_DecompressBuf[m_DecompressLen],
+                                        m_DecompressBuf.size() - m_DecompressLen);
+
+    m_DecompressLen += outLen;
+    m_DecompressTotal += outLen;
+    // Part used up?
+    if (outLen == 0U)
+    {
+      dataLeft = TBX_FALSE;
+    }
+    // Program the buffer once it is full.
+    else if (m_DecompressLen == m_DecompressBuf.size())
+    {
+      result = xcpProgram(m_DecompressBuf.data(), m_DecompressLen, t_Result);
+      m_DecompressLen = 0U;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Programs the decompressed data that is still in the buffer, after the
+///            last part of the compressed stream was passed to xcpProgramDecompressed().
+/// \param     t_Result Job result. Its address is updated with each programmed packet
+///            and its status in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpProgramDecompressedEnd(XcpLoaderResult& t_Result)
+{
+  uint8_t result = TBX_OK;
+
+  // Program the remaining decompressed data, if any.
+  if (m_DecompressLen > 0U)
+  {
+    result = xcpProgram(m_DecompressBuf.data(), m_DecompressLen, t_Result);
+    m_DecompressLen = 0U;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Determines the length of the data in a compressed stream, by
+///            decompressing it and discarding the decompressed data.
+/// \param     t_Data Byte array with the compressed stream.
+/// \param     t_Len Number of bytes of the compressed stream.
+/// \return    Number of bytes of the decompressed data.
+///
+///**************************************************************************************
+size_t XcpLoader::decompressedLen(uint8_t const t_Data[], size_t t_Len)
+{
+  size_t result = 0U;
+  size_t outLen = m_DecompressBuf.size();
+
+  // Decompress the stream, one buffer at a time, until it is used up.
+  m_Decompressor.reset();
+  m_Decompressor.feed(t_Data, t_Len);
+  while (outLen > 0U)
+  {
+    outLen = m_Decompressor.poll(m_DecompressBuf.data(), m_DecompressBuf.size());
+    result += outLen;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Ends the programming session on the target, with a PROGRAM command that
+///            holds no data.
+/// \param     t_Result Job result. Its status is updated in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpProgramEnd(XcpLoaderResult& t_Result)
+{
+  CanMsg xcpCmd(m_CanIdToTarget, m_CanExtIds, 2U, { c_XcpCmdProgram, 0U });
+
+  // Send the command packet and give the result back to the caller.
+  return xcpCommand(xcpCmd, c_XcpTimeoutT5Ms, t_Result);
+}
+
+
+///**************************************************************************************
+/// \brief     Resets the target. The target possibly resets before it responds, so a
+///            missing response is not an error.
+/// \param     t_Result Job result. Its status is updated in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpProgramReset(XcpLoaderResult& t_Result)
+{
+  CanMsg xcpCmd(m_CanIdToTarget, m_CanExtIds, 1U, { c_XcpCmdProgramReset });
+  uint8_t result;
+
+  // Send the command packet.
+  result = xcpCommand(xcpCmd, c_XcpTimeoutT5Ms, t_Result);
+  // Ignore a missing response.
+  if ((result != TBX_OK) && (t_Result.status == STATUSTIMEOUT))
+  {
+    t_Result.status = STATUSOK;
+    result = TBX_OK;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Lets the target build a checksum over its memory, starting at the current
+///            memory transfer address.
+/// \param     t_Len Number of bytes to build the checksum over.
+/// \param     t_Type Storage for the XCP checksum type that the target used.
+/// \param     t_Checksum Storage for the checksum.
+/// \param     t_Result Job result. Its status is updated in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpBuildChecksum(uint32_t t_Len, uint8_t& t_Type, uint32_t& t_Checksum,
+                                    XcpLoaderResult& t_Result)
+{
+  CanMsg xcpCmd(m_CanIdToTarget, m_CanExtIds, 8U, { c_XcpCmdBuildChecksum });
+  uint8_t result;
+
+  // Construct the command packet.
+  storeValue(&xcpCmd.data()[4], t_Len);
+  // Send the command packet.
+  result = xcpCommand(xcpCmd, c_XcpTimeoutT2Ms, t_Result);
+  // Read out the checksum type and the checksum from the response.
+  if (result == TBX_OK)
+  {
+    TbxCriticalSectionEnter();
+    t_Type = m_Response[1];
+    t_Checksum = loadValue(&m_Response.data()[4], 4U);
+    TbxCriticalSectionExit();
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Uploads the target's memory of a piece of the staged image and compares
+///            it with the staged data. Stops at the first difference.
+/// \param     t_Piece The piece of the staged image. The memory transfer address should
+///            already be set to its start.
+/// \param     t_Differs Storage for the outcome: TBX_TRUE if the piece differs,
+///            TBX_FALSE otherwise.
+/// \param     t_Result Job result. Its status is updated in case of an error.
+/// \return    TBX_OK if successful, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpUploadCompare(StagedPiece const& t_Piece, uint8_t& t_Differs,
+                                    XcpLoaderResult& t_Result)
+{
+  constexpr size_t uploadLenMax = CanMsg::c_DataLenMax - 1U;
+  uint8_t result = TBX_OK;
+  size_t idx = 0U;
+
+  // Upload the data, one packet at a time, until done, a difference was found or an
+  // error occurred.
+  t_Differs = TBX_FALSE;
+  while ((idx < t_Piece.len) && (t_Differs == TBX_FALSE) && (result == TBX_OK))
+  {
+    uint8_t packetLen = static_cast<uint8_t>(((t_Piece.len - idx) < uploadLenMax) ?
+                                             (t_Piece.len - idx) : uploadLenMax);
+    CanMsg xcpCmd(m_CanIdToTarget, m_CanExtIds, 2U, { c_XcpCmdUpload, packetLen });
+    std::array<uint8_t, uploadLenMax> stagedData;
+
+    // Send the command packet and read the staged data to compare with.
+    result = xcpCommand(xcpCmd, c_XcpTimeoutT1Ms, t_Result);
+    if ((result == TBX_OK) &&
+        (m_Storage.read(t_Piece.dataOffset + idx, stagedData.data(),
+                        packetLen) != TBX_OK))
+    {
+      t_Result.status = STATUSSTORAGEERROR;
+      result = TBX_ERROR;
+    }
+    // Compare the uploaded data with the staged data.
+    if (result == TBX_OK)
+    {
+      CanMsg response;
+
+      TbxCriticalSectionEnter();
+      response = m_Response;
+      TbxCriticalSectionExit();
+      // A response that is too short counts as a difference.
+      if (response.len() < (packetLen + 1U))
+      {
+        t_Differs = TBX_TRUE;
+      }
+      for (uint8_t byteIdx = 0U; byteIdx < packetLen; byteIdx++)
+      {
+        if (response[byteIdx + 1U] != stagedData[byteIdx])
+        {
+          t_Differs = TBX_TRUE;
+        }
+      }
+      idx += packetLen;
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Uploads a memory range from the target, starting at the current memory
+///            transfer address, and checks each segment against its CRC-32. Stops at
+///            the first segment that differs.
+/// \param     t_Len Number of bytes of the memory range.
+/// \param     t_SegmentLen Number of bytes of a segment.
+/// \param     t_SegmentCrcs Byte array with the CRC-32 of each segment, in little
+///            endian byte order.
+/// \param     t_Result Job result. Its address should hold the start of the memory
+///            range. Upon completion, it holds the end of the memory range. Upon a
+///            mismatch, it holds the start of the segment and its status is set to
+///            STATUSMISMATCH.
+/// \return    TBX_OK if the memory range matches, TBX_ERROR otherwise.
+///
+///**************************************************************************************
+uint8_t XcpLoader::xcpUploadVerify(uint32_t t_Len, uint32_t t_SegmentLen,
+                                   uint8_t const t_SegmentCrcs[],
+                                   XcpLoaderResult& t_Result)
+{
+  constexpr size_t uploadLenMax = CanMsg::c_DataLenMax - 1U;
+  uint8_t result = TBX_OK;
+  uint32_t startAddress = t_Result.address;
+  uint32_t idx = 0U;
+  uint32_t segmentStart = 0U;
+  uint32_t segmentEnd = (t_Len < t_SegmentLen) ? t_Len : t_SegmentLen;
+  size_t segmentIdx = 0U;
+  uint32_t crc = c_Crc32Initial;
+
+  // Upload the memory range, one packet at a time, until done, a segment differs or an
+  // error occurred.
+  while ((idx < t_Len) && (result == TBX_OK))
+  {
+    uint8_t packetLen = static_cast<uint8_t>(((segmentEnd - idx) < uploadLenMax) ?
+                                             (segmentEnd - idx) : uploadLenMax);
+    CanMsg xcpCmd(m_CanIdToTarget, m_CanExtIds, 2U, { c_XcpCmdUpload, packetLen });
+
+    // Send the command packet.
+    result = xcpCommand(xcpCmd, c_XcpTimeoutT1Ms, t_Result);
+    if (result == TBX_OK)
+    {
+      CanMsg response;
+
+      // Add the uploaded data to the CRC-32 of the segment.
+      TbxCriticalSectionEnter();
+      response = m_Response;
+      TbxCriticalSectionExit();
+      crc = crc32Update(crc, &response.data()[1], packetLen);
+      idx += packetLen;
+      // A response that is too short or a segment with a different CRC-32 counts as a
+      // mismatch.
+      if ((response.len() < (packetLen + 1U)) ||
+          ((idx == segmentEnd) &&
+           ((crc ^ c_Crc32Initial) != loadLe32(&t_SegmentCrcs[segmentIdx * 4U]))))
+      {
+        t_Result.status = STATUSMISMATCH;
+        t_Result.address = startAddress + segmentStart;
+        result = TBX_ERROR;
+      }
+      // Reached the end of the segment? Then continue with the next segment.
+      else if (idx == segmentEnd)
+      {
+        segmentIdx++;
+        segmentStart = segmentEnd;
+        segmentEnd = ((t_Len - segmentEnd) < t_SegmentLen) ? t_Len :
+                     (segmentEnd + t_SegmentLen);
+        crc = c_Crc32Initial;
+      }
+    }
+  }
+  // Report the end of the memory range, if it matches.
+  if (result == TBX_OK)
+  {
+    t_Result.address = startAddress + t_Len;
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Stores a 32-bit value in the byte order of the target.
+/// \param     t_Dest Byte array where the four bytes of the value should be stored.
+/// \param     t_Value The value to store.
+///
+///**************************************************************************************
+void XcpLoader::storeValue(uint8_t t_Dest[], uint32_t t_Value) const
+{
+  // Store the value in Motorola (big endian) byte order?
+  if (m_Motorola == TBX_TRUE)
+  {
+    t_Dest[0] = static_cast<uint8_t>(t_Value >> 24U);
+    t_Dest[1] = static_cast<uint8_t>(t_Value >> 16U);
+    t_Dest[2] = static_cast<uint8_t>(t_Value >> 8U);
+    t_Dest[3] = static_cast<uint8_t>(t_Value);
+  }
+  // Store the value in Intel (little endian) byte order.
+  else
+  {
+    t_Dest[0] = static_cast<uint8_t>(t_Value);
+    t_Dest[1] = static_cast<uint8_t>(t_Value >> 8U);
+    t_Dest[2] = static_cast<uint8_t>(t_Value >> 16U);
+    t_Dest[3] = static_cast<uint8_t>(t_Value >> 24U);
+  }
+}
+
+
+///**************************************************************************************
+/// \brief     Loads a value that is stored in the byte order of the target.
+/// \param     t_Src Byte array with the bytes of the value.
+/// \param     t_Size Number of bytes of the value [1..4].
+/// \return    The value.
+///
+///**************************************************************************************
+uint32_t XcpLoader::loadValue(uint8_t const t_Src[], size_t t_Size) const
+{
+  uint32_t result = 0U;
+
+  // Assemble the value, one byte at a time.
+  for (size_t idx = 0U; idx < t_Size; idx++)
+  {
+    // Stored in Motorola (big endian) byte order?
+    if (m_Motorola == TBX_TRUE)
+    {
+      result = (result << 8U) | t_Src[idx];
+    }
+    // Stored in Intel (little endian) byte order.
+    else
+    {
+      result |= static_cast<uint32_t>(t_Src[idx]) << (8U * idx);
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+
+///**************************************************************************************
+/// \brief     Loads a 32-bit value that is stored in little endian byte order.
+/// \param     t_Src Byte array with the four bytes of the value.
+/// \return    The value.
+///
+///**************************************************************************************
+uint32_t XcpLoader::loadLe32(uint8_t const t_Src[])
+{
+  return static_cast<uint32_t>(t_Src[0])         |
+         (static_cast<uint32_t>(t_Src[1]) << 8U)  |
+         (static_cast<uint32_t>(t_Src[2]) << 16U) |
+         (static_cast<uint32_t>(t_Src[3]) << 24U);
+}
+
+
+///**************************************************************************************
+/// \brief     Stores a 32-bit value in little endian byte order.
+/// \param     t_Dest Byte array where the four bytes of the value should be stored.
+/// \param     t_Value The value to store.
+///
+///**************************************************************************************
+void XcpLoader::storeLe32(uint8_t t_Dest[], uint32_t t_Value)
+{
+  t_Dest[0] = static_cast<uint8_t>(t_Value);
+  t_Dest[1] = static_cast<uint8_t>(t_Value >> 8U);
+  t_Dest[2] = static_cast<uint8_t>(t_Value >> 16U);
+  t_Dest[3] = static_cast<uint8_t>(t_Value >> 24U);
+}
+
+
+///**************************************************************************************
+/// \brief     Rounds a length up to the write alignment of the storage.
+/// \param     t_Len The length.
+/// \return    The aligned length.
+///
+///**************************************************************************************
+size_t XcpLoader::stageAlign(size_t t_Len)
+{
+  return (t_Len + (Storage::c_WriteAlign - 1U)) & ~(Storage::c_WriteAlign - 1U);
+}
+
+
+///**************************************************************************************
+/// \brief     Adds data to a CRC-32. This is the common CRC-32, as used by Ethernet and
+///            zlib. Start with c_Crc32Initial and invert the outcome after the last
+///            data.
+/// \param     t_Crc The CRC-32 so far.
+/// \param     t_Data Byte array with the data.
+/// \param     t_Len Number of bytes of data.
+/// \return    The updated CRC-32.
+///
+///**************************************************************************************
+uint32_t XcpLoader::crc32Update(uint32_t t_Crc, uint8_t const t_Data[], size_t t_Len)
+{
+  uint32_t result = t_Crc;
+
+  // Process the data, one bit at a time, least significant bit first.
+  for (size_t idx = 0U; idx < t_Len; idx++)
+  {
+    result ^= t_Data[idx];
+    for (uint8_t bitIdx = 0U; bitIdx < 8U; bitIdx++)
+    {
+      result = ((result & 1U) != 0U) ? ((result >> 1U) ^ c_Crc32Polynomial) :
+               (result >> 1U);
+    }
+  }
+  // Give the result back to the caller.
+  return result;
+}
+
+//********************************** end of xcploader.cpp *******************************
@@ -0,0 +1,299 @@
+///**************************************************************************************
+/// \file         xcploader.hpp
+/// \brief        XCP loader header file.
+/// \internal
+///--------------------------------------------------------------------------------------
+///                          C O P Y R I G H T
+///--------------------------------------------------------------------------------------
+///   Copyright (c) 2023 by Feaser     www.feaser.com     All rights reserved
+///
+///--------------------------------------------------------------------------------------
+///                            L I C E N S E
+///--------------------------------------------------------------------------------------
+///
+/// SPDX-License-Identifier: MIT
+///
+/// Permission is hereby granted, free of charge, to any person obtaining a copy
+/// of this software and associated documentation files (the "Software"), to deal
+/// in the Software without restriction, including without limitation the rights
+/// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+/// copies of the Software, and to permit persons to whom the Software is
+/// furnished to do so, subject to the following conditions:
+///
+/// The above copyright notice and this permission notice shall be included in all
+/// copies or substantial portions of the Software.
+///
+/// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+/// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+/// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+/// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+/// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+/// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+/// SOFTWARE.
+///
+/// \endinternal
+///**************************************************************************************
+#ifndef XCPLOADER_HPP
+#define XCPLOADER_HPP
+
+//***************************************************************************************
+// Include files
+//***************************************************************************************
+#include <cstdint>
+#include <array>
+#include <functional>
+#include "can.hpp"
+#include "storage.hpp"
+#include "decompressor.hpp"
+#include "thread.hpp"
+#include "semaphore.hpp"
+#include "microtbx.h"
+
+
+//***************************************************************************************
+// Class definitions
+//***************************************************************************************
+/// \brief   XCP loader job result class.
+/// \details Intentionally kept trivially copyable.
+class XcpLoaderResult
+{
+public:
+  // Members.
+  uint8_t command;  ///< Command of the job.
+  uint8_t origin;   ///< Origin of the job, one of XcpLoader::Origin.
+  uint8_t status;   ///< Job status, one of XcpLoader::Status.
+  uint8_t xcpError; ///< XCP error code, in case the target responded with an error.
+  uint32_t address; ///< Memory address where the job ended or failed.
+};
+
+
+/// \brief   XCP loader class.
+/// \details Runs XCP programming jobs on the target, on behalf of the host. It acts as
+///          the XCP master on the CAN bus, such that the USB round trip per XCP packet
+///          disappears from the critical path. The gateway fills in the job data
+///          with jobData() and starts the job with submit(). While the job runs, the
+///          gateway routes the target's XCP response packets to processResponse().
+///          Once done, the loader calls the onJobDone event handler from its own task.
+///          The result holds the origin that was passed to submit(). The loader is
+///          already ready for the next job at this point, so the event handler should
+///          decide on whom to report to based on the result only.
+///          A caller that fills in the job data over time, first reserves the loader
+///          with claim(). Until its next submit() or release(), the loader rejects
+///          jobs from any other origin, such that these cannot overwrite the job data.
+///          Job BULKDOWNLOAD programs a memory block on the target. Its job data holds
+///          a flags byte, the 32-bit start address in little endian byte order and
+///          the data to program. Flag c_FlagMotorola indicates that the target
+///          expects multi-byte values in Motorola byte order. With flag
+///          c_FlagCompressed, the data is a compressed stream that the loader
+///          decompresses while programming. The host should already have connected to
+///          the target and started the programming session.
+///          Jobs STAGEERASE, STAGEWRITE and STAGECOMMIT stage a firmware image for the
+///          target in the storage. STAGEERASE erases the storage and starts a new
+///          image. Its job data optionally holds flags. With flag c_FlagCompressed,
+///          the memory blocks of the image are staged as compressed streams. This way
+///          larger images fit in the storage. Erasing the storage can take seconds
+///          and stall the CPU, so do not count on the gateway forwarding traffic
+///          during a STAGEERASE. Each STAGEWRITE appends a memory block.
+///          Its job data holds the 32-bit start address in little endian byte order
+///          and the data, which is a compressed stream for a compressed image.
+///          STAGECOMMIT completes the image. Only then does the image become valid. Its
+///          job data optionally holds flags and the target's sector size. These jobs
+///          report the number of used bytes in the storage as the result's address.
+///          Job STANDALONE programs the staged image on the target, without the host.
+///          It connects to the target, starts the programming session, erases and
+///          programs all memory blocks, ends the programming session and resets the
+///          target. It takes the target's byte order from the XCP Connect response.
+///          With flag c_FlagDelta set upon STAGECOMMIT, it first compares each target
+///          sector with the staged image and only erases and programs the sectors
+///          that differ. It compares with the XCP BUILD_CHECKSUM command, but only if
+///          the target builds a CRC-32. Otherwise it compares by uploading the
+///          target's memory. An additive checksum does not detect swapped bytes or
+///          values and a short one often matches by chance, so it could leave a
+///          changed sector unprogrammed. Flag c_FlagDelta is not supported for a
+///          compressed image.
+///          Job VERIFY checks a memory range on the target against CRC-32 values from
+///          the host, without a USB round trip per XCP packet. Its job data holds a
+///          flags byte, the 32-bit start address, the length and the segment length,
+///          followed by the CRC-32 of each segment. All 32-bit values are in little
+///          endian byte order. The loader uploads the memory range and ends with
+///          STATUSMISMATCH at the start address of the first segment that differs.
+///          The host should already have connected to the target.
+class XcpLoader : public cpp_freertos::Thread
+{
+public:
+  // Enumerations.
+  enum Command : uint8_t
+  {
+    BULKDOWNLOAD = 0x01U, ///< Program a memory block on the target.
+    STAGEERASE = 0x02U,   ///< Erase the storage and start staging a new image.
+    STAGEWRITE = 0x03U,   ///< Append a memory block to the staged image.
+    STAGECOMMIT = 0x04U,  ///< Complete the staged image.
+    STANDALONE = 0x05U,   ///< Program the staged image on the target.
+    VERIFY = 0x06U        ///< Verify a memory range on the target.
+  };
+  enum Origin : uint8_t
+  {
+    ORIGINHOST = 0U,      ///< Job submitted by the host with an adapter command.
+    ORIGINAPP             ///< Job submitted by the application itself.
+  };
+  enum Status : uint8_t
+  {
+    STATUSOK = 0U,        ///< Job completed successfully.
+    STATUSBUSY,           ///< Job rejected, because another one is still running.
+    STATUSINVALID,        ///< Job rejected, because of invalid job data.
+    STATUSTIMEOUT,        ///< Target did not respond in time.
+    STATUSXCPERROR,       ///< Target responded with an XCP error packet.
+    STATUSCANERROR,       ///< Could not submit an XCP packet for transmission on CAN.
+    STATUSSTORAGEERROR,   ///< Could not access the staged image in the storage.
+    STATUSMISMATCH        ///< Target's memory differs from the expected data.
+  };
+  // Constants.
+  static constexpr size_t c_BlockSizeMax = 4096U;
+  static constexpr size_t c_JobDataSizeMax = c_BlockSizeMax + 5U;
+  static constexpr uint8_t c_FlagMotorola = 0x01U;
+  static constexpr uint8_t c_FlagDelta = 0x02U;
+  static constexpr uint8_t c_FlagCompressed = 0x04U;
+  // Constructors and destructor.
+  explicit XcpLoader(Can& t_Can, Storage& t_Storage, uint8_t t_CanExtIds,
+                     uint32_t t_CanIdToTarget);
+  virtual ~XcpLoader() { }
+  // Methods.
+  uint8_t submit(uint8_t t_Command, size_t t_Len, uint8_t t_Origin);
+  uint8_t claim(uint8_t t_Origin);
+  void release();
+  void processResponse(CanMsg const& t_Msg);
+  // Getters and setters.
+  uint8_t* jobData() { return m_JobData.data(); }
+  uint8_t busy() const { return m_Busy; }
+  uint8_t claimed() const { return m_Claimed; }
+  uint8_t connecting() const { return m_Connecting; }
+  // Events.
+  std::function<void(XcpLoaderResult const& t_Result)> onJobDone;
+
+private:
+  // Classes.
+  /// \brief Piece of the staged image that lies inside one target sector.
+  class StagedPiece
+  {
+  public:
+    // Members.
+    uint32_t address;  ///< Memory address on the target.
+    size_t dataOffset; ///< Offset of the piece's data into the storage.
+    size_t len;        ///< Number of bytes.
+  };
+  /// \brief Position inside the staged image.
+  class StagedCursor
+  {
+  public:
+    // Members.
+    size_t blockOffset; ///< Offset of the memory block's header into the storage.
+    size_t blockPos;    ///< Position inside the memory block's data.
+  };
+  // Constants.
+  static constexpr uint32_t c_StageMagic = 0x49534643UL; // "CFSI" in little endian.
+  static constexpr size_t c_StageHeaderLen = 16U;
+  static constexpr size_t c_StageBlockHeaderLen = 12U;
+  static constexpr size_t c_DecompressBufSize = (CanMsg::c_DataLenMax - 1U) * 32U;
+  static constexpr uint32_t c_ConnectWindowMs = 5000U;
+  static constexpr uint8_t c_XcpCmdConnect = 0xFFU;
+  static constexpr uint8_t c_XcpCmdSetMta = 0xF6U;
+  static constexpr uint8_t c_XcpCmdUpload = 0xF5U;
+  static constexpr uint8_t c_XcpCmdBuildChecksum = 0xF3U;
+  static constexpr uint8_t c_XcpCmdProgramStart = 0xD2U;
+  static constexpr uint8_t c_XcpCmdProgramClear = 0xD1U;
+  static constexpr uint8_t c_XcpCmdProgramReset = 0xCFU;
+  static constexpr uint8_t c_XcpCmdProgram = 0xD0U;
+  static constexpr uint8_t c_XcpCmdProgramMax = 0xC9U;
+  static constexpr uint8_t c_XcpPidResponse = 0xFFU;
+  static constexpr uint8_t c_XcpPidError = 0xFEU;
+  static constexpr uint8_t c_XcpErrCmdUnknown = 0x20U;
+  static constexpr uint32_t c_XcpTimeoutT1Ms = 1000U;
+  static constexpr uint32_t c_XcpTimeoutT2Ms = 2000U;
+  static constexpr uint32_t c_XcpTimeoutT3Ms = 2000U;
+  static constexpr uint32_t c_XcpTimeoutT4Ms = 10000U;
+  static constexpr uint32_t c_XcpTimeoutT5Ms = 1000U;
+  static constexpr uint32_t c_XcpTimeoutT6Ms = 50U;
+  static constexpr uint8_t c_XcpCommModeMotorola = 0x01U;
+  static constexpr uint8_t c_XcpChecksumCrc32 = 0x09U;
+  static constexpr uint32_t c_Crc32Initial = 0xFFFFFFFFUL;
+  static constexpr uint32_t c_Crc32Polynomial = 0xEDB88320UL;
+  // Members.
+  Can& m_Can;
+  Storage& m_Storage;
+  uint8_t m_CanExtIds;
+  uint32_t m_CanIdToTarget;
+  std::array<uint8_t, c_JobDataSizeMax> m_JobData{ };
+  uint8_t m_JobCommand{0U};
+  uint8_t m_JobOrigin{ORIGINHOST};
+  size_t m_JobLen{0U};
+  volatile uint8_t m_Busy{TBX_FALSE};
+  volatile uint8_t m_Claimed{TBX_FALSE};
+  uint8_t m_ClaimOrigin{ORIGINHOST};
+  volatile uint8_t m_Connecting{TBX_FALSE};
+  size_t m_StageOffset{0U};
+  uint8_t m_StageFlags{0U};
+  uint32_t m_StageNextAddress{0U};
+  uint8_t m_Motorola{TBX_FALSE};
+  uint8_t m_ProgramMaxSupported{TBX_TRUE};
+  uint8_t m_ChecksumSupported{TBX_TRUE};
+  Decompressor m_Decompressor{ };
+  std::array<uint8_t, c_DecompressBufSize> m_DecompressBuf{ };
+  size_t m_DecompressLen{0U};
+  size_t m_DecompressTotal{0U};
+  CanMsg m_Response{ };
+  cpp_freertos::BinarySemaphore m_ResponseSemaphore{false};
+  // Methods.
+  void Run() override;
+  void runBulkDownload(XcpLoaderResult& t_Result);
+  void runStageErase(XcpLoaderResult& t_Result);
+  void runStageWrite(XcpLoaderResult& t_Result);
+  void runStageCommit(XcpLoaderResult& t_Result);
+  void runStandalone(XcpLoaderResult& t_Result);
+  void runVerify(XcpLoaderResult& t_Result);
+  uint8_t stagedImageInfo(size_t& t_Len, uint8_t& t_Flags, uint32_t& t_SectorSize);
+  uint8_t processStagedBlocks(size_t t_ImageLen, uint8_t t_Flags, uint8_t t_Program,
+                              XcpLoaderResult& t_Result);
+  uint8_t processDeltaSectors(size_t t_ImageLen, uint32_t t_SectorSize,
+                              XcpLoaderResult& t_Result);
+  uint8_t nextStagedPiece(StagedCursor& t_Cursor, size_t t_EndOffset,
+                          uint32_t t_SectorSize, StagedPiece& t_Piece);
+  uint8_t comparePiece(StagedPiece const& t_Piece, uint8_t& t_Differs,
+                       XcpLoaderResult& t_Result);
+  uint8_t stagedPieceChecksum(StagedPiece const& t_Piece, uint8_t t_Type,
+                              uint32_t& t_Checksum);
+  uint8_t xcpCommand(CanMsg& t_Cmd, uint32_t t_TimeoutMs, XcpLoaderResult& t_Result);
+  uint8_t xcpConnect(XcpLoaderResult& t_Result);
+  uint8_t xcpProgramStart(XcpLoaderResult& t_Result);
+  uint8_t xcpProgramClear(uint32_t t_Len, XcpLoaderResult& t_Result);
+  uint8_t xcpSetMta(uint32_t t_Address, XcpLoaderResult& t_Result);
+  uint8_t xcpProgram(uint8_t const t_Data[], size_t t_Len, XcpLoaderResult& t_Result);
+  uint8_t xcpProgramStaged(size_t t_Offset, size_t t_Len, XcpLoaderResult& t_Result);
+  uint8_t xcpProgramStagedCompressed(size_t t_Offset, size_t t_StoredLen,
+                                     size_t t_Len, XcpLoaderResult& t_Result);
+  void decompressStart();
+  uint8_t xcpProgramDecompressed(uint8_t const t_Data[], size_t t_Len,
+                                 XcpLoaderResult& t_Result);
+  uint8_t xcpProgramDecompressedEnd(XcpLoaderResult& t_Result);
+  size_t decompressedLen(uint8_t const t_Data[], size_t t_Len);
+  uint8_t xcpProgramEnd(XcpLoaderResult& t_Result);
+  uint8_t xcpProgramReset(XcpLoaderResult& t_Result);
+  uint8_t xcpBuildChecksum(uint32_t t_Len, uint8_t& t_Type, uint32_t& t_Checksum,
+                           XcpLoaderResult& t_Result);
+  uint8_t xcpUploadCompare(StagedPiece const& t_Piece, uint8_t& t_Differs,
+                           XcpLoaderResult& t_Result);
+  uint8_t xcpUploadVerify(uint32_t t_Len, uint32_t t_SegmentLen,
+                          uint8_t const t_SegmentCrcs[], XcpLoaderResult& t_Result);
+  void storeValue(uint8_t t_Dest[], uint32_t t_Value) const;
+  uint32_t loadValue(uint8_t const t_Src[], size_t t_Size) const;
+  static uint32_t loadLe32(uint8_t const t_Src[]);
+  static void storeLe32(uint8_t t_Dest[], uint32_t t_Value);
+  static size_t stageAlign(size_t t_Len);
+  static uint32_t crc32Update(uint32_t t_Crc, uint8_t const t_Data[], size_t t_Len);
+
+  // Flag the class as non-copyable.
+  XcpLoader(const XcpLoader&) = delete;
+  const XcpLoader& operator=(const XcpLoader&) = delete; 
+};
+
+#endif // XCPLOADER_HPP
+//********************************** end of xcploader.hpp *******************************